@@ -0,0 +1,95 @@
+/* Benchmark of BINARY_FLOAT and BINARY_DOUBLE value formatting
+   Copyright (C) 2018-2024 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+// Compares std::ostringstream used before with the shortest round-trip formatting used by BuilderJson::columnFloat/columnDouble.
+// Build: g++ -O2 -std=c++17 float-format.cpp -o float-format
+
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <vector>
+
+static constexpr uint64_t VALUES = 2000000;
+
+static uint64_t formatStream(double value, char* buffer) {
+    std::ostringstream ss;
+    ss << value;
+    std::string str = ss.str();
+    memcpy(buffer, str.c_str(), str.length());
+    return str.length();
+}
+
+static uint64_t formatShortest(double value, char* buffer) {
+#ifdef __cpp_lib_to_chars
+    std::to_chars_result result = std::to_chars(buffer, buffer + 32, value);
+    return result.ptr - buffer;
+#else
+    int length = 0;
+    for (int precision = 15; precision <= 17; ++precision) {
+        length = snprintf(buffer, 32, "%.*g", precision, value);
+        if (strtod(buffer, nullptr) == value)
+            break;
+    }
+    return length;
+#endif
+}
+
+template<typename Format>
+static double measure(const std::vector<double>& values, Format format, uint64_t& errors) {
+    char buffer[33];
+    uint64_t total = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (double value: values)
+        total += format(value, buffer);
+    auto end = std::chrono::steady_clock::now();
+
+    // Text which doesn't parse back to the same value loses digits
+    errors = 0;
+    for (double value: values) {
+        buffer[format(value, buffer)] = 0;
+        if (strtod(buffer, nullptr) != value)
+            ++errors;
+    }
+
+    if (total == 0)
+        return 0;
+    return std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(values.size());
+}
+
+int main() {
+    std::mt19937_64 generator(1);
+    std::uniform_real_distribution<double> distribution(-1000000.0, 1000000.0);
+    std::vector<double> values(VALUES);
+    for (double& value: values)
+        value = distribution(generator);
+
+    uint64_t errorsStream;
+    uint64_t errorsShortest;
+    double timeStream = measure(values, formatStream, errorsStream);
+    double timeShortest = measure(values, formatShortest, errorsShortest);
+
+    printf("values: %lu\n", VALUES);
+    printf("ostringstream: %.0f ns per value, not round-trip: %lu\n", timeStream, errorsStream);
+    printf("shortest:      %.0f ns per value, not round-trip: %lu\n", timeShortest, errorsShortest);
+    return 0;
+}
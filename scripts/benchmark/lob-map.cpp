@@ -0,0 +1,78 @@
+/* Benchmark of LOB page index
+   Copyright (C) 2018-2024 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+// Compares std::map used before with LobMap used by LobData to index pages of one LOB, for pages coming in order and in reverse order.
+// The config.h file is created by cmake, build from the repository root after running cmake:
+// g++ -O2 -std=c++17 scripts/benchmark/lob-map.cpp src/common/LobData.cpp -o lob-map
+
+#include <chrono>
+#include <cstdio>
+#include <map>
+
+#include "../../src/common/LobData.h"
+
+using namespace OpenLogReplicator;
+
+// 1000 pages of 8 kB, the LOB has 8 MB
+static constexpr uint32_t PAGES = 1000;
+static constexpr uint64_t ROUNDS = 200;
+
+static typeDba pageDba(uint32_t page, bool reverse) {
+    if (reverse)
+        return 100000 + (PAGES - page) * 3;
+    return 100000 + page * 3;
+}
+
+template<typename DataMap, typename IndexMap>
+static double measure(bool reverse, uint64_t& checksum) {
+    uint8_t data = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t round = 0; round < ROUNDS; ++round) {
+        DataMap dataMap;
+        IndexMap indexMap;
+        for (uint32_t page = 0; page < PAGES; ++page) {
+            uint32_t index = reverse ? PAGES - page : page;
+            dataMap.insert_or_assign(LobDataElement(pageDba(page, reverse), 0), &data);
+            indexMap.insert_or_assign(index, pageDba(page, reverse));
+        }
+
+        // LOB is assembled in index order
+        for (auto& indexIt: indexMap)
+            checksum += dataMap.find(LobDataElement(indexIt.second, 0))->first.dba;
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / static_cast<double>(ROUNDS);
+}
+
+int main() {
+    uint64_t checksumMap = 0;
+    uint64_t checksumLobMap = 0;
+
+    for (bool reverse: {false, true}) {
+        double timeMap = measure<std::map<LobDataElement, uint8_t*>, std::map<uint32_t, typeDba>>(reverse, checksumMap);
+        double timeLobMap = measure<LobMap<LobDataElement, uint8_t*>, LobMap<uint32_t, typeDba>>(reverse, checksumLobMap);
+        printf("pages %s: std::map %.1f us, LobMap %.1f us per LOB\n", reverse ? "reversed" : "in order", timeMap, timeLobMap);
+    }
+
+    if (checksumMap != checksumLobMap) {
+        printf("checksum mismatch: %lu, %lu\n", checksumMap, checksumLobMap);
+        return 1;
+    }
+    return 0;
+}
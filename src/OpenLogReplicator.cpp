@@ -20,13 +20,18 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 #include <algorithm>
 #include <cerrno>
 #include <fcntl.h>
+#include <map>
 #include <regex>
+#include <set>
 #include <sys/file.h>
 #include <sys/stat.h>
 #include <thread>
 #include <unistd.h>
 
+#include "builder/BuilderArrow.h"
+#include "builder/BuilderAvro.h"
 #include "builder/BuilderJson.h"
+#include "builder/BuilderPool.h"
 #include "common/Ctx.h"
 #include "common/types.h"
 #include "common/Thread.h"
@@ -96,6 +101,10 @@ namespace OpenLogReplicator {
             delete replicatorTmp;
         replicators.clear();
 
+        for (BuilderPool* builderPool: builderPools)
+            delete builderPool;
+        builderPools.clear();
+
         for (Builder* builder: builders)
             delete builder;
         builders.clear();
@@ -494,7 +503,9 @@ namespace OpenLogReplicator {
                 static const char* formatNames[] = {"db", "attributes", "interval-dts", "interval-ytm", "message", "rid", "xid",
                                                     "timestamp", "timestamp-tz", "timestamp-all", "char", "scn", "scn-all",
                                                     "unknown", "schema", "column", "unknown-type", "flush-buffer", "type",
-                                                    nullptr};
+                                                    "avro-registry-path", "arrow-batch-rows", "arrow-batch-bytes",
+                                                    "arrow-batch-interval-s", "threads", "batch-rows", "batch-bytes",
+                                                    "lob-file-path", "lob-file-min-bytes", nullptr};
                 Ctx::checkJsonFields(configFileName, formatJson, formatNames);
             }
 
@@ -533,15 +544,19 @@ namespace OpenLogReplicator {
             uint64_t messageFormat = Builder::MESSAGE_FORMAT_DEFAULT;
             if (formatJson.HasMember("message")) {
                 messageFormat = Ctx::getJsonFieldU64(configFileName, formatJson, "message");
-                if (messageFormat > 31)
+                if (messageFormat > 127)
                     throw ConfigurationException(30001, "bad JSON, invalid \"message\" value: " + std::to_string(messageFormat) +
-                                                        ", expected: one of {0 .. 31}");
+                                                        ", expected: one of {0 .. 127}");
                 if ((messageFormat & Builder::MESSAGE_FORMAT_FULL) != 0 &&
                         (messageFormat & (Builder::MESSAGE_FORMAT_SKIP_BEGIN | Builder::MESSAGE_FORMAT_SKIP_COMMIT)) != 0)
                     throw ConfigurationException(30001, "bad JSON, invalid \"message\" value: " + std::to_string(messageFormat) +
                                                         ", expected: BEGIN/COMMIT flag is unset (" + std::to_string(Builder::MESSAGE_FORMAT_SKIP_BEGIN) + "/" +
                                                         std::to_string(Builder::MESSAGE_FORMAT_SKIP_COMMIT) + ") together with FULL mode (" +
                                                         std::to_string(Builder::MESSAGE_FORMAT_FULL) + ")");
+                if ((messageFormat & Builder::MESSAGE_FORMAT_FULL) != 0 && (messageFormat & Builder::MESSAGE_FORMAT_BATCH) != 0)
+                    throw ConfigurationException(30001, "bad JSON, invalid \"message\" value: " + std::to_string(messageFormat) +
+                                                        ", expected: BATCH mode (" + std::to_string(Builder::MESSAGE_FORMAT_BATCH) +
+                                                        ") not used together with FULL mode (" + std::to_string(Builder::MESSAGE_FORMAT_FULL) + ")");
             }
 
             uint64_t ridFormat = Builder::RID_FORMAT_SKIP;
@@ -650,6 +665,63 @@ namespace OpenLogReplicator {
 
             const char* formatType = Ctx::getJsonFieldS(configFileName, Ctx::JSON_PARAMETER_LENGTH, formatJson, "type");
 
+            if ((messageFormat & Builder::MESSAGE_FORMAT_BATCH) != 0 && strcmp("json", formatType) != 0)
+                throw ConfigurationException(30001, "bad JSON, invalid \"message\" value: " + std::to_string(messageFormat) +
+                                                    ", expected: BATCH mode (" + std::to_string(Builder::MESSAGE_FORMAT_BATCH) +
+                                                    ") not used when \"format\" is \"" + std::string(formatType) + "\"");
+
+            if ((messageFormat & Builder::MESSAGE_FORMAT_CHANGED) != 0 && strcmp("json", formatType) != 0)
+                throw ConfigurationException(30001, "bad JSON, invalid \"message\" value: " + std::to_string(messageFormat) +
+                                                    ", expected: CHANGED mode (" + std::to_string(Builder::MESSAGE_FORMAT_CHANGED) +
+                                                    ") not used when \"format\" is \"" + std::string(formatType) + "\"");
+
+            uint64_t batchRows = 1000;
+            if (formatJson.HasMember("batch-rows")) {
+                batchRows = Ctx::getJsonFieldU64(configFileName, formatJson, "batch-rows");
+                if (batchRows < 1 || batchRows > 1000000)
+                    throw ConfigurationException(30001, "bad JSON, invalid \"batch-rows\" value: " + std::to_string(batchRows) +
+                                                        ", expected: one of {1 .. 1000000}");
+            }
+
+            uint64_t batchBytes = 1048576;
+            if (formatJson.HasMember("batch-bytes")) {
+                batchBytes = Ctx::getJsonFieldU64(configFileName, formatJson, "batch-bytes");
+                if (batchBytes < 1 || batchBytes > 1073741824)
+                    throw ConfigurationException(30001, "bad JSON, invalid \"batch-bytes\" value: " + std::to_string(batchBytes) +
+                                                        ", expected: one of {1 .. 1073741824}");
+            }
+
+            std::string lobFilePath;
+            if (formatJson.HasMember("lob-file-path")) {
+                lobFilePath = Ctx::getJsonFieldS(configFileName, Ctx::MAX_PATH_LENGTH, formatJson, "lob-file-path");
+                if (strcmp("json", formatType) != 0)
+                    throw ConfigurationException(30001, "bad JSON, invalid \"lob-file-path\" value: " + lobFilePath +
+                                                        ", expected: not used when \"format\" is \"" + std::string(formatType) + "\"");
+                struct stat fileStat;
+                if (stat(lobFilePath.c_str(), &fileStat) != 0 || !S_ISDIR(fileStat.st_mode))
+                    throw ConfigurationException(30001, "bad JSON, invalid \"lob-file-path\" value: " + lobFilePath +
+                                                        ", expected: existing directory");
+            }
+
+            uint64_t lobFileMinBytes = 1048576;
+            if (formatJson.HasMember("lob-file-min-bytes")) {
+                lobFileMinBytes = Ctx::getJsonFieldU64(configFileName, formatJson, "lob-file-min-bytes");
+                if (lobFileMinBytes < 65536 || lobFileMinBytes > 1073741824)
+                    throw ConfigurationException(30001, "bad JSON, invalid \"lob-file-min-bytes\" value: " + std::to_string(lobFileMinBytes) +
+                                                        ", expected: one of {65536 .. 1073741824}");
+            }
+
+            uint64_t formatThreads = 0;
+            if (formatJson.HasMember("threads")) {
+                formatThreads = Ctx::getJsonFieldU64(configFileName, formatJson, "threads");
+                if (formatThreads > 64)
+                    throw ConfigurationException(30001, "bad JSON, invalid \"threads\" value: " + std::to_string(formatThreads) +
+                                                        ", expected: one of {0 .. 64}");
+                if (formatThreads > 0 && strcmp("json", formatType) != 0 && strcmp("protobuf", formatType) != 0)
+                    throw ConfigurationException(30001, "bad JSON, invalid \"threads\" value: " + std::to_string(formatThreads) +
+                                                        ", expected: 0 when \"format\" is \"" + std::string(formatType) + "\"");
+            }
+
             Builder* builder;
             if (strcmp("json", formatType) == 0) {
                 builder = new BuilderJson(ctx, locales, metadata, dbFormat, attributesFormat,
@@ -657,7 +729,7 @@ namespace OpenLogReplicator {
                                           ridFormat, xidFormat, timestampFormat,
                                           timestampTzFormat, timestampAll, charFormat, scnFormat,
                                           scnAll, unknownFormat, schemaFormat, columnFormat,
-                                          unknownType, flushBuffer);
+                                          unknownType, flushBuffer, batchRows, batchBytes);
             } else if (strcmp("protobuf", formatType) == 0) {
 #ifdef LINK_LIBRARY_PROTOBUF
                 builder = new BuilderProtobuf(ctx, locales, metadata, dbFormat, attributesFormat,
@@ -670,11 +742,97 @@ namespace OpenLogReplicator {
                 throw ConfigurationException(30001, "bad JSON, invalid \"format\" value: " + std::string(formatType) +
                                              ", expected: not \"protobuf\" since the code is not compiled");
 #endif /* LINK_LIBRARY_PROTOBUF */
+            } else if (strcmp("avro", formatType) == 0) {
+                if ((messageFormat & Builder::MESSAGE_FORMAT_FULL) != 0)
+                    throw ConfigurationException(30001, "bad JSON, invalid \"message\" value: " + std::to_string(messageFormat) +
+                                                        ", expected: not used when \"format\" is \"avro\"");
+                if (ctx->flagsSet(Ctx::REDO_FLAGS_SCHEMALESS))
+                    throw ConfigurationException(30001, "bad JSON, invalid \"format\" value: " + std::string(formatType) +
+                                                        ", expected: not used when flags has set schemaless mode (flags: " +
+                                                        std::to_string(ctx->flags) + ")");
+
+                const char* avroRegistryPath = "avro-registry";
+                if (formatJson.HasMember("avro-registry-path"))
+                    avroRegistryPath = Ctx::getJsonFieldS(configFileName, Ctx::MAX_PATH_LENGTH, formatJson, "avro-registry-path");
+
+                builder = new BuilderAvro(ctx, locales, metadata, dbFormat, attributesFormat,
+                                          intervalDtsFormat, intervalYtmFormat, messageFormat,
+                                          ridFormat, xidFormat, timestampFormat,
+                                          timestampTzFormat, timestampAll, charFormat, scnFormat,
+                                          scnAll, unknownFormat, schemaFormat, columnFormat,
+                                          unknownType, flushBuffer, avroRegistryPath);
+            } else if (strcmp("arrow", formatType) == 0) {
+                if ((messageFormat & Builder::MESSAGE_FORMAT_FULL) != 0)
+                    throw ConfigurationException(30001, "bad JSON, invalid \"message\" value: " + std::to_string(messageFormat) +
+                                                        ", expected: not used when \"format\" is \"arrow\"");
+                if (ctx->flagsSet(Ctx::REDO_FLAGS_SCHEMALESS))
+                    throw ConfigurationException(30001, "bad JSON, invalid \"format\" value: " + std::string(formatType) +
+                                                        ", expected: not used when flags has set schemaless mode (flags: " +
+                                                        std::to_string(ctx->flags) + ")");
+
+                uint64_t arrowBatchRows = 10000;
+                if (formatJson.HasMember("arrow-batch-rows")) {
+                    arrowBatchRows = Ctx::getJsonFieldU64(configFileName, formatJson, "arrow-batch-rows");
+                    if (arrowBatchRows < 1)
+                        throw ConfigurationException(30001, "bad JSON, invalid \"arrow-batch-rows\" value: " +
+                                                            std::to_string(arrowBatchRows) + ", expected: at least 1");
+                }
+
+                uint64_t arrowBatchBytes = 4194304;
+                if (formatJson.HasMember("arrow-batch-bytes")) {
+                    arrowBatchBytes = Ctx::getJsonFieldU64(configFileName, formatJson, "arrow-batch-bytes");
+                    if (arrowBatchBytes < 1 || arrowBatchBytes > 1073741824)
+                        throw ConfigurationException(30001, "bad JSON, invalid \"arrow-batch-bytes\" value: " +
+                                                            std::to_string(arrowBatchBytes) + ", expected: one of {1 .. 1073741824}");
+                }
+
+                uint64_t arrowBatchInterval = 5;
+                if (formatJson.HasMember("arrow-batch-interval-s"))
+                    arrowBatchInterval = Ctx::getJsonFieldU64(configFileName, formatJson, "arrow-batch-interval-s");
+
+                builder = new BuilderArrow(ctx, locales, metadata, dbFormat, attributesFormat,
+                                           intervalDtsFormat, intervalYtmFormat, messageFormat,
+                                           ridFormat, xidFormat, timestampFormat,
+                                           timestampTzFormat, timestampAll, charFormat, scnFormat,
+                                           scnAll, unknownFormat, schemaFormat, columnFormat,
+                                           unknownType, flushBuffer, arrowBatchRows, arrowBatchBytes,
+                                           arrowBatchInterval);
             } else
                 throw ConfigurationException(30001, "bad JSON, invalid \"format\" value: " + std::string(formatType) +
-                                                    ", expected: \"protobuf\" or \"json\"");
+                                                    ", expected: \"protobuf\", \"json\", \"avro\" or \"arrow\"");
             builders.push_back(builder);
             builder->initialize();
+            builder->setLobFile(lobFilePath, lobFileMinBytes);
+
+            if (formatThreads > 0) {
+                auto builderPool = new BuilderPool(ctx, builder, metadata, transactionBuffer);
+                builderPools.push_back(builderPool);
+                builder->pool = builderPool;
+
+                for (uint64_t i = 0; i < formatThreads; ++i) {
+                    Builder* workerBuilder = nullptr;
+                    if (strcmp("json", formatType) == 0) {
+                        workerBuilder = new BuilderJson(ctx, locales, metadata, dbFormat, attributesFormat,
+                                                        intervalDtsFormat, intervalYtmFormat, messageFormat,
+                                                        ridFormat, xidFormat, timestampFormat,
+                                                        timestampTzFormat, timestampAll, charFormat, scnFormat,
+                                                        scnAll, unknownFormat, schemaFormat, columnFormat,
+                                                        unknownType, flushBuffer, batchRows, batchBytes);
+                    } else {
+#ifdef LINK_LIBRARY_PROTOBUF
+                        workerBuilder = new BuilderProtobuf(ctx, locales, metadata, dbFormat, attributesFormat,
+                                                            intervalDtsFormat, intervalYtmFormat, messageFormat,
+                                                            ridFormat, xidFormat, timestampFormat,
+                                                            timestampTzFormat, timestampAll, charFormat, scnFormat,
+                                                            scnAll, unknownFormat, schemaFormat,
+                                                            columnFormat, unknownType, flushBuffer);
+#endif /* LINK_LIBRARY_PROTOBUF */
+                    }
+                    workerBuilder->initialize();
+                    workerBuilder->setLobFile(lobFilePath, lobFileMinBytes);
+                    builderPool->addWorker(workerBuilder, std::string(alias) + "-builder-" + std::to_string(i));
+                }
+            }
 
             // READER
             const char* readerType = Ctx::getJsonFieldS(configFileName, Ctx::JSON_PARAMETER_LENGTH, readerJson, "type");
@@ -808,7 +966,7 @@ namespace OpenLogReplicator {
                         const rapidjson::Value& tableElementJson = Ctx::getJsonFieldO(configFileName, tableArrayJson, "table", k);
 
                         if (!ctx->disableChecksSet(Ctx::DISABLE_CHECKS_JSON_TAGS)) {
-                            static const char* tableElementNames[] = {"owner", "table", "key", "condition", nullptr};
+                            static const char* tableElementNames[] = {"owner", "table", "key", "condition", "columns", "skip-columns", nullptr};
                             Ctx::checkJsonFields(configFileName, tableElementJson, tableElementNames);
                         }
 
@@ -836,6 +994,14 @@ namespace OpenLogReplicator {
                             element->conditionStr = Ctx::getJsonFieldS(configFileName, Ctx::JSON_CONDITION_LENGTH, tableElementJson,
                                                                        "condition");
                         }
+
+                        if (tableElementJson.HasMember("columns"))
+                            SchemaElement::parseColumns(Ctx::getJsonFieldS(configFileName, Ctx::JSON_COLUMNS_LENGTH, tableElementJson, "columns"),
+                                                        element->columnsInclude);
+
+                        if (tableElementJson.HasMember("skip-columns"))
+                            SchemaElement::parseColumns(Ctx::getJsonFieldS(configFileName, Ctx::JSON_COLUMNS_LENGTH, tableElementJson, "skip-columns"),
+                                                        element->columnsExclude);
                     }
                 }
 
@@ -872,11 +1038,17 @@ namespace OpenLogReplicator {
 
         // Iterate through targets
         const rapidjson::Value& targetArrayJson = Ctx::getJsonFieldA(configFileName, document, "target");
-        if (targetArrayJson.Size() != 1) {
+        if (targetArrayJson.Size() < 1) {
             throw ConfigurationException(30001, "bad JSON, invalid \"target\" value: " + std::to_string(targetArrayJson.Size()) +
-                                                " elements, expected: 1 element");
+                                                " elements, expected: at least 1 element");
         }
 
+        // Many targets can share one source, every target confirms the output on its own
+        std::map<Replicator*, uint64_t> sourceTargets;
+        std::set<Replicator*> sourceStreams;
+        // Source and alias of every writer, in the order of writers
+        std::vector<std::pair<Replicator*, std::string>> writerSources;
+
         for (rapidjson::SizeType j = 0; j < targetArrayJson.Size(); ++j) {
             const rapidjson::Value& targetJson = targetArrayJson[j];
             const char* alias = Ctx::getJsonFieldS(configFileName, Ctx::JSON_PARAMETER_LENGTH, targetJson, "alias");
@@ -890,6 +1062,7 @@ namespace OpenLogReplicator {
             if (replicator2 == nullptr)
                 throw ConfigurationException(30001, "bad JSON, invalid \"source\" value: " + std::string(source) +
                                                     ", expected: value used earlier in \"source\" field");
+            uint64_t targets = ++sourceTargets[replicator2];
 
             // Writer
             Writer* writer;
@@ -899,7 +1072,9 @@ namespace OpenLogReplicator {
             if (!ctx->disableChecksSet(Ctx::DISABLE_CHECKS_JSON_TAGS)) {
                 static const char* writerNames[] = {"type", "poll-interval-us", "queue-size", "max-file-size", "timestamp-format",
                                                     "output", "new-line", "append", "max-message-mb", "topic", "properties",
-                                                    "uri", nullptr};
+                                                    "uri", "topic-template", "key-format", "checkpoint-topic", "sync-mode",
+                                                    "sync-interval-ms", "sync-size-mb", "compression", "compression-frame-mb", "max-open-files",
+                                                    nullptr};
                 Ctx::checkJsonFields(configFileName, writerJson, writerNames);
             }
 
@@ -949,9 +1124,62 @@ namespace OpenLogReplicator {
                                                             ", expected: one of {0, 1}");
                 }
 
+                uint64_t syncMode = WriterFile::SYNC_MODE_NONE;
+                if (writerJson.HasMember("sync-mode")) {
+                    syncMode = Ctx::getJsonFieldU64(configFileName, writerJson, "sync-mode");
+                    if (syncMode > WriterFile::SYNC_MODE_CHECKPOINT)
+                        throw ConfigurationException(30001, "bad JSON, invalid \"sync-mode\" value: " + std::to_string(syncMode) +
+                                                            ", expected: one of {0 .. 2}");
+                }
+
+                uint64_t syncIntervalMs = 1000;
+                if (writerJson.HasMember("sync-interval-ms")) {
+                    syncIntervalMs = Ctx::getJsonFieldU64(configFileName, writerJson, "sync-interval-ms");
+                    if (syncIntervalMs < 1 || syncIntervalMs > 3600000)
+                        throw ConfigurationException(30001, "bad JSON, invalid \"sync-interval-ms\" value: " + std::to_string(syncIntervalMs) +
+                                                            ", expected: one of {1 .. 3600000}");
+                }
+
+                uint64_t syncSizeMb = 128;
+                if (writerJson.HasMember("sync-size-mb"))
+                    syncSizeMb = Ctx::getJsonFieldU64(configFileName, writerJson, "sync-size-mb");
+
+                uint64_t compression = WriterFile::COMPRESSION_NONE;
+                if (writerJson.HasMember("compression")) {
+                    compression = Ctx::getJsonFieldU64(configFileName, writerJson, "compression");
+                    if (compression > WriterFile::COMPRESSION_ZSTD)
+                        throw ConfigurationException(30001, "bad JSON, invalid \"compression\" value: " + std::to_string(compression) +
+                                                            ", expected: one of {0, 1}");
+#ifndef LINK_LIBRARY_ZSTD
+                    if (compression == WriterFile::COMPRESSION_ZSTD)
+                        throw ConfigurationException(30001, "bad JSON, invalid \"compression\" value: " + std::to_string(compression) +
+                                                            ", expected: not 1 since the code is not compiled");
+#endif /* LINK_LIBRARY_ZSTD */
+                    if (compression != WriterFile::COMPRESSION_NONE && output[0] == 0)
+                        throw ConfigurationException(30001, "bad JSON, invalid \"compression\" value: " + std::to_string(compression) +
+                                                            ", expected: 0 when \"output\" is not set");
+                }
+
+                uint64_t frameSizeMb = 4;
+                if (writerJson.HasMember("compression-frame-mb")) {
+                    frameSizeMb = Ctx::getJsonFieldU64(configFileName, writerJson, "compression-frame-mb");
+                    if (frameSizeMb < 1 || frameSizeMb > 1024)
+                        throw ConfigurationException(30001, "bad JSON, invalid \"compression-frame-mb\" value: " + std::to_string(frameSizeMb) +
+                                                            ", expected: one of {1 .. 1024}");
+                }
+
+                uint64_t maxOpenFiles = 64;
+                if (writerJson.HasMember("max-open-files")) {
+                    maxOpenFiles = Ctx::getJsonFieldU64(configFileName, writerJson, "max-open-files");
+                    if (maxOpenFiles < 1 || maxOpenFiles > 65536)
+                        throw ConfigurationException(30001, "bad JSON, invalid \"max-open-files\" value: " + std::to_string(maxOpenFiles) +
+                                                            ", expected: one of {1 .. 65536}");
+                }
+
                 writer = new WriterFile(ctx, std::string(alias) + "-writer", replicator2->database,
                                         replicator2->builder, replicator2->metadata, output, timestampFormat,
-                                        maxFileSize, newLine, append);
+                                        maxFileSize, newLine, append, syncMode, syncIntervalMs, syncSizeMb, compression, frameSizeMb,
+                                        maxOpenFiles);
             } else if (strcmp(writerType, "discard") == 0) {
                 writer = new WriterDiscard(ctx, std::string(alias) + "-writer", replicator2->database,
                                            replicator2->builder, replicator2->metadata);
@@ -964,12 +1192,30 @@ namespace OpenLogReplicator {
                         throw ConfigurationException(30001, "bad JSON, invalid \"max-message-mb\" value: " + std::to_string(maxMessageMb) +
                                                             ", expected: one of {1 .. " + std::to_string(WriterKafka::MAX_KAFKA_MESSAGE_MB) + "}");
                 }
-                replicator2->builder->setMaxMessageMb(maxMessageMb);
+                // The output shared by many targets must fit the smallest limit
+                if (replicator2->builder->getMaxMessageMb() == 0 || maxMessageMb < replicator2->builder->getMaxMessageMb())
+                    replicator2->builder->setMaxMessageMb(maxMessageMb);
 
                 const char* topic = Ctx::getJsonFieldS(configFileName, Ctx::JSON_TOPIC_LENGTH, writerJson, "topic");
 
+                const char* topicTemplate = "";
+                if (writerJson.HasMember("topic-template"))
+                    topicTemplate = Ctx::getJsonFieldS(configFileName, Ctx::JSON_TOPIC_LENGTH, writerJson, "topic-template");
+
+                uint64_t keyFormat = WriterKafka::KEY_FORMAT_NONE;
+                if (writerJson.HasMember("key-format")) {
+                    keyFormat = Ctx::getJsonFieldU64(configFileName, writerJson, "key-format");
+                    if (keyFormat > WriterKafka::KEY_FORMAT_PK)
+                        throw ConfigurationException(30001, "bad JSON, invalid \"key-format\" value: " + std::to_string(keyFormat) +
+                                                            ", expected: one of {0, 1}");
+                }
+
+                const char* checkpointTopic = "";
+                if (writerJson.HasMember("checkpoint-topic"))
+                    checkpointTopic = Ctx::getJsonFieldS(configFileName, Ctx::JSON_TOPIC_LENGTH, writerJson, "checkpoint-topic");
+
                 writer = new WriterKafka(ctx, std::string(alias) + "-writer", replicator2->database,
-                                         replicator2->builder, replicator2->metadata, topic);
+                                         replicator2->builder, replicator2->metadata, topic, topicTemplate, keyFormat, checkpointTopic);
 
                 if (writerJson.HasMember("properties")) {
                     const rapidjson::Value& propertiesJson = Ctx::getJsonFieldO(configFileName, writerJson, "properties");
@@ -991,6 +1237,7 @@ namespace OpenLogReplicator {
                 stream->initialize();
                 writer = new WriterStream(ctx, std::string(alias) + "-writer", replicator2->database,
                                           replicator2->builder, replicator2->metadata, stream);
+                sourceStreams.insert(replicator2);
 #else
                 throw ConfigurationException(30001, "bad JSON, invalid \"type\" value: " + std::string(writerType) +
                                              ", expected: not \"zeromq\" since the code is not compiled");
@@ -1003,6 +1250,7 @@ namespace OpenLogReplicator {
                 stream->initialize();
                 writer = new WriterStream(ctx, std::string(alias) + "-writer", replicator2->database,
                                           replicator2->builder, replicator2->metadata, stream);
+                sourceStreams.insert(replicator2);
 #else
                 throw ConfigurationException(30001, "bad JSON, invalid \"type\" value: " + std::string(writerType) +
                                              ", expected: not \"network\" since the code is not compiled");
@@ -1012,9 +1260,26 @@ namespace OpenLogReplicator {
                                                     ", expected: one of {\"file\", \"kafka\", \"zeromq\", \"network\", \"discard\"}");
 
             writers.push_back(writer);
+            writerSources.emplace_back(replicator2, alias);
+
+            // The client of a stream target controls the starting position of the source
+            if (targets > 1 && sourceStreams.find(replicator2) != sourceStreams.end())
+                throw ConfigurationException(30001, "bad JSON, invalid \"source\" value: " + std::string(source) +
+                                                    ", expected: not shared with other targets when used by \"zeromq\" or \"network\" writer");
+        }
+
+        // Every target of a shared source keeps its own checkpoint, independent of the order and number of targets
+        for (uint64_t i = 0; i < writerSources.size(); ++i) {
+            Replicator* replicator2 = writerSources[i].first;
+            if (sourceTargets[replicator2] > 1)
+                writers[i]->setCheckpointName(replicator2->database + "-" + writerSources[i].second + "-chkpt");
+        }
+
+        // All writers are known before any of them starts reading the output
+        for (Writer* writer: writers)
             writer->initialize();
+        for (Writer* writer: writers)
             ctx->spawnThread(writer);
-        }
 
         ctx->mainLoop();
 
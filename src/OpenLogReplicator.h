@@ -26,6 +26,7 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 
 namespace OpenLogReplicator {
     class Builder;
+    class BuilderPool;
     class Ctx;
     class Checkpoint;
     class Locales;
@@ -40,6 +41,7 @@ namespace OpenLogReplicator {
         std::vector<Checkpoint*> checkpoints;
         std::vector<Locales*> localess;
         std::vector<Builder*> builders;
+        std::vector<BuilderPool*> builderPools;
         std::vector<Metadata*> metadatas;
         std::vector<TransactionBuffer*> transactionBuffers;
         std::vector<Writer*> writers;
@@ -17,13 +17,19 @@ You should have received a copy of the GNU General Public License
 along with OpenLogReplicator; see the file LICENSE;  If not see
 <http://www.gnu.org/licenses/>.  */
 
+#include <cerrno>
 #include <cmath>
+#include <fcntl.h>
+#include <iomanip>
+#include <sstream>
+#include <unistd.h>
 #include <vector>
 
 #include "../common/OracleColumn.h"
 #include "../common/OracleTable.h"
 #include "../common/RedoLogRecord.h"
 #include "../common/XmlCtx.h"
+#include "../common/exception/RuntimeException.h"
 #include "../common/metrics/Metrics.h"
 #include "../common/table/SysCol.h"
 #include "../metadata/Metadata.h"
@@ -78,7 +84,15 @@ namespace OpenLogReplicator {
             compressedBefore(false),
             compressedAfter(false),
             prevCharsSize(0),
+            messageTags(false),
+            tagTable(nullptr),
+            lobFileMinBytes(0),
+            lobFileLength(0),
+            lobFileDes(-1),
+            lobFileActive(false),
+            wakeUpFD(-1),
             systemTransaction(nullptr),
+            pool(nullptr),
             buffersAllocated(0),
             firstBuilderQueue(nullptr),
             lastBuilderQueue(nullptr),
@@ -86,11 +100,21 @@ namespace OpenLogReplicator {
             lwnIdx(0) {
         memset(reinterpret_cast<void*>(valuesSet), 0, sizeof(valuesSet));
         memset(reinterpret_cast<void*>(valuesMerge), 0, sizeof(valuesMerge));
+        memset(reinterpret_cast<void*>(valuesChanged), 0, sizeof(valuesChanged));
         memset(reinterpret_cast<void*>(values), 0, sizeof(values));
         memset(reinterpret_cast<void*>(valuesPart), 0, sizeof(valuesPart));
+        memset(reinterpret_cast<void*>(timestampCache), 0, sizeof(timestampCache));
+        conditionRow.values = values;
+        conditionRow.lengths = lengths;
+        conditionCache.transaction = 1;
     }
 
     Builder::~Builder() {
+        if (lobFileDes != -1) {
+            close(lobFileDes);
+            lobFileDes = -1;
+            unlink(lobFileName.c_str());
+        }
         valuesRelease();
         tables.clear();
 
@@ -185,13 +209,19 @@ namespace OpenLogReplicator {
 
             case SysCol::TYPE_BLOB:
                 if (after) {
-                    if (parseLob(lobCtx, data, length, 0, table->obj, offset, false, table->sys)) {
-                        if (column->xmlType && ctx->flagsSet(Ctx::REDO_FLAGS_EXPERIMENTAL_XMLTYPE)) {
+                    if (column->xmlType && ctx->flagsSet(Ctx::REDO_FLAGS_EXPERIMENTAL_XMLTYPE)) {
+                        if (parseLob(lobCtx, data, length, 0, table->obj, offset, false, table->sys)) {
                             if (parseXml(xmlCtx, reinterpret_cast<uint8_t*>(valueBuffer), valueLength, offset))
                                 columnString(column->name);
                             else
                                 columnRaw(column->name, reinterpret_cast<uint8_t*>(valueBufferOld), valueLengthOld);
-                        } else
+                        }
+                    } else {
+                        lobFileBegin(table, col);
+                        bool complete = parseLob(lobCtx, data, length, 0, table->obj, offset, false, table->sys);
+                        if (lobFileEnd(complete, offset))
+                            columnLobFile(column->name);
+                        else if (complete)
                             columnRaw(column->name, reinterpret_cast<uint8_t*>(valueBuffer), valueLength);
                     }
                 }
@@ -205,7 +235,11 @@ namespace OpenLogReplicator {
 
             case SysCol::TYPE_CLOB:
                 if (after) {
-                    if (parseLob(lobCtx, data, length, column->charsetId, table->obj, offset, true, table->systemTable > 0))
+                    lobFileBegin(table, col);
+                    bool complete = parseLob(lobCtx, data, length, column->charsetId, table->obj, offset, true, table->systemTable > 0);
+                    if (lobFileEnd(complete, offset))
+                        columnLobFile(column->name);
+                    else if (complete)
                         columnString(column->name);
                 }
                 break;
@@ -725,6 +759,223 @@ namespace OpenLogReplicator {
         maxMessageMb = maxMessageMb_;
     }
 
+    bool Builder::getMessageTags() const {
+        return messageTags;
+    }
+
+    void Builder::setMessageTags(bool newMessageTags) {
+        messageTags = newMessageTags;
+    }
+
+    void Builder::messageTagBegin(typeObj obj) {
+        msgTag.clear();
+        // Object of a partitioned table is the partition, the table is set just before the DML is processed
+        if (tagTable == nullptr || obj == 0)
+            return;
+
+        msgTag.append(tagTable->owner);
+        msgTag.push_back(0);
+        msgTag.append(tagTable->name);
+        msgTag.push_back(0);
+
+        // The key identifies a single row, so many rows in one message have none
+        if ((messageFormat & (MESSAGE_FORMAT_FULL | MESSAGE_FORMAT_BATCH)) != 0)
+            return;
+
+        bool first = true;
+        for (typeCol column: tagTable->pk) {
+            if (first)
+                first = false;
+            else
+                msgTag.push_back(',');
+
+            // Primary key columns of an update are logged in the before image when not changed
+            uint64_t type = VALUE_AFTER;
+            if (values[column][VALUE_AFTER] == nullptr || lengths[column][VALUE_AFTER] == 0)
+                type = VALUE_BEFORE;
+            if (values[column][type] == nullptr)
+                continue;
+
+            const uint8_t* data = values[column][type];
+            for (int64_t j = 0; j < lengths[column][type]; ++j) {
+                msgTag.push_back(Ctx::map16(data[j] >> 4));
+                msgTag.push_back(Ctx::map16(data[j] & 0x0F));
+            }
+        }
+    }
+
+    void Builder::setLobFile(const std::string& newLobFilePath, uint64_t newLobFileMinBytes) {
+        lobFilePath = newLobFilePath;
+        lobFileMinBytes = newLobFileMinBytes;
+    }
+
+    void Builder::lobFileBegin(const OracleTable* table, typeCol col) {
+        // System tables need the whole value in memory
+        if (lobFilePath.empty() || table->sys)
+            return;
+
+        // A file left after an error in the previous value is never referenced
+        if (lobFileDes != -1) {
+            close(lobFileDes);
+            lobFileDes = -1;
+            unlink(lobFileName.c_str());
+        }
+
+        lobFileActive = true;
+        lobFileLength = 0;
+        lobFileName = lobFilePath + "/" + std::to_string(commitScn) + "-" + lastXid.toString() + "-" + std::to_string(num) + "-" +
+                std::to_string(col) + ".lob";
+    }
+
+    void Builder::lobFileWrite(uint64_t offset) {
+        if (valueLength == 0)
+            return;
+
+        if (lobFileDes == -1) {
+            lobFileDes = open(lobFileName.c_str(), O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR);
+            if (lobFileDes == -1)
+                throw RuntimeException(10006, "file: " + lobFileName + " - open for write returned: " + strerror(errno));
+        }
+
+        int64_t bytesWritten = write(lobFileDes, valueBuffer, valueLength);
+        if (bytesWritten != static_cast<int64_t>(valueLength))
+            throw RuntimeException(10007, "file: " + lobFileName + " - " + std::to_string(bytesWritten) + " bytes written instead of " +
+                                          std::to_string(valueLength) + ", code returned: " + strerror(errno) + " at offset: " + std::to_string(offset));
+        lobFileLength += valueLength;
+        valueLength = 0;
+    }
+
+    bool Builder::lobFileEnd(bool complete, uint64_t offset) {
+        if (!lobFileActive)
+            return false;
+        lobFileActive = false;
+
+        // Small value is sent in the message
+        if (lobFileDes == -1)
+            return false;
+
+        if (!complete) {
+            close(lobFileDes);
+            lobFileDes = -1;
+            unlink(lobFileName.c_str());
+            return false;
+        }
+
+        // The file is on disk before the message referencing it is sent
+        lobFileWrite(offset);
+        if (fdatasync(lobFileDes) != 0)
+            throw RuntimeException(10073, "file: " + lobFileName + " - sync returned: " + strerror(errno));
+        close(lobFileDes);
+        lobFileDes = -1;
+        return true;
+    }
+
+    void Builder::columnLobFile(const std::string& columnName) {
+        throw RuntimeException(50071, "LOB file not supported by the output format for column: " + columnName);
+    }
+
+    uint8_t Builder::getLogicalType(const OracleColumn* column) const {
+        if (ctx->flagsSet(Ctx::REDO_FLAGS_RAW_COLUMN_DATA))
+            return LOGICAL_TYPE_BINARY;
+        if (column->guard && !ctx->flagsSet(Ctx::REDO_FLAGS_SHOW_GUARD_COLUMNS))
+            return LOGICAL_TYPE_NONE;
+        if (column->nested && !ctx->flagsSet(Ctx::REDO_FLAGS_SHOW_NESTED_COLUMNS))
+            return LOGICAL_TYPE_NONE;
+        if (column->hidden && !ctx->flagsSet(Ctx::REDO_FLAGS_SHOW_HIDDEN_COLUMNS))
+            return LOGICAL_TYPE_NONE;
+        if (column->unused && !ctx->flagsSet(Ctx::REDO_FLAGS_SHOW_UNUSED_COLUMNS))
+            return LOGICAL_TYPE_NONE;
+
+        switch (column->type) {
+            case SysCol::TYPE_VARCHAR:
+            case SysCol::TYPE_CHAR:
+            case SysCol::TYPE_CLOB:
+            case SysCol::TYPE_TIMESTAMP_WITH_TZ:
+            case SysCol::TYPE_INTERVAL_YEAR_TO_MONTH:
+            case SysCol::TYPE_INTERVAL_DAY_TO_SECOND:
+            case SysCol::TYPE_UROWID:
+                return LOGICAL_TYPE_STRING;
+
+            case SysCol::TYPE_NUMBER:
+                // Integer values fitting in 64 bits, others keep full decimal text
+                if (column->scale == 0 && column->precision > 0 && column->precision <= 18)
+                    return LOGICAL_TYPE_INT64;
+                return LOGICAL_TYPE_STRING;
+
+            case SysCol::TYPE_BOOLEAN:
+                return LOGICAL_TYPE_BOOLEAN;
+
+            case SysCol::TYPE_RAW:
+            case SysCol::TYPE_JSON:
+                return LOGICAL_TYPE_BINARY;
+
+            case SysCol::TYPE_BLOB:
+                if (column->xmlType && ctx->flagsSet(Ctx::REDO_FLAGS_EXPERIMENTAL_XMLTYPE))
+                    return LOGICAL_TYPE_STRING;
+                return LOGICAL_TYPE_BINARY;
+
+            case SysCol::TYPE_DATE:
+            case SysCol::TYPE_TIMESTAMP:
+            case SysCol::TYPE_TIMESTAMP_WITH_LOCAL_TZ:
+                return LOGICAL_TYPE_TIMESTAMP;
+
+            case SysCol::TYPE_FLOAT:
+                return LOGICAL_TYPE_FLOAT;
+
+            case SysCol::TYPE_DOUBLE:
+                return LOGICAL_TYPE_DOUBLE;
+
+            default:
+                if (unknownType == UNKNOWN_TYPE_SHOW)
+                    return LOGICAL_TYPE_STRING;
+                return LOGICAL_TYPE_NONE;
+        }
+    }
+
+    bool Builder::parseInt64(const std::string& columnName, int64_t& value) {
+        valueBuffer[valueLength] = 0;
+        char* retPtr;
+        errno = 0;
+        value = strtoll(valueBuffer, &retPtr, 10);
+        if (valueLength > 0 && *retPtr == 0 && errno != ERANGE)
+            return true;
+
+        ctx->warning(60040, "value: " + std::string(valueBuffer, valueLength) + " of column: " + columnName +
+                            " doesn't fit in 64-bit integer, written as null");
+        return false;
+    }
+
+    std::string Builder::formatTimestampTz(time_t timestamp, uint64_t fraction, const char* tz) {
+        // "2024-01-01T00:00:00.123456789,Europe/Warsaw"
+        char buffer[22];
+        std::string str(buffer, epochToIso8601(timestamp, buffer, true, false));
+        if (fraction > 0) {
+            std::string fractionStr = std::to_string(fraction);
+            str += '.';
+            str.append(9 - fractionStr.length(), '0');
+            str += fractionStr;
+        }
+        str += ',';
+        str += tz;
+        return str;
+    }
+
+    std::string Builder::formatXid() const {
+        if (xidFormat == XID_FORMAT_TEXT_HEX) {
+            std::ostringstream ss;
+            ss << "0x";
+            ss << std::setfill('0') << std::setw(4) << std::hex << static_cast<uint64_t>(lastXid.usn());
+            ss << '.';
+            ss << std::setfill('0') << std::setw(3) << std::hex << static_cast<uint64_t>(lastXid.slt());
+            ss << '.';
+            ss << std::setfill('0') << std::setw(8) << std::hex << static_cast<uint64_t>(lastXid.sqn());
+            return ss.str();
+        }
+        if (xidFormat == XID_FORMAT_TEXT_DEC)
+            return std::to_string(lastXid.usn()) + '.' + std::to_string(lastXid.slt()) + '.' + std::to_string(lastXid.sqn());
+        return std::to_string(lastXid.getData());
+    }
+
     void Builder::processBegin(typeXid xid, typeScn scn, typeScn newLwnScn, const std::unordered_map<std::string, std::string>* newAttributes) {
         lastXid = xid;
         commitScn = scn;
@@ -734,6 +985,8 @@ namespace OpenLogReplicator {
         }
         newTran = true;
         attributes = newAttributes;
+        // Attribute values are resolved again for the new transaction
+        ++conditionCache.transaction;
 
         if (attributes->size() == 0) {
             metadata->ctx->warning(50065, "empty attributes for XID: " + lastXid.toString());
@@ -801,9 +1054,10 @@ namespace OpenLogReplicator {
                                                  redoLogRecord1->dataOffset);
 
             if ((!schema && table != nullptr && (table->options & (OracleTable::OPTIONS_SYSTEM_TABLE | OracleTable::OPTIONS_DEBUG_TABLE)) == 0 &&
-                 table->matchesCondition(ctx, 'i', attributes)) || ctx->flagsSet(Ctx::REDO_FLAGS_SHOW_SYSTEM_TRANSACTIONS) ||
-                 ctx->flagsSet(Ctx::REDO_FLAGS_SCHEMALESS)) {
+                 table->matchesCondition(ctx, 'i', attributes, &conditionRow, &conditionCache)) ||
+                 ctx->flagsSet(Ctx::REDO_FLAGS_SHOW_SYSTEM_TRANSACTIONS) || ctx->flagsSet(Ctx::REDO_FLAGS_SCHEMALESS)) {
 
+                tagTable = table;
                 processInsert(scn, sequence, timestamp, lobCtx, xmlCtx, table, redoLogRecord2->obj, redoLogRecord2->dataObj, redoLogRecord2->bdba,
                               ctx->read16(redoLogRecord2->data + redoLogRecord2->slotsDelta + r * 2), redoLogRecord1->xid,
                               redoLogRecord1->dataOffset);
@@ -895,9 +1149,10 @@ namespace OpenLogReplicator {
                                                  redoLogRecord1->dataOffset);
 
             if ((!schema && table != nullptr && (table->options & (OracleTable::OPTIONS_SYSTEM_TABLE | OracleTable::OPTIONS_DEBUG_TABLE)) == 0 &&
-                 table->matchesCondition(ctx, 'd', attributes)) || ctx->flagsSet(Ctx::REDO_FLAGS_SHOW_SYSTEM_TRANSACTIONS) ||
-                 ctx->flagsSet(Ctx::REDO_FLAGS_SCHEMALESS)) {
+                 table->matchesCondition(ctx, 'd', attributes, &conditionRow, &conditionCache)) ||
+                 ctx->flagsSet(Ctx::REDO_FLAGS_SHOW_SYSTEM_TRANSACTIONS) || ctx->flagsSet(Ctx::REDO_FLAGS_SCHEMALESS)) {
 
+                tagTable = table;
                 processDelete(scn, sequence, timestamp, lobCtx, xmlCtx, table, redoLogRecord2->obj, redoLogRecord2->dataObj, redoLogRecord2->bdba,
                               ctx->read16(redoLogRecord1->data + redoLogRecord1->slotsDelta + r * 2), redoLogRecord1->xid,
                               redoLogRecord1->dataOffset);
@@ -1435,6 +1690,18 @@ namespace OpenLogReplicator {
             }
         }
 
+        // Row values are matched before unchanged columns are removed from the update
+        bool matches = false;
+        if (!schema && table != nullptr && (table->options & (OracleTable::OPTIONS_SYSTEM_TABLE | OracleTable::OPTIONS_DEBUG_TABLE)) == 0) {
+            char op = 'u';
+            if (type == TRANSACTION_INSERT)
+                op = 'i';
+            else if (type == TRANSACTION_DELETE)
+                op = 'd';
+            matches = table->matchesCondition(ctx, op, attributes, (compressedBefore || compressedAfter) ? nullptr : &conditionRow,
+                                              &conditionCache);
+        }
+
         if (type == TRANSACTION_UPDATE) {
             if (!compressedBefore && !compressedAfter) {
                 baseMax = valuesMax >> 6;
@@ -1527,6 +1794,12 @@ namespace OpenLogReplicator {
                             values[column][VALUE_BEFORE] = reinterpret_cast<uint8_t*>(1);
                             lengths[column][VALUE_BEFORE] = 0;
                         }
+
+                        if ((messageFormat & MESSAGE_FORMAT_CHANGED) != 0) {
+                            if (lengths[column][VALUE_BEFORE] != lengths[column][VALUE_AFTER] || (lengths[column][VALUE_BEFORE] > 0 &&
+                                    memcmp(values[column][VALUE_BEFORE], values[column][VALUE_AFTER], lengths[column][VALUE_BEFORE]) != 0))
+                                valuesChanged[base] |= mask;
+                        }
                     }
                 }
             }
@@ -1534,10 +1807,10 @@ namespace OpenLogReplicator {
             if (system && table != nullptr && (table->options & OracleTable::OPTIONS_SYSTEM_TABLE) != 0)
                 systemTransaction->processUpdate(table, dataObj, bdba, slot, redoLogRecord1->dataOffset);
 
-            if ((!schema && table != nullptr && (table->options & (OracleTable::OPTIONS_SYSTEM_TABLE | OracleTable::OPTIONS_DEBUG_TABLE)) == 0 &&
-                 table->matchesCondition(ctx, 'u', attributes)) || ctx->flagsSet(Ctx::REDO_FLAGS_SHOW_SYSTEM_TRANSACTIONS) ||
+            if (matches || ctx->flagsSet(Ctx::REDO_FLAGS_SHOW_SYSTEM_TRANSACTIONS) ||
                     ctx->flagsSet(Ctx::REDO_FLAGS_SCHEMALESS)) {
 
+                tagTable = table;
                 processUpdate(scn, sequence, timestamp, lobCtx, xmlCtx, table, obj, dataObj, bdba, slot, redoLogRecord1->xid, redoLogRecord1->dataOffset);
                 if (ctx->metrics != nullptr) {
                     if (ctx->metrics->isTagNamesFilter() && table != nullptr &&
@@ -1617,10 +1890,10 @@ namespace OpenLogReplicator {
             if (system && table != nullptr && (table->options & OracleTable::OPTIONS_SYSTEM_TABLE) != 0)
                 systemTransaction->processInsert(table, dataObj, bdba, slot, redoLogRecord1->dataOffset);
 
-            if ((!schema && table != nullptr && (table->options & (OracleTable::OPTIONS_SYSTEM_TABLE | OracleTable::OPTIONS_DEBUG_TABLE)) == 0 &&
-                 table->matchesCondition(ctx, 'i', attributes)) || ctx->flagsSet(Ctx::REDO_FLAGS_SHOW_SYSTEM_TRANSACTIONS) ||
+            if (matches || ctx->flagsSet(Ctx::REDO_FLAGS_SHOW_SYSTEM_TRANSACTIONS) ||
                  ctx->flagsSet(Ctx::REDO_FLAGS_SCHEMALESS)) {
 
+                tagTable = table;
                 processInsert(scn, sequence, timestamp, lobCtx, xmlCtx, table, obj, dataObj, bdba, slot, redoLogRecord1->xid, redoLogRecord1->dataOffset);
                 if (ctx->metrics != nullptr) {
                     if (ctx->metrics->isTagNamesFilter() && table != nullptr &&
@@ -1696,10 +1969,10 @@ namespace OpenLogReplicator {
             if (system && table != nullptr && (table->options & OracleTable::OPTIONS_SYSTEM_TABLE) != 0)
                 systemTransaction->processDelete(table, dataObj, bdba, slot, redoLogRecord1->dataOffset);
 
-            if ((!schema && table != nullptr && (table->options & (OracleTable::OPTIONS_SYSTEM_TABLE | OracleTable::OPTIONS_DEBUG_TABLE)) == 0 &&
-                 table->matchesCondition(ctx, 'd', attributes)) || ctx->flagsSet(Ctx::REDO_FLAGS_SHOW_SYSTEM_TRANSACTIONS) ||
+            if (matches || ctx->flagsSet(Ctx::REDO_FLAGS_SHOW_SYSTEM_TRANSACTIONS) ||
                  ctx->flagsSet(Ctx::REDO_FLAGS_SCHEMALESS)) {
 
+                tagTable = table;
                 processDelete(scn, sequence, timestamp, lobCtx, xmlCtx, table, obj, dataObj, bdba, slot, redoLogRecord1->xid, redoLogRecord1->dataOffset);
                 if (ctx->metrics != nullptr) {
                     if (ctx->metrics->isTagNamesFilter() && table != nullptr &&
@@ -1839,14 +2112,13 @@ namespace OpenLogReplicator {
         valueLength = 0;
 
         // bool bigint = false;
-        std::string out;
         uint64_t pos = 0;
-        std::vector<std::string> tags;
-        std::map<std::string, std::string> dictNmSpcMap;
-        std::map<std::string, std::string> nmSpcPrefixMap;
+        xmlTags.clear();
+        xmlDictNmSpc.clear();
+        xmlNmSpcPrefix.clear();
         bool tagOpen = false;
         bool attributeOpen = false;
-        std::string lastTag;
+        BuilderXmlTag lastTag{nullptr, nullptr};
 
         while (pos < length) {
             // Header
@@ -2041,37 +2313,15 @@ namespace OpenLogReplicator {
                     isSingle = true;
                 }
 
-                std::string codeStr;
-                if (code < 0x100)
-                    codeStr = {Ctx::map16U((code >> 4) & 0x0F), Ctx::map16U(code & 0x0F)};
-                else if (code < 0x10000)
-                    codeStr = {Ctx::map16U((code >> 12) & 0x0F), Ctx::map16U((code >> 8) & 0x0F),
-                               Ctx::map16U((code >> 4) & 0x0F), Ctx::map16U(code & 0x0F)};
-                else if (code < 0x1000000)
-                    codeStr = {Ctx::map16U((code >> 20) & 0x0F), Ctx::map16U((code >> 16) & 0x0F),
-                               Ctx::map16U((code >> 12) & 0x0F), Ctx::map16U((code >> 8) & 0x0F),
-                               Ctx::map16U((code >> 4) & 0x0F), Ctx::map16U(code & 0x0F)};
-                else
-                    codeStr = {Ctx::map16U((code >> 28) & 0x0F), Ctx::map16U((code >> 24) & 0x0F),
-                               Ctx::map16U((code >> 20) & 0x0F), Ctx::map16U((code >> 16) & 0x0F),
-                               Ctx::map16U((code >> 12) & 0x0F), Ctx::map16U((code >> 8) & 0x0F),
-                               Ctx::map16U((code >> 4) & 0x0F), Ctx::map16U(code & 0x0F)};
-
-                auto xdbXQnMapIdIt = xmlCtx->xdbXQnMapId.find(codeStr);
-                if (xdbXQnMapIdIt == xmlCtx->xdbXQnMapId.end()) {
-                    ctx->warning(60036, "incorrect XML data: string too short, can't decode qn   " + codeStr);
+                const XdbXQn* xdbXQn = xmlCtx->dictXdbXQnFindCode(code);
+                if (xdbXQn == nullptr) {
+                    ctx->warning(60036, "incorrect XML data: string too short, can't decode qn   " + XmlCtx::codeToId(code));
                     return false;
                 }
 
-                std::string tag = xdbXQnMapIdIt->second->localName;
-                // not very efficient, but it's not a problem
-                uint64_t flagsLength = xdbXQnMapIdIt->second->flags.length();
-                bool isAttribute = (((xdbXQnMapIdIt->second->flags.at(flagsLength - 1) - '0') & XdbXQn::FLAG_ISATTRIBUTE) != 0);
-
-                if (isAttribute) {
-                    out = " " + tag + "=\"";
-                    valueBufferCheck(out.length(), offset);
-                    valueBufferAppend(out.c_str(), out.length());
+                BuilderXmlTag tag{nullptr, &xdbXQn->localName};
+                if (xdbXQn->isAttribute) {
+                    valueBufferAppendXmlTag(" ", 1, tag, "=\"", 2, offset);
                 } else {
                     if (attributeOpen) {
                         valueBufferCheck(2, offset);
@@ -2084,18 +2334,15 @@ namespace OpenLogReplicator {
                     }
 
                     // append namespace to tag name
-                    std::string nmSpcId = xdbXQnMapIdIt->second->nmSpcId;
-                    auto nmSpcPrefixMapIt = nmSpcPrefixMap.find(nmSpcId);
-                    if (nmSpcPrefixMapIt != nmSpcPrefixMap.end())
-                        tag = nmSpcPrefixMapIt->second + ":" + tag;
+                    auto xmlNmSpcPrefixIt = xmlNmSpcPrefix.find(xdbXQn->nmSpcCode);
+                    if (xmlNmSpcPrefixIt != xmlNmSpcPrefix.end())
+                        tag.prefix = &xmlNmSpcPrefixIt->second;
 
                     if (tagLength == 0 && !isSingle) {
-                        out = "<" + tag;
+                        valueBufferAppendXmlTag("<", 1, tag, "", 0, offset);
                         tagOpen = true;
                     } else
-                        out = "<" + tag + ">";
-                    valueBufferCheck(out.length(), offset);
-                    valueBufferAppend(out.c_str(), out.length());
+                        valueBufferAppendXmlTag("<", 1, tag, ">", 1, offset);
                 }
 
                 if (tagLength > 0) {
@@ -2108,19 +2355,17 @@ namespace OpenLogReplicator {
                     pos += tagLength;
                 }
 
-                if (isAttribute) {
+                if (xdbXQn->isAttribute) {
                     if (isSingle) {
                         valueBufferCheck(1, offset);
                         valueBufferAppend('"');
                     } else
                         attributeOpen = true;
                 } else {
-                    if (isSingle) {
-                        out = "</" + tag + ">";
-                        valueBufferCheck(out.length(), offset);
-                        valueBufferAppend(out.c_str(), out.length());
-                    } else
-                        tags.push_back(tag);
+                    if (isSingle)
+                        valueBufferAppendXmlTag("</", 2, tag, ">", 1, offset);
+                    else
+                        xmlTags.push_back(tag);
                 }
 
                 continue;
@@ -2143,37 +2388,19 @@ namespace OpenLogReplicator {
                 uint16_t dict = ctx->read16Big(data + pos);
                 pos += 2;
 
-                std::string nmSpcId;
-                if (nmSpc < 256)
-                    nmSpcId = {Ctx::map16U((nmSpc >> 4) & 0x0F), Ctx::map16U(nmSpc & 0x0F)};
-                else
-                    nmSpcId = {Ctx::map16U((nmSpc >> 12) & 0x0F), Ctx::map16U((nmSpc >> 8) & 0x0F),
-                               Ctx::map16U((nmSpc >> 4) & 0x0F), Ctx::map16U(nmSpc & 0x0F)};
-
-                std::string dictId;
-                if (dict < 256)
-                    dictId = {Ctx::map16U((dict >> 4) & 0x0F), Ctx::map16U(dict & 0x0F)};
-                else
-                    dictId = {Ctx::map16U((dict >> 12) & 0x0F), Ctx::map16U((dict >> 8) & 0x0F),
-                              Ctx::map16U((dict >> 4) & 0x0F), Ctx::map16U(dict & 0x0F)};
-
-                auto dictNmSpcMapIt = dictNmSpcMap.find(dictId);
-                if (dictNmSpcMapIt != dictNmSpcMap.end()) {
-                    ctx->warning(60036, "incorrect XML data: namespace " + dictId + " duplicated dict");
+                if (xmlDictNmSpc.find(dict) != xmlDictNmSpc.end()) {
+                    ctx->warning(60036, "incorrect XML data: namespace " + XmlCtx::codeToId(dict) + " duplicated dict");
                     return false;
                 }
-                dictNmSpcMap.insert_or_assign(dictId, nmSpcId);
+                xmlDictNmSpc.insert_or_assign(dict, nmSpc);
 
                 if (tagLength > 0) {
-                    std::string prefix(reinterpret_cast<const char*>(data + pos), tagLength);
-                    pos += tagLength;
-
-                    auto nmSpcPrefixMapIt = nmSpcPrefixMap.find(nmSpcId);
-                    if (nmSpcPrefixMapIt != nmSpcPrefixMap.end()) {
-                        ctx->warning(60036, "incorrect XML data: namespace " + nmSpcId + " duplicated prefix");
+                    if (xmlNmSpcPrefix.find(nmSpc) != xmlNmSpcPrefix.end()) {
+                        ctx->warning(60036, "incorrect XML data: namespace " + XmlCtx::codeToId(nmSpc) + " duplicated prefix");
                         return false;
                     }
-                    nmSpcPrefixMap.insert_or_assign(nmSpcId, prefix);
+                    xmlNmSpcPrefix.insert_or_assign(nmSpc, std::string(reinterpret_cast<const char*>(data + pos), tagLength));
+                    pos += tagLength;
                 }
 
                 continue;
@@ -2190,46 +2417,31 @@ namespace OpenLogReplicator {
                 uint16_t dict = ctx->read16Big(data + pos);
                 pos += 2;
 
-                std::string dictId;
-                if (dict < 256)
-                    dictId = {Ctx::map16U((dict >> 4) & 0x0F), Ctx::map16U(dict & 0x0F)};
-                else
-                    dictId = {Ctx::map16U((dict >> 12) & 0x0F), Ctx::map16U((dict >> 8) & 0x0F),
-                              Ctx::map16U((dict >> 4) & 0x0F), Ctx::map16U(dict & 0x0F)};
-
-                auto dictNmSpcMapIt = dictNmSpcMap.find(dictId);
-                if (dictNmSpcMapIt == dictNmSpcMap.end()) {
-                    ctx->warning(60036, "incorrect XML data: namespace " + dictId + " not found for namespace");
+                auto xmlDictNmSpcIt = xmlDictNmSpc.find(dict);
+                if (xmlDictNmSpcIt == xmlDictNmSpc.end()) {
+                    ctx->warning(60036, "incorrect XML data: namespace " + XmlCtx::codeToId(dict) + " not found for namespace");
                     return false;
                 }
-                std::string nmSpcId = dictNmSpcMapIt->second;
+                uint64_t nmSpc = xmlDictNmSpcIt->second;
 
                 // search url
-                auto xdbXNmMapIdIt = xmlCtx->xdbXNmMapId.find(nmSpcId);
-                if (xdbXNmMapIdIt == xmlCtx->xdbXNmMapId.end()) {
-                    ctx->warning(60036, "incorrect XML data: namespace " + nmSpcId + " not found");
+                const XdbXNm* xdbXNm = xmlCtx->dictXdbXNmFindCode(nmSpc);
+                if (xdbXNm == nullptr) {
+                    ctx->warning(60036, "incorrect XML data: namespace " + XmlCtx::codeToId(nmSpc) + " not found");
                     return false;
                 }
 
-                valueBufferCheck(7, offset);
-                valueBufferAppend(" xmlns", 6);
+                auto xmlNmSpcPrefixIt = xmlNmSpcPrefix.find(nmSpc);
+                const std::string* prefix = (xmlNmSpcPrefixIt != xmlNmSpcPrefix.end()) ? &xmlNmSpcPrefixIt->second : nullptr;
+                valueBufferCheck(10 + (prefix != nullptr ? prefix->length() : 0) + xdbXNm->nmSpcUri.length(), offset);
 
-                auto nmSpcPrefixMapIt = nmSpcPrefixMap.find(nmSpcId);
-                if (nmSpcPrefixMapIt != nmSpcPrefixMap.end()) {
-                    valueBufferCheck(1, offset);
+                valueBufferAppend(" xmlns", 6);
+                if (prefix != nullptr) {
                     valueBufferAppend(':');
-
-                    valueBufferCheck(nmSpcPrefixMapIt->second.length(), offset);
-                    valueBufferAppend(nmSpcPrefixMapIt->second.c_str(), nmSpcPrefixMapIt->second.length());
+                    valueBufferAppend(*prefix);
                 }
-
-                valueBufferCheck(2, offset);
                 valueBufferAppend("=\"", 2);
-
-                valueBufferCheck(xdbXNmMapIdIt->second->nmSpcUri.length(), offset);
-                valueBufferAppend(xdbXNmMapIdIt->second->nmSpcUri.c_str(), xdbXNmMapIdIt->second->nmSpcUri.length());
-
-                valueBufferCheck(1, offset);
+                valueBufferAppend(xdbXNm->nmSpcUri);
                 valueBufferAppend('"');
 
                 continue;
@@ -2287,21 +2499,19 @@ namespace OpenLogReplicator {
             // end tag
             if (data[pos] == 0xD9) {
                 if (attributeOpen) {
-                    out = "\"";
+                    valueBufferCheck(1, offset);
+                    valueBufferAppend('"');
                     attributeOpen = false;
                     tagOpen = true;
                 } else {
-                    if (tags.size() == 0) {
+                    if (xmlTags.empty()) {
                         ctx->warning(60036, "incorrect XML data: end tag found, but no tags open");
                         return false;
                     }
-                    lastTag = tags.back();
-                    tags.pop_back();
-                    out = "</" + lastTag + ">";
+                    lastTag = xmlTags.back();
+                    xmlTags.pop_back();
+                    valueBufferAppendXmlTag("</", 2, lastTag, ">", 1, offset);
                 }
-
-                valueBufferCheck(out.length(), offset);
-                valueBufferAppend(out.c_str(), out.length());
                 ++pos;
                 continue;
             }
@@ -2314,11 +2524,9 @@ namespace OpenLogReplicator {
 
             // repeat last tag
             if (data[pos] >= 0xD4 && data[pos] <= 0xD5) {
-                tags.push_back(lastTag);
-                out = "<" + lastTag;
+                xmlTags.push_back(lastTag);
+                valueBufferAppendXmlTag("<", 1, lastTag, "", 0, offset);
                 tagOpen = true;
-                valueBufferCheck(out.length(), offset);
-                valueBufferAppend(out.c_str(), out.length());
                 ++pos;
                 continue;
             }
@@ -2335,10 +2543,91 @@ namespace OpenLogReplicator {
         return true;
     }
 
-    void Builder::releaseBuffers(uint64_t maxId) {
+    void Builder::appendSegment(Builder* segment, typeScn newLwnScn, typeIdx newLwnIdx) {
+        lastXid = segment->lastXid;
+        commitScn = segment->commitScn;
+        lwnScn = newLwnScn;
+        lwnIdx = newLwnIdx;
+
+        // Copy messages from the private queue, message ids are assigned in output order, LWN positions are the same as used by the worker
+        BuilderQueue* builderQueue = segment->firstBuilderQueue;
+        uint64_t position = 0;
+        while (builderQueue != nullptr) {
+            if (position + sizeof(struct BuilderMsg) > builderQueue->length) {
+                builderQueue = builderQueue->next;
+                position = 0;
+                continue;
+            }
+
+            const BuilderMsg* segmentMsg = reinterpret_cast<const BuilderMsg*>(builderQueue->data + position);
+            builderBegin(segmentMsg->scn, segmentMsg->sequence, segmentMsg->obj, segmentMsg->flags);
+            uint64_t length = segmentMsg->length;
+            uint64_t tagLength = segmentMsg->tagLength;
+            position += sizeof(struct BuilderMsg);
+            msgTag.clear();
+
+            // Big message continues in the next buffer
+            while (length + tagLength > 0) {
+                if (position == builderQueue->length) {
+                    builderQueue = builderQueue->next;
+                    position = 0;
+                }
+
+                if (length > 0) {
+                    uint64_t partLength = std::min(length, builderQueue->length - position);
+                    append(reinterpret_cast<const char*>(builderQueue->data + position), partLength);
+                    position += partLength;
+                    length -= partLength;
+                } else {
+                    uint64_t partLength = std::min(tagLength, builderQueue->length - position);
+                    msgTag.append(reinterpret_cast<const char*>(builderQueue->data + position), partLength);
+                    position += partLength;
+                    tagLength -= partLength;
+                }
+            }
+
+            builderCommit(false);
+            position = (position + 7) & 0xFFFFFFFFFFFFFFF8;
+        }
+        wakeUp();
+        unconfirmedLength = 0;
+
+        // Leave one empty buffer for the next transaction
+        while (segment->firstBuilderQueue != segment->lastBuilderQueue) {
+            BuilderQueue* nextBuffer = segment->firstBuilderQueue->next;
+            ctx->freeMemoryChunk(Ctx::MEMORY_MODULE_BUILDER, reinterpret_cast<uint8_t*>(segment->firstBuilderQueue), true);
+            segment->firstBuilderQueue = nextBuffer;
+            --segment->buffersAllocated;
+        }
+        segment->firstBuilderQueue->length = 0;
+        segment->firstBuilderQueue->start = 0;
+        segment->unconfirmedLength = 0;
+    }
+
+    uint64_t Builder::registerWriter() {
+        std::unique_lock<std::mutex> lck(mtx);
+        writersConfirmedId.push_back(0);
+        return writersConfirmedId.size() - 1;
+    }
+
+    uint64_t Builder::getWriters() {
+        std::unique_lock<std::mutex> lck(mtx);
+        return writersConfirmedId.size();
+    }
+
+    void Builder::releaseBuffers(uint64_t writer, uint64_t maxId) {
         BuilderQueue* builderQueue;
         {
             std::unique_lock<std::mutex> lck(mtx);
+            if (maxId <= writersConfirmedId[writer])
+                return;
+            writersConfirmedId[writer] = maxId;
+
+            // The slowest writer decides which buffers are no longer needed
+            for (uint64_t confirmedId: writersConfirmedId)
+                if (confirmedId < maxId)
+                    maxId = confirmedId;
+
             builderQueue = firstBuilderQueue;
             while (firstBuilderQueue->id < maxId) {
                 firstBuilderQueue = firstBuilderQueue->next;
@@ -2366,8 +2655,17 @@ namespace OpenLogReplicator {
             condNoWriterWork.wait_for(lck, std::chrono::seconds(5));
     }
 
+    void Builder::setWakeUpFD(int newWakeUpFD) {
+        // No signal is in flight when the descriptor is replaced, so the old one can be closed after return
+        std::unique_lock<std::mutex> lck(mtx);
+        wakeUpFD.store(newWakeUpFD, std::memory_order_relaxed);
+    }
+
     void Builder::wakeUp() {
         std::unique_lock<std::mutex> lck(mtx);
         condNoWriterWork.notify_all();
+        int fd = wakeUpFD.load(std::memory_order_relaxed);
+        if (fd != -1)
+            eventfd_write(fd, 1);
     }
 }
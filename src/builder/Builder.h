@@ -22,8 +22,10 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 #include <cstring>
 #include <map>
 #include <mutex>
+#include <sys/eventfd.h>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "../common/Ctx.h"
 #include "../common/LobCtx.h"
@@ -35,6 +37,8 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 #include "../common/typeRowId.h"
 #include "../common/typeXid.h"
 #include "../common/exception/RedoLogException.h"
+#include "../common/expression/Condition.h"
+#include "../common/expression/Expression.h"
 #include "../locales/CharacterSet.h"
 #include "../locales/Locales.h"
 
@@ -45,8 +49,10 @@ namespace OpenLogReplicator {
     class Ctx;
     class CharacterSet;
     class Locales;
+    class OracleColumn;
     class OracleTable;
     class Builder;
+    class BuilderPool;
     class Metadata;
     class SystemTransaction;
     class XmlCtx;
@@ -72,6 +78,19 @@ namespace OpenLogReplicator {
         typeObj obj;
         uint16_t pos;
         uint16_t flags;
+        // Routing information stored after the message data: owner '\0' table '\0' key
+        uint32_t tagLength;
+    };
+
+    struct BuilderTimestamp {
+        time_t timestamp;
+        uint64_t length;
+        char buffer[22];
+    };
+
+    struct BuilderXmlTag {
+        const std::string* prefix;
+        const std::string* name;
     };
 
     class Builder {
@@ -81,13 +100,27 @@ namespace OpenLogReplicator {
         static constexpr uint16_t OUTPUT_BUFFER_MESSAGE_ALLOCATED = 0x0001;
         static constexpr uint16_t OUTPUT_BUFFER_MESSAGE_CONFIRMED = 0x0002;
         static constexpr uint16_t OUTPUT_BUFFER_MESSAGE_CHECKPOINT = 0x0004;
+        static constexpr uint16_t OUTPUT_BUFFER_MESSAGE_COPY = 0x0008;
+        static constexpr uint16_t OUTPUT_BUFFER_MESSAGE_SPLIT = 0x0010;
 
     protected:
         static constexpr uint64_t BUFFER_START_UNDEFINED = 0xFFFFFFFFFFFFFFFF;
 
+        // Type of column value in formats with a declared schema
+        static constexpr uint8_t LOGICAL_TYPE_NONE = 0;
+        static constexpr uint8_t LOGICAL_TYPE_BOOLEAN = 1;
+        static constexpr uint8_t LOGICAL_TYPE_INT64 = 2;
+        static constexpr uint8_t LOGICAL_TYPE_FLOAT = 3;
+        static constexpr uint8_t LOGICAL_TYPE_DOUBLE = 4;
+        static constexpr uint8_t LOGICAL_TYPE_BINARY = 5;
+        static constexpr uint8_t LOGICAL_TYPE_STRING = 6;
+        static constexpr uint8_t LOGICAL_TYPE_TIMESTAMP = 7;
+
         static constexpr uint64_t VALUE_BUFFER_MIN = 1048576;
         static constexpr uint64_t VALUE_BUFFER_MAX = 4294967296;
 
+        static constexpr uint64_t TIMESTAMP_CACHE_SIZE = 16;
+
         static constexpr uint8_t XML_HEADER_STANDALONE = 0x01;
         static constexpr uint8_t XML_HEADER_XMLDECL = 0x02;
         static constexpr uint8_t XML_HEADER_ENCODING = 0x04;
@@ -136,8 +169,12 @@ namespace OpenLogReplicator {
         typeXid lastXid;
         uint64_t valuesSet[Ctx::COLUMN_LIMIT_23_0 / sizeof(uint64_t)];
         uint64_t valuesMerge[Ctx::COLUMN_LIMIT_23_0 / sizeof(uint64_t)];
+        // Columns of the update with different before and after value
+        uint64_t valuesChanged[Ctx::COLUMN_LIMIT_23_0 / sizeof(uint64_t)];
         int64_t lengths[Ctx::COLUMN_LIMIT_23_0][4];
         uint8_t* values[Ctx::COLUMN_LIMIT_23_0][4];
+        ExpressionRow conditionRow;
+        ConditionCache conditionCache;
         uint64_t lengthsPart[3][Ctx::COLUMN_LIMIT_23_0][4];
         uint8_t* valuesPart[3][Ctx::COLUMN_LIMIT_23_0][4];
         uint64_t valuesMax;
@@ -152,12 +189,40 @@ namespace OpenLogReplicator {
         uint8_t prevChars[CharacterSet::MAX_CHARACTER_LENGTH * 2];
         uint64_t prevCharsSize;
         const std::unordered_map<std::string, std::string>* attributes;
+        // Recently rendered seconds, commit timestamps and DATE values repeat a lot
+        BuilderTimestamp timestampCache[TIMESTAMP_CACHE_SIZE];
+        // Messages about one table carry the table name and the primary key for the writer
+        bool messageTags;
+        const OracleTable* tagTable;
+        std::string msgTag;
+        // Big LOB values are written to side files instead of the message
+        std::string lobFilePath;
+        uint64_t lobFileMinBytes;
+        std::string lobFileName;
+        uint64_t lobFileLength;
+        int lobFileDes;
+        bool lobFileActive;
+        // Open tags and namespaces of the XML document being decoded, reused between documents
+        std::vector<BuilderXmlTag> xmlTags;
+        std::unordered_map<uint64_t, uint64_t> xmlDictNmSpc;
+        std::unordered_map<uint64_t, std::string> xmlNmSpcPrefix;
 
         std::mutex mtx;
         std::condition_variable condNoWriterWork;
+        // Event descriptor of a writer waiting for the output together with other events, signaled and changed under mtx
+        std::atomic<int> wakeUpFD;
+        // Queue id confirmed by every writer reading the output, buffers are released when all writers moved past them
+        std::vector<uint64_t> writersConfirmedId;
 
         double decodeFloat(const uint8_t* data);
         long double decodeDouble(const uint8_t* data);
+        void lobFileBegin(const OracleTable* table, typeCol col);
+        void lobFileWrite(uint64_t offset);
+        bool lobFileEnd(bool complete, uint64_t offset);
+        [[nodiscard]] uint8_t getLogicalType(const OracleColumn* column) const;
+        [[nodiscard]] bool parseInt64(const std::string& columnName, int64_t& value);
+        [[nodiscard]] std::string formatTimestampTz(time_t timestamp, uint64_t fraction, const char* tz);
+        [[nodiscard]] std::string formatXid() const;
 
         inline void builderRotate(bool copy) {
             auto nextBuffer = reinterpret_cast<BuilderQueue*>(ctx->getMemoryChunk(Ctx::MEMORY_MODULE_BUILDER, true));
@@ -189,6 +254,25 @@ namespace OpenLogReplicator {
 
         void processValue(LobCtx* lobCtx, const XmlCtx* xmlCtx, const OracleTable* table, typeCol col, const uint8_t* data, uint64_t length, uint64_t offset,
                           bool after, bool compressed);
+        void messageTagBegin(typeObj obj);
+
+        inline uint64_t epochToIso8601(time_t timestamp, char* buffer, bool addT, bool addZ) {
+            BuilderTimestamp& cached = timestampCache[static_cast<uint64_t>(timestamp) & (TIMESTAMP_CACHE_SIZE - 1)];
+            if (cached.length == 0 || cached.timestamp != timestamp) {
+                cached.length = ctx->epochToIso8601(timestamp, cached.buffer, false, false);
+                cached.timestamp = timestamp;
+            }
+
+            // (-)YYYY-MM-DD hh:mm:ss, the separator is always 9 characters from the end
+            uint64_t length = cached.length;
+            memcpy(buffer, cached.buffer, length);
+            if (addT)
+                buffer[length - 9] = 'T';
+            if (addZ)
+                buffer[length++] = 'Z';
+            buffer[length] = 0;
+            return length;
+        }
 
         inline void valuesRelease() {
             for (uint64_t i = 0; i < mergesMax; ++i)
@@ -197,6 +281,7 @@ namespace OpenLogReplicator {
 
             uint64_t baseMax = valuesMax >> 6;
             for (uint64_t base = 0; base <= baseMax; ++base) {
+                valuesChanged[base] = 0;
                 auto column = static_cast<typeCol>(base << 6);
                 for (uint64_t mask = 1; mask != 0; mask <<= 1, ++column) {
                     if (valuesSet[base] < mask)
@@ -214,6 +299,7 @@ namespace OpenLogReplicator {
             valuesMax = 0;
             compressedBefore = false;
             compressedAfter = false;
+            tagTable = nullptr;
         };
 
         inline void valueSet(uint64_t type, uint16_t column, uint8_t* data, uint16_t length, uint8_t fb, bool dump) {
@@ -291,22 +377,34 @@ namespace OpenLogReplicator {
             msg->lwnIdx = lwnIdx++;
             msg->sequence = sequence;
             msg->length = 0;
-            msg->id = id++;
             msg->obj = obj;
             msg->pos = 0;
             msg->flags = flags;
+            msg->tagLength = 0;
             msg->data = lastBuilderQueue->data + lastBuilderQueue->length + sizeof(struct BuilderMsg);
+            if (messageTags)
+                messageTagBegin(obj);
         };
 
         inline void builderCommit(bool force) {
-            messageLength += messagePosition;
-            if (messageLength == sizeof(struct BuilderMsg))
+            if (messageLength + messagePosition == sizeof(struct BuilderMsg))
                 throw RedoLogException(50058, "output buffer - commit of empty transaction");
 
+            // Id is taken on commit, a message abandoned after an error leaves no gap in the sequence seen by the writer
+            msg->id = id++;
+
+            uint64_t tagLength = 0;
+            if (messageTags && !msgTag.empty()) {
+                tagLength = msgTag.length();
+                append(msgTag);
+            }
+
+            messageLength += messagePosition;
             msg->queueId = lastBuilderQueue->id;
             builderShiftFast((8 - (messagePosition & 7)) & 7);
             unconfirmedLength += messageLength;
-            msg->length = messageLength - sizeof(struct BuilderMsg);
+            msg->length = messageLength - sizeof(struct BuilderMsg) - tagLength;
+            msg->tagLength = tagLength;
             lastBuilderQueue->length += messagePosition;
             if (lastBuilderQueue->start == BUFFER_START_UNDEFINED)
                 lastBuilderQueue->start = static_cast<uint64_t>(lastBuilderQueue->length);
@@ -315,6 +413,9 @@ namespace OpenLogReplicator {
                 {
                     std::unique_lock<std::mutex> lck(mtx);
                     condNoWriterWork.notify_all();
+                    int fd = wakeUpFD.load(std::memory_order_relaxed);
+                    if (fd != -1)
+                        eventfd_write(fd, 1);
                 }
                 unconfirmedLength = 0;
             }
@@ -355,16 +456,43 @@ namespace OpenLogReplicator {
             valueLength = 1;
             columnString(columnName);
             if (unknownFormat == UNKNOWN_FORMAT_DUMP) {
-                std::ostringstream ss;
-                for (uint64_t j = 0; j < length; ++j)
-                    ss << " " << std::hex << std::setfill('0') << std::setw(2) << (static_cast<uint64_t>(data[j]));
-                ctx->warning(60002, "unknown value (column: " + columnName + "): " + std::to_string(length) + " - " + ss.str());
+                std::string str;
+                str.reserve(length * 3);
+                for (uint64_t j = 0; j < length; ++j) {
+                    str.push_back(' ');
+                    str.push_back(Ctx::map16(data[j] >> 4));
+                    str.push_back(Ctx::map16(data[j] & 0x0F));
+                }
+                ctx->warning(60002, "unknown value (column: " + columnName + "): " + std::to_string(length) + " - " + str);
             }
         };
 
         inline void valueBufferAppend(const char* text, uint64_t length) {
-            for (uint64_t i = 0; i < length; ++i)
-                valueBufferAppend(*text++);
+            memcpy(reinterpret_cast<void*>(valueBuffer + valueLength), reinterpret_cast<const void*>(text), length);
+            valueLength += length;
+        };
+
+        inline void valueBufferAppend(const std::string& text) {
+            valueBufferAppend(text.c_str(), text.length());
+        };
+
+        inline void valueBufferAppendXmlTag(const char* begin, uint64_t beginLength, const BuilderXmlTag& tag, const char* end, uint64_t endLength,
+                                            uint64_t offset) {
+            uint64_t length = beginLength + endLength;
+            if (tag.prefix != nullptr)
+                length += tag.prefix->length() + 1;
+            if (tag.name != nullptr)
+                length += tag.name->length();
+            valueBufferCheck(length, offset);
+
+            valueBufferAppend(begin, beginLength);
+            if (tag.prefix != nullptr) {
+                valueBufferAppend(*tag.prefix);
+                valueBufferAppend(':');
+            }
+            if (tag.name != nullptr)
+                valueBufferAppend(*tag.name);
+            valueBufferAppend(end, endLength);
         };
 
         inline void valueBufferAppend(uint8_t value) {
@@ -558,7 +686,9 @@ namespace OpenLogReplicator {
                     return true;
                 }
                 LobData* lobData = lobsIt->second;
-                valueBufferCheck(static_cast<uint64_t>(lobData->pageSize) * static_cast<uint64_t>(lobData->sizePages) + lobData->sizeRest, offset);
+                // Value written to a side file is reserved chunk by chunk
+                if (!lobFileActive)
+                    valueBufferCheck(static_cast<uint64_t>(lobData->pageSize) * static_cast<uint64_t>(lobData->sizePages) + lobData->sizeRest, offset);
 
                 uint32_t pageNo = 0;
                 for (auto indexMapIt: lobData->indexMap) {
@@ -1151,6 +1281,10 @@ namespace OpenLogReplicator {
         };
 
         inline void valueBufferCheck(uint64_t length, uint64_t offset) {
+            // Parsed part of the LOB is moved to the side file, the buffer is reused for the next chunks
+            if (lobFileActive && valueLength + length > lobFileMinBytes)
+                lobFileWrite(offset);
+
             if (valueLength + length > VALUE_BUFFER_MAX)
                 throw RedoLogException(50012, "trying to allocate length for value: " + std::to_string(valueLength + length) +
                                               " exceeds maximum: " + std::to_string(VALUE_BUFFER_MAX) + " at offset: " + std::to_string(offset));
@@ -1187,6 +1321,7 @@ namespace OpenLogReplicator {
         virtual void columnRowId(const std::string& columnName, typeRowId rowId) = 0;
         virtual void columnTimestamp(const std::string& columnName, time_t timestamp, uint64_t fraction) = 0;
         virtual void columnTimestampTz(const std::string& columnName, time_t timestamp, uint64_t fraction, const char* tz) = 0;
+        virtual void columnLobFile(const std::string& columnName);
         virtual void processInsert(typeScn scn, typeSeq sequence, time_t timestamp, LobCtx* lobCtx, const XmlCtx* xmlCtx, const OracleTable* table, typeObj obj,
                                    typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid, uint64_t offset) = 0;
         virtual void processUpdate(typeScn scn, typeSeq sequence, time_t timestamp, LobCtx* lobCtx, const XmlCtx* xmlCtx, const OracleTable* table, typeObj obj,
@@ -1245,6 +1380,8 @@ namespace OpenLogReplicator {
         static constexpr uint64_t MESSAGE_FORMAT_SKIP_BEGIN = 4;
         static constexpr uint64_t MESSAGE_FORMAT_SKIP_COMMIT = 8;
         static constexpr uint64_t MESSAGE_FORMAT_ADD_OFFSET = 16;
+        static constexpr uint64_t MESSAGE_FORMAT_BATCH = 32;
+        static constexpr uint64_t MESSAGE_FORMAT_CHANGED = 64;
 
         static constexpr uint64_t RID_FORMAT_SKIP = 0;
         static constexpr uint64_t RID_FORMAT_TEXT = 1;
@@ -1314,6 +1451,7 @@ namespace OpenLogReplicator {
         static constexpr uint64_t XID_FORMAT_NUMERIC = 2;
 
         SystemTransaction* systemTransaction;
+        BuilderPool* pool;
         uint64_t buffersAllocated;
         BuilderQueue* firstBuilderQueue;
         BuilderQueue* lastBuilderQueue;
@@ -1329,6 +1467,9 @@ namespace OpenLogReplicator {
         [[nodiscard]] uint64_t builderSize() const;
         [[nodiscard]] uint64_t getMaxMessageMb() const;
         void setMaxMessageMb(uint64_t maxMessageMb);
+        [[nodiscard]] bool getMessageTags() const;
+        void setMessageTags(bool newMessageTags);
+        void setLobFile(const std::string& newLobFilePath, uint64_t newLobFileMinBytes);
         void processBegin(typeXid xid, typeScn scn, typeScn newLwnScn, const std::unordered_map<std::string, std::string>* newAttributes);
         void processInsertMultiple(typeScn scn, typeSeq sequence, time_t timestamp, LobCtx* lobCtx, const XmlCtx* xmlCtx, const RedoLogRecord* redoLogRecord1,
                                    const RedoLogRecord* redoLogRecord2, bool system, bool schema, bool dump);
@@ -1337,11 +1478,15 @@ namespace OpenLogReplicator {
         void processDml(typeScn scn, typeSeq sequence, time_t timestamp, LobCtx* lobCtx, const XmlCtx* xmlCtx, const RedoLogRecord* redoLogRecord1,
                         const RedoLogRecord* redoLogRecord2, uint64_t type, bool system, bool schema, bool dump);
         void processDdlHeader(typeScn scn, typeSeq sequence, time_t timestamp, const RedoLogRecord* redoLogRecord1);
+        void appendSegment(Builder* segment, typeScn newLwnScn, typeIdx newLwnIdx);
         virtual void initialize();
         virtual void processCommit(typeScn scn, typeSeq sequence, time_t timestamp) = 0;
         virtual void processCheckpoint(typeScn scn, typeSeq sequence, time_t timestamp, uint64_t offset, bool redo) = 0;
-        void releaseBuffers(uint64_t maxId);
+        [[nodiscard]] uint64_t registerWriter();
+        [[nodiscard]] uint64_t getWriters();
+        void releaseBuffers(uint64_t writer, uint64_t maxId);
         void sleepForWriterWork(uint64_t queueSize, uint64_t nanoseconds);
+        void setWakeUpFD(int newWakeUpFD);
         void wakeUp();
 
         friend class SystemTransaction;
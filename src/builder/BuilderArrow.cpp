@@ -0,0 +1,848 @@
+/* Memory buffer for handling output data in Arrow IPC format
+   Copyright (C) 2018-2024 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include "../common/OracleColumn.h"
+#include "../common/OracleTable.h"
+#include "../common/typeRowId.h"
+#include "../metadata/Metadata.h"
+#include "BuilderArrow.h"
+
+namespace OpenLogReplicator {
+    BuilderArrow::FlatBuffer::FlatBuffer() :
+            head(0),
+            minAlign(8),
+            tableStart(0) {
+    }
+
+    void BuilderArrow::FlatBuffer::clear() {
+        head = buffer.size();
+        minAlign = 8;
+        fields.clear();
+    }
+
+    void BuilderArrow::FlatBuffer::grow(uint64_t length) {
+        if (head >= length)
+            return;
+
+        uint64_t used = buffer.size() - head;
+        uint64_t capacity = buffer.size() * 2;
+        if (capacity < used + length)
+            capacity = used + length;
+        if (capacity < 1024)
+            capacity = 1024;
+
+        std::vector<uint8_t> newBuffer(capacity);
+        if (used > 0)
+            memcpy(reinterpret_cast<void*>(newBuffer.data() + capacity - used), reinterpret_cast<const void*>(buffer.data() + head), used);
+        buffer.swap(newBuffer);
+        head = capacity - used;
+    }
+
+    void BuilderArrow::FlatBuffer::align(uint64_t alignment, uint64_t additional) {
+        if (alignment > minAlign)
+            minAlign = alignment;
+
+        uint64_t padding = (alignment - ((size() + additional) & (alignment - 1))) & (alignment - 1);
+        grow(padding);
+        for (uint64_t i = 0; i < padding; ++i)
+            buffer[--head] = 0;
+    }
+
+    void BuilderArrow::FlatBuffer::pushValue(uint64_t value, uint64_t length) {
+        align(length, 0);
+        grow(length);
+        head -= length;
+        for (uint64_t i = 0; i < length; ++i, value >>= 8)
+            buffer[head + i] = static_cast<uint8_t>(value & 0xFF);
+    }
+
+    void BuilderArrow::FlatBuffer::pushOffset(uint32_t target) {
+        align(sizeof(uint32_t), 0);
+        pushValue(size() + sizeof(uint32_t) - target, sizeof(uint32_t));
+    }
+
+    uint32_t BuilderArrow::FlatBuffer::createString(const std::string& str) {
+        align(sizeof(uint32_t), str.length() + 1);
+        grow(str.length() + 1);
+        buffer[--head] = 0;
+        head -= str.length();
+        memcpy(reinterpret_cast<void*>(buffer.data() + head), reinterpret_cast<const void*>(str.c_str()), str.length());
+        pushValue(str.length(), sizeof(uint32_t));
+        return size();
+    }
+
+    uint32_t BuilderArrow::FlatBuffer::createOffsetVector(const std::vector<uint32_t>& offsets) {
+        align(sizeof(uint32_t), offsets.size() * sizeof(uint32_t));
+        for (auto it = offsets.rbegin(); it != offsets.rend(); ++it)
+            pushOffset(*it);
+        pushValue(offsets.size(), sizeof(uint32_t));
+        return size();
+    }
+
+    uint32_t BuilderArrow::FlatBuffer::createStructVector(const std::vector<std::pair<int64_t, int64_t>>& structs) {
+        align(sizeof(uint32_t), structs.size() * 2 * sizeof(int64_t));
+        align(sizeof(int64_t), structs.size() * 2 * sizeof(int64_t));
+        for (auto it = structs.rbegin(); it != structs.rend(); ++it) {
+            pushValue(static_cast<uint64_t>(it->second), sizeof(int64_t));
+            pushValue(static_cast<uint64_t>(it->first), sizeof(int64_t));
+        }
+        pushValue(structs.size(), sizeof(uint32_t));
+        return size();
+    }
+
+    void BuilderArrow::FlatBuffer::startTable() {
+        fields.clear();
+        tableStart = size();
+    }
+
+    void BuilderArrow::FlatBuffer::addBool(uint16_t slot, bool value) {
+        pushValue(value ? 1 : 0, sizeof(uint8_t));
+        fields.emplace_back(slot, size());
+    }
+
+    void BuilderArrow::FlatBuffer::addUInt8(uint16_t slot, uint8_t value) {
+        pushValue(value, sizeof(uint8_t));
+        fields.emplace_back(slot, size());
+    }
+
+    void BuilderArrow::FlatBuffer::addInt16(uint16_t slot, int16_t value) {
+        pushValue(static_cast<uint16_t>(value), sizeof(int16_t));
+        fields.emplace_back(slot, size());
+    }
+
+    void BuilderArrow::FlatBuffer::addInt32(uint16_t slot, int32_t value) {
+        pushValue(static_cast<uint32_t>(value), sizeof(int32_t));
+        fields.emplace_back(slot, size());
+    }
+
+    void BuilderArrow::FlatBuffer::addInt64(uint16_t slot, int64_t value) {
+        pushValue(static_cast<uint64_t>(value), sizeof(int64_t));
+        fields.emplace_back(slot, size());
+    }
+
+    void BuilderArrow::FlatBuffer::addOffset(uint16_t slot, uint32_t target) {
+        pushOffset(target);
+        fields.emplace_back(slot, size());
+    }
+
+    uint32_t BuilderArrow::FlatBuffer::endTable() {
+        // Placeholder for vtable offset
+        pushValue(0, sizeof(int32_t));
+        uint32_t tableOffset = size();
+
+        uint16_t slots = 0;
+        for (const auto& field: fields)
+            if (field.first >= slots)
+                slots = static_cast<uint16_t>(field.first + 1);
+        std::vector<uint16_t> vtable(slots, 0);
+        for (const auto& field: fields)
+            vtable[field.first] = static_cast<uint16_t>(tableOffset - field.second);
+
+        for (auto it = vtable.rbegin(); it != vtable.rend(); ++it)
+            pushValue(*it, sizeof(uint16_t));
+        pushValue(tableOffset - tableStart, sizeof(uint16_t));
+        pushValue((slots + 2) * sizeof(uint16_t), sizeof(uint16_t));
+        uint32_t vtableOffset = size();
+
+        uint32_t soffset = vtableOffset - tableOffset;
+        uint64_t pos = buffer.size() - tableOffset;
+        for (uint64_t i = 0; i < sizeof(int32_t); ++i, soffset >>= 8)
+            buffer[pos + i] = static_cast<uint8_t>(soffset & 0xFF);
+
+        fields.clear();
+        return tableOffset;
+    }
+
+    void BuilderArrow::FlatBuffer::finish(uint32_t root) {
+        align(minAlign, sizeof(uint32_t));
+        pushOffset(root);
+    }
+
+    BuilderArrow::BuilderArrow(Ctx* newCtx, Locales* newLocales, Metadata* newMetadata, uint64_t newDbFormat, uint64_t newAttributesFormat,
+                               uint64_t newIntervalDtsFormat, uint64_t newIntervalYtmFormat, uint64_t newMessageFormat, uint64_t newRidFormat,
+                               uint64_t newXidFormat, uint64_t newTimestampFormat, uint64_t newTimestampTzFormat, uint64_t newTimestampAll,
+                               uint64_t newCharFormat, uint64_t newScnFormat, uint64_t newScnAll, uint64_t newUnknownFormat, uint64_t newSchemaFormat,
+                               uint64_t newColumnFormat, uint64_t newUnknownType, uint64_t newFlushBuffer, uint64_t newBatchRows, uint64_t newBatchBytes,
+                               uint64_t newBatchInterval) :
+            Builder(newCtx, newLocales, newMetadata, newDbFormat, newAttributesFormat, newIntervalDtsFormat, newIntervalYtmFormat, newMessageFormat,
+                    newRidFormat, newXidFormat, newTimestampFormat, newTimestampTzFormat, newTimestampAll, newCharFormat, newScnFormat, newScnAll,
+                    newUnknownFormat, newSchemaFormat, newColumnFormat, newUnknownType, newFlushBuffer),
+            batchRows(newBatchRows),
+            batchBytes(newBatchBytes),
+            batchInterval(newBatchInterval),
+            controlTable(nullptr),
+            pendingRows(0),
+            pendingBytes(0),
+            pendingTimestamp(0),
+            pendingScn(Ctx::ZERO_SCN),
+            pendingSequence(0),
+            pendingLwnScn(Ctx::ZERO_SCN),
+            pendingLwnIdx(0),
+            columnArray(nullptr),
+            columnWritten(false) {
+    }
+
+    BuilderArrow::~BuilderArrow() {
+        pendingTables.clear();
+        for (auto& arrowTableIt: arrowTables) {
+            ArrowTable* arrowTable = arrowTableIt.second;
+            for (ArrowColumn* column: arrowTable->columns)
+                arrowDelete(column);
+            delete arrowTable;
+        }
+        arrowTables.clear();
+
+        if (controlTable != nullptr) {
+            for (ArrowColumn* column: controlTable->columns)
+                arrowDelete(column);
+            delete controlTable;
+            controlTable = nullptr;
+        }
+    }
+
+    void BuilderArrow::initialize() {
+        Builder::initialize();
+
+        controlTable = new ArrowTable();
+        controlTable->table = nullptr;
+        controlTable->version = 0;
+        controlTable->before = nullptr;
+        controlTable->after = nullptr;
+        controlTable->columns.push_back(arrowColumn("op", ARROW_TYPE_UTF8, false));
+        controlTable->columns.push_back(arrowColumn("scn", ARROW_TYPE_UINT64, false));
+        controlTable->columns.push_back(arrowColumn("tm", ARROW_TYPE_TIMESTAMP_UTC, false));
+        controlTable->columns.push_back(arrowColumn("seq", ARROW_TYPE_UINT64, true));
+        controlTable->columns.push_back(arrowColumn("offset", ARROW_TYPE_UINT64, true));
+        controlTable->columns.push_back(arrowColumn("redo", ARROW_TYPE_BOOL, true));
+        controlTable->columns.push_back(arrowColumn("owner", ARROW_TYPE_UTF8, true));
+        controlTable->columns.push_back(arrowColumn("table", ARROW_TYPE_UTF8, true));
+        controlTable->columns.push_back(arrowColumn("sql", ARROW_TYPE_UTF8, true));
+    }
+
+    BuilderArrow::ArrowColumn* BuilderArrow::arrowColumn(const std::string& name, uint8_t type, bool nullable) {
+        auto column = new ArrowColumn();
+        column->name = name;
+        column->type = type;
+        column->nullable = nullable;
+        column->length = 0;
+        column->nullCount = 0;
+        if (type == ARROW_TYPE_UTF8 || type == ARROW_TYPE_BINARY)
+            arrowAppend(column->offsets, 0, sizeof(int32_t));
+        return column;
+    }
+
+    void BuilderArrow::arrowDelete(ArrowColumn* column) {
+        for (ArrowColumn* child: column->children)
+            arrowDelete(child);
+        column->children.clear();
+        delete column;
+    }
+
+    void BuilderArrow::arrowReset(ArrowColumn* column) {
+        column->length = 0;
+        column->nullCount = 0;
+        column->validity.clear();
+        column->data.clear();
+        if (column->type == ARROW_TYPE_UTF8 || column->type == ARROW_TYPE_BINARY) {
+            column->offsets.clear();
+            arrowAppend(column->offsets, 0, sizeof(int32_t));
+        }
+        for (ArrowColumn* child: column->children)
+            arrowReset(child);
+    }
+
+    void BuilderArrow::arrowNull(ArrowColumn* column) {
+        switch (column->type) {
+            case ARROW_TYPE_BOOL:
+                if ((column->length & 7) == 0)
+                    column->data.push_back(0);
+                break;
+
+            case ARROW_TYPE_FLOAT:
+                arrowAppend(column->data, 0, sizeof(float));
+                break;
+
+            case ARROW_TYPE_INT64:
+            case ARROW_TYPE_UINT64:
+            case ARROW_TYPE_DOUBLE:
+            case ARROW_TYPE_TIMESTAMP:
+            case ARROW_TYPE_TIMESTAMP_UTC:
+                arrowAppend(column->data, 0, sizeof(int64_t));
+                break;
+
+            case ARROW_TYPE_BINARY:
+            case ARROW_TYPE_UTF8:
+                arrowAppend(column->offsets, column->data.length(), sizeof(int32_t));
+                break;
+
+            case ARROW_TYPE_STRUCT:
+                for (ArrowColumn* child: column->children)
+                    arrowNull(child);
+                break;
+        }
+        arrowValid(column, false);
+    }
+
+    BuilderArrow::ArrowTable* BuilderArrow::getArrowTable(const OracleTable* table) {
+        auto arrowTablesIt = arrowTables.find(table->obj);
+        if (arrowTablesIt != arrowTables.end()) {
+            if (arrowTablesIt->second->version == table->version)
+                return arrowTablesIt->second;
+
+            // Table definition changed after DDL or dictionary reload, rows collected so far use the previous definition
+            dropArrowTable(table->obj);
+        }
+
+        auto arrowTable = new ArrowTable();
+        arrowTable->table = table;
+        arrowTable->version = table->version;
+        arrowTable->owner = table->owner;
+        arrowTable->name = table->name;
+        arrowTable->columns.push_back(arrowColumn("op", ARROW_TYPE_UTF8, false));
+        arrowTable->columns.push_back(arrowColumn("scn", ARROW_TYPE_UINT64, false));
+        arrowTable->columns.push_back(arrowColumn("tm", ARROW_TYPE_TIMESTAMP_UTC, false));
+        arrowTable->columns.push_back(arrowColumn("xid", ARROW_TYPE_UTF8, false));
+        arrowTable->columns.push_back(arrowColumn("rid", ARROW_TYPE_UTF8, true));
+        arrowTable->before = arrowColumn("before", ARROW_TYPE_STRUCT, true);
+        arrowTable->columns.push_back(arrowTable->before);
+        arrowTable->after = arrowColumn("after", ARROW_TYPE_STRUCT, true);
+        arrowTable->columns.push_back(arrowTable->after);
+
+        for (typeCol column = 0; column < static_cast<typeCol>(table->columns.size()); ++column) {
+            const OracleColumn* oracleColumn = table->columns[column];
+            if (oracleColumn == nullptr || !table->isProjected(column))
+                continue;
+
+            uint8_t arrowType = getLogicalType(oracleColumn);
+            if (arrowType == ARROW_TYPE_NONE)
+                continue;
+
+            // Absent column is not distinguishable from null in redo, every value is nullable
+            arrowTable->before->children.push_back(arrowColumn(oracleColumn->name, arrowType, true));
+            arrowTable->after->children.push_back(arrowColumn(oracleColumn->name, arrowType, true));
+            arrowTable->cols.push_back(column);
+        }
+
+        arrowTables.insert_or_assign(table->obj, arrowTable);
+        return arrowTable;
+    }
+
+    void BuilderArrow::dropArrowTable(typeObj obj) {
+        auto arrowTablesIt = arrowTables.find(obj);
+        if (arrowTablesIt == arrowTables.end())
+            return;
+
+        ArrowTable* arrowTable = arrowTablesIt->second;
+        if (arrowTable->columns[0]->length > 0)
+            flush();
+
+        arrowTables.erase(arrowTablesIt);
+        for (ArrowColumn* column: arrowTable->columns)
+            arrowDelete(column);
+        delete arrowTable;
+    }
+
+    void BuilderArrow::appendMeta(ArrowTable* arrowTable, const char* operation, typeScn scn, time_t timestamp, typeDataObj dataObj, typeDba bdba,
+                                  typeSlot slot) {
+        if ((scnFormat & SCN_ALL_COMMIT_VALUE) != 0)
+            scn = commitScn;
+
+        arrowValue(arrowTable->columns[0], operation, strlen(operation));
+        arrowValue(arrowTable->columns[1], scn, sizeof(uint64_t));
+        arrowValue(arrowTable->columns[2], static_cast<uint64_t>(static_cast<int64_t>(timestamp) * 1000000000L), sizeof(int64_t));
+        arrowValue(arrowTable->columns[3], xidStr.c_str(), xidStr.length());
+
+        if (ridFormat == RID_FORMAT_TEXT) {
+            typeRowId rowId(dataObj, bdba, slot);
+            char str[19];
+            rowId.toString(str);
+            arrowValue(arrowTable->columns[4], str, 18);
+        } else
+            arrowNull(arrowTable->columns[4]);
+    }
+
+    void BuilderArrow::appendImage(LobCtx* lobCtx, const XmlCtx* xmlCtx, const ArrowTable* arrowTable, ArrowColumn* image, uint64_t valueType,
+                                   bool compressed, uint64_t offset) {
+        // Compressed row image can't be mapped to table columns
+        if (compressed) {
+            arrowNull(image);
+            return;
+        }
+
+        for (uint64_t i = 0; i < arrowTable->cols.size(); ++i) {
+            typeCol column = arrowTable->cols[i];
+            columnArray = image->children[i];
+            columnWritten = false;
+
+            if (static_cast<uint64_t>(column) < valuesMax && values[column][valueType] != nullptr && lengths[column][valueType] > 0)
+                processValue(lobCtx, xmlCtx, arrowTable->table, column, values[column][valueType], lengths[column][valueType], offset,
+                             valueType == VALUE_AFTER, false);
+
+            if (!columnWritten)
+                arrowNull(columnArray);
+        }
+        columnArray = nullptr;
+        arrowValid(image, true);
+    }
+
+    void BuilderArrow::appendRow(typeScn scn, typeSeq sequence, time_t timestamp, ArrowTable* arrowTable) {
+        if (arrowTable->columns[0]->length == 1)
+            pendingTables.push_back(arrowTable);
+        if (pendingRows == 0)
+            pendingTimestamp = timestamp;
+
+        ++pendingRows;
+        pendingScn = scn;
+        pendingSequence = sequence;
+        // Every row takes a position in the stream, like a single message would
+        pendingLwnScn = lwnScn;
+        pendingLwnIdx = lwnIdx++;
+
+        if (pendingRows >= batchRows || pendingBytes >= batchBytes)
+            flush();
+    }
+
+    uint32_t BuilderArrow::appendFbField(const ArrowColumn* column) {
+        std::vector<uint32_t> childOffsets;
+        for (const ArrowColumn* child: column->children)
+            childOffsets.push_back(appendFbField(child));
+        uint32_t children = flatBuffer.createOffsetVector(childOffsets);
+        uint32_t name = flatBuffer.createString(column->name);
+
+        uint8_t typeType;
+        uint32_t type;
+        switch (column->type) {
+            case ARROW_TYPE_BOOL:
+                typeType = FB_TYPE_BOOL;
+                flatBuffer.startTable();
+                type = flatBuffer.endTable();
+                break;
+
+            case ARROW_TYPE_INT64:
+            case ARROW_TYPE_UINT64:
+                typeType = FB_TYPE_INT;
+                flatBuffer.startTable();
+                flatBuffer.addInt32(0, 64);
+                flatBuffer.addBool(1, column->type == ARROW_TYPE_INT64);
+                type = flatBuffer.endTable();
+                break;
+
+            case ARROW_TYPE_FLOAT:
+            case ARROW_TYPE_DOUBLE:
+                typeType = FB_TYPE_FLOATING_POINT;
+                flatBuffer.startTable();
+                flatBuffer.addInt16(0, column->type == ARROW_TYPE_FLOAT ? FB_PRECISION_SINGLE : FB_PRECISION_DOUBLE);
+                type = flatBuffer.endTable();
+                break;
+
+            case ARROW_TYPE_BINARY:
+                typeType = FB_TYPE_BINARY;
+                flatBuffer.startTable();
+                type = flatBuffer.endTable();
+                break;
+
+            case ARROW_TYPE_TIMESTAMP:
+                typeType = FB_TYPE_TIMESTAMP;
+                flatBuffer.startTable();
+                flatBuffer.addInt16(0, FB_TIME_UNIT_NANOSECOND);
+                type = flatBuffer.endTable();
+                break;
+
+            case ARROW_TYPE_TIMESTAMP_UTC: {
+                typeType = FB_TYPE_TIMESTAMP;
+                uint32_t timezone = flatBuffer.createString("UTC");
+                flatBuffer.startTable();
+                flatBuffer.addInt16(0, FB_TIME_UNIT_NANOSECOND);
+                flatBuffer.addOffset(1, timezone);
+                type = flatBuffer.endTable();
+                break;
+            }
+
+            case ARROW_TYPE_STRUCT:
+                typeType = FB_TYPE_STRUCT;
+                flatBuffer.startTable();
+                type = flatBuffer.endTable();
+                break;
+
+            default:
+                typeType = FB_TYPE_UTF8;
+                flatBuffer.startTable();
+                type = flatBuffer.endTable();
+                break;
+        }
+
+        flatBuffer.startTable();
+        flatBuffer.addOffset(0, name);
+        flatBuffer.addBool(1, column->nullable);
+        flatBuffer.addUInt8(2, typeType);
+        flatBuffer.addOffset(3, type);
+        flatBuffer.addOffset(5, children);
+        return flatBuffer.endTable();
+    }
+
+    void BuilderArrow::appendFbBatch(const ArrowColumn* column, int64_t& bodyLength) {
+        fbNodes.emplace_back(column->length, column->nullCount);
+
+        fbBuffers.emplace_back(bodyLength, column->validity.length());
+        bodyLength += static_cast<int64_t>((column->validity.length() + 7) & ~7ULL);
+        if (column->type == ARROW_TYPE_UTF8 || column->type == ARROW_TYPE_BINARY) {
+            fbBuffers.emplace_back(bodyLength, column->offsets.length());
+            bodyLength += static_cast<int64_t>((column->offsets.length() + 7) & ~7ULL);
+        }
+        if (column->type != ARROW_TYPE_STRUCT) {
+            fbBuffers.emplace_back(bodyLength, column->data.length());
+            bodyLength += static_cast<int64_t>((column->data.length() + 7) & ~7ULL);
+        }
+
+        for (const ArrowColumn* child: column->children)
+            appendFbBatch(child, bodyLength);
+    }
+
+    void BuilderArrow::appendBodyBuffer(const std::string& str) {
+        append(str);
+        for (uint64_t i = str.length(); (i & 7) != 0; ++i)
+            append(static_cast<char>(0));
+    }
+
+    void BuilderArrow::appendBody(const ArrowColumn* column) {
+        appendBodyBuffer(column->validity);
+        if (column->type == ARROW_TYPE_UTF8 || column->type == ARROW_TYPE_BINARY)
+            appendBodyBuffer(column->offsets);
+        if (column->type != ARROW_TYPE_STRUCT)
+            appendBodyBuffer(column->data);
+
+        for (const ArrowColumn* child: column->children)
+            appendBody(child);
+    }
+
+    void BuilderArrow::appendFlatBuffer() {
+        // Encapsulated message: continuation marker, metadata length, metadata padded to 8 bytes
+        uint32_t length = flatBuffer.size();
+        for (uint64_t i = 0; i < sizeof(uint32_t); ++i)
+            append(static_cast<char>(0xFF));
+        for (uint64_t i = 0; i < sizeof(uint32_t); ++i, length >>= 8)
+            append(static_cast<char>(length & 0xFF));
+        append(reinterpret_cast<const char*>(flatBuffer.data()), flatBuffer.size());
+    }
+
+    void BuilderArrow::appendStream(const ArrowTable* arrowTable, uint64_t rows) {
+        // Schema message
+        flatBuffer.clear();
+        std::vector<uint32_t> fieldOffsets;
+        for (const ArrowColumn* column: arrowTable->columns)
+            fieldOffsets.push_back(appendFbField(column));
+        uint32_t fields = flatBuffer.createOffsetVector(fieldOffsets);
+
+        std::vector<uint32_t> metadataOffsets;
+        if (arrowTable->table != nullptr) {
+            uint32_t ownerKey = flatBuffer.createString("owner");
+            uint32_t ownerValue = flatBuffer.createString(arrowTable->owner);
+            flatBuffer.startTable();
+            flatBuffer.addOffset(0, ownerKey);
+            flatBuffer.addOffset(1, ownerValue);
+            metadataOffsets.push_back(flatBuffer.endTable());
+
+            uint32_t tableKey = flatBuffer.createString("table");
+            uint32_t tableValue = flatBuffer.createString(arrowTable->name);
+            flatBuffer.startTable();
+            flatBuffer.addOffset(0, tableKey);
+            flatBuffer.addOffset(1, tableValue);
+            metadataOffsets.push_back(flatBuffer.endTable());
+        }
+        uint32_t customMetadata = flatBuffer.createOffsetVector(metadataOffsets);
+
+        flatBuffer.startTable();
+        flatBuffer.addInt16(0, 0);
+        flatBuffer.addOffset(1, fields);
+        flatBuffer.addOffset(2, customMetadata);
+        uint32_t schema = flatBuffer.endTable();
+
+        flatBuffer.startTable();
+        flatBuffer.addInt16(0, FB_METADATA_V5);
+        flatBuffer.addUInt8(1, FB_HEADER_SCHEMA);
+        flatBuffer.addOffset(2, schema);
+        flatBuffer.addInt64(3, 0);
+        flatBuffer.finish(flatBuffer.endTable());
+        appendFlatBuffer();
+
+        // Record batch message
+        fbNodes.clear();
+        fbBuffers.clear();
+        int64_t bodyLength = 0;
+        for (const ArrowColumn* column: arrowTable->columns)
+            appendFbBatch(column, bodyLength);
+
+        flatBuffer.clear();
+        uint32_t nodes = flatBuffer.createStructVector(fbNodes);
+        uint32_t buffers = flatBuffer.createStructVector(fbBuffers);
+        flatBuffer.startTable();
+        flatBuffer.addInt64(0, static_cast<int64_t>(rows));
+        flatBuffer.addOffset(1, nodes);
+        flatBuffer.addOffset(2, buffers);
+        uint32_t recordBatch = flatBuffer.endTable();
+
+        flatBuffer.startTable();
+        flatBuffer.addInt16(0, FB_METADATA_V5);
+        flatBuffer.addUInt8(1, FB_HEADER_RECORD_BATCH);
+        flatBuffer.addOffset(2, recordBatch);
+        flatBuffer.addInt64(3, bodyLength);
+        flatBuffer.finish(flatBuffer.endTable());
+        appendFlatBuffer();
+
+        for (const ArrowColumn* column: arrowTable->columns)
+            appendBody(column);
+
+        // End of stream
+        for (uint64_t i = 0; i < sizeof(uint32_t); ++i)
+            append(static_cast<char>(0xFF));
+        for (uint64_t i = 0; i < sizeof(uint32_t); ++i)
+            append(static_cast<char>(0));
+    }
+
+    void BuilderArrow::flush() {
+        if (pendingRows == 0)
+            return;
+
+        // Batches of all tables are sent in one message confirmed by the last row, so that restart position never skips a pending row
+        builderBegin(pendingScn, pendingSequence, 0, 0);
+        lwnIdx = msg->lwnIdx;
+        msg->lwnScn = pendingLwnScn;
+        msg->lwnIdx = pendingLwnIdx;
+
+        for (ArrowTable* arrowTable: pendingTables) {
+            appendStream(arrowTable, arrowTable->columns[0]->length);
+            for (ArrowColumn* column: arrowTable->columns)
+                arrowReset(column);
+        }
+        builderCommit(true);
+
+        pendingTables.clear();
+        pendingRows = 0;
+        pendingBytes = 0;
+    }
+
+    void BuilderArrow::appendControl(const char* operation, typeScn scn, time_t timestamp) {
+        if ((scnFormat & SCN_ALL_COMMIT_VALUE) != 0)
+            scn = commitScn;
+
+        arrowValue(controlTable->columns[0], operation, strlen(operation));
+        arrowValue(controlTable->columns[1], scn, sizeof(uint64_t));
+        arrowValue(controlTable->columns[2], static_cast<uint64_t>(static_cast<int64_t>(timestamp) * 1000000000L), sizeof(int64_t));
+    }
+
+    void BuilderArrow::emitControl(typeScn scn, typeSeq sequence, typeObj obj, uint16_t flags) {
+        builderBegin(scn, sequence, obj, flags);
+        appendStream(controlTable, 1);
+        builderCommit(true);
+
+        for (ArrowColumn* column: controlTable->columns)
+            arrowReset(column);
+        pendingBytes = 0;
+    }
+
+    void BuilderArrow::columnFloat(const std::string& columnName __attribute__((unused)), double value) {
+        if (columnBegin(ARROW_TYPE_FLOAT)) {
+            auto floatValue = static_cast<float>(value);
+            uint32_t bits;
+            memcpy(reinterpret_cast<void*>(&bits), reinterpret_cast<const void*>(&floatValue), sizeof(bits));
+            arrowValue(columnArray, bits, sizeof(bits));
+        }
+    }
+
+    void BuilderArrow::columnDouble(const std::string& columnName __attribute__((unused)), long double value) {
+        if (columnBegin(ARROW_TYPE_DOUBLE)) {
+            auto doubleValue = static_cast<double>(value);
+            uint64_t bits;
+            memcpy(reinterpret_cast<void*>(&bits), reinterpret_cast<const void*>(&doubleValue), sizeof(bits));
+            arrowValue(columnArray, bits, sizeof(bits));
+        }
+    }
+
+    void BuilderArrow::columnString(const std::string& columnName __attribute__((unused))) {
+        if (columnBegin(ARROW_TYPE_UTF8))
+            arrowValue(columnArray, valueBuffer, valueLength);
+    }
+
+    void BuilderArrow::columnNumber(const std::string& columnName, uint64_t precision __attribute__((unused)),
+                                    uint64_t scale __attribute__((unused))) {
+        if (columnArray == nullptr)
+            return;
+
+        if (columnArray->type == ARROW_TYPE_INT64) {
+            int64_t value;
+            if (parseInt64(columnName, value) && columnBegin(ARROW_TYPE_INT64))
+                arrowValue(columnArray, static_cast<uint64_t>(value), sizeof(int64_t));
+        } else if (columnArray->type == ARROW_TYPE_BOOL) {
+            if (columnBegin(ARROW_TYPE_BOOL))
+                arrowBool(columnArray, valueLength > 0 && valueBuffer[0] != '0');
+        } else if (columnBegin(ARROW_TYPE_UTF8))
+            arrowValue(columnArray, valueBuffer, valueLength);
+    }
+
+    void BuilderArrow::columnRaw(const std::string& columnName __attribute__((unused)), const uint8_t* data, uint64_t length) {
+        if (columnBegin(ARROW_TYPE_BINARY))
+            arrowValue(columnArray, reinterpret_cast<const char*>(data), length);
+        else if (columnBegin(ARROW_TYPE_UTF8)) {
+            // XMLTYPE which could not be decoded
+            std::string str;
+            str.reserve(length * 2);
+            for (uint64_t j = 0; j < length; ++j) {
+                str.push_back(Ctx::map16((data[j] >> 4) & 0x0F));
+                str.push_back(Ctx::map16(data[j] & 0x0F));
+            }
+            arrowValue(columnArray, str.c_str(), str.length());
+        }
+    }
+
+    void BuilderArrow::columnRowId(const std::string& columnName __attribute__((unused)), typeRowId rowId) {
+        if (columnBegin(ARROW_TYPE_UTF8)) {
+            char str[19];
+            rowId.toHex(str);
+            arrowValue(columnArray, str, 18);
+        }
+    }
+
+    void BuilderArrow::columnTimestamp(const std::string& columnName __attribute__((unused)), time_t timestamp, uint64_t fraction) {
+        // Values outside of years 1677-2262 can't be expressed in nanoseconds, they are left as null
+        if (timestamp > ARROW_TIMESTAMP_MAX || timestamp < -ARROW_TIMESTAMP_MAX)
+            return;
+
+        if (columnBegin(ARROW_TYPE_TIMESTAMP))
+            arrowValue(columnArray, static_cast<uint64_t>(static_cast<int64_t>(timestamp) * 1000000000L + static_cast<int64_t>(fraction)),
+                       sizeof(int64_t));
+    }
+
+    void BuilderArrow::columnTimestampTz(const std::string& columnName __attribute__((unused)), time_t timestamp, uint64_t fraction, const char* tz) {
+        if (!columnBegin(ARROW_TYPE_UTF8))
+            return;
+
+        std::string str = formatTimestampTz(timestamp, fraction, tz);
+        arrowValue(columnArray, str.c_str(), str.length());
+    }
+
+    void BuilderArrow::processBeginMessage(typeScn scn __attribute__((unused)), typeSeq sequence __attribute__((unused)),
+                                           time_t timestamp __attribute__((unused))) {
+        newTran = false;
+        xidStr = formatXid();
+    }
+
+    void BuilderArrow::processCommit(typeScn scn __attribute__((unused)), typeSeq sequence __attribute__((unused)), time_t timestamp) {
+        // Skip empty transaction
+        if (newTran) {
+            newTran = false;
+            return;
+        }
+
+        // Commit time from redo log is used, so that batches are the same when the stream is replayed
+        if (pendingRows > 0 && timestamp - pendingTimestamp >= static_cast<time_t>(batchInterval))
+            flush();
+        num = 0;
+    }
+
+    void BuilderArrow::processInsert(typeScn scn, typeSeq sequence, time_t timestamp, LobCtx* lobCtx, const XmlCtx* xmlCtx, const OracleTable* table,
+                                     typeObj obj __attribute__((unused)), typeDataObj dataObj, typeDba bdba, typeSlot slot,
+                                     typeXid xid __attribute__((unused)), uint64_t offset) {
+        if (newTran)
+            processBeginMessage(scn, sequence, timestamp);
+
+        // Without table definition there is no schema to encode the row with
+        if (table != nullptr) {
+            ArrowTable* arrowTable = getArrowTable(table);
+            appendMeta(arrowTable, "c", scn, timestamp, dataObj, bdba, slot);
+            arrowNull(arrowTable->before);
+            appendImage(lobCtx, xmlCtx, arrowTable, arrowTable->after, VALUE_AFTER, compressedAfter, offset);
+            appendRow(scn, sequence, timestamp, arrowTable);
+        }
+        ++num;
+    }
+
+    void BuilderArrow::processUpdate(typeScn scn, typeSeq sequence, time_t timestamp, LobCtx* lobCtx, const XmlCtx* xmlCtx, const OracleTable* table,
+                                     typeObj obj __attribute__((unused)), typeDataObj dataObj, typeDba bdba, typeSlot slot,
+                                     typeXid xid __attribute__((unused)), uint64_t offset) {
+        if (newTran)
+            processBeginMessage(scn, sequence, timestamp);
+
+        // Without table definition there is no schema to encode the row with
+        if (table != nullptr) {
+            ArrowTable* arrowTable = getArrowTable(table);
+            appendMeta(arrowTable, "u", scn, timestamp, dataObj, bdba, slot);
+            appendImage(lobCtx, xmlCtx, arrowTable, arrowTable->before, VALUE_BEFORE, compressedBefore, offset);
+            appendImage(lobCtx, xmlCtx, arrowTable, arrowTable->after, VALUE_AFTER, compressedAfter, offset);
+            appendRow(scn, sequence, timestamp, arrowTable);
+        }
+        ++num;
+    }
+
+    void BuilderArrow::processDelete(typeScn scn, typeSeq sequence, time_t timestamp, LobCtx* lobCtx, const XmlCtx* xmlCtx, const OracleTable* table,
+                                     typeObj obj __attribute__((unused)), typeDataObj dataObj, typeDba bdba, typeSlot slot,
+                                     typeXid xid __attribute__((unused)), uint64_t offset) {
+        if (newTran)
+            processBeginMessage(scn, sequence, timestamp);
+
+        // Without table definition there is no schema to encode the row with
+        if (table != nullptr) {
+            ArrowTable* arrowTable = getArrowTable(table);
+            appendMeta(arrowTable, "d", scn, timestamp, dataObj, bdba, slot);
+            appendImage(lobCtx, xmlCtx, arrowTable, arrowTable->before, VALUE_BEFORE, compressedBefore, offset);
+            arrowNull(arrowTable->after);
+            appendRow(scn, sequence, timestamp, arrowTable);
+        }
+        ++num;
+    }
+
+    void BuilderArrow::processDdl(typeScn scn, typeSeq sequence, time_t timestamp, const OracleTable* table __attribute__((unused)), typeObj obj,
+                                  typeDataObj dataObj __attribute__((unused)), uint16_t type __attribute__((unused)), uint16_t seq __attribute__((unused)),
+                                  const char* sql, uint64_t sqlLength, const char* owner, uint64_t ownerLength, const char* name, uint64_t nameLength) {
+        if (newTran)
+            processBeginMessage(scn, sequence, timestamp);
+
+        // Table definition might change, rows collected so far are sent with the previous definition
+        flush();
+        dropArrowTable(obj);
+
+        appendControl("ddl", scn, timestamp);
+        arrowNull(controlTable->columns[3]);
+        arrowNull(controlTable->columns[4]);
+        arrowNull(controlTable->columns[5]);
+        arrowValue(controlTable->columns[6], owner, ownerLength);
+        arrowValue(controlTable->columns[7], name, nameLength);
+        arrowValue(controlTable->columns[8], sql, sqlLength);
+        emitControl(scn, sequence, obj, 0);
+        ++num;
+    }
+
+    void BuilderArrow::processCheckpoint(typeScn scn, typeSeq sequence, time_t timestamp, uint64_t offset, bool redo) {
+        // Checkpoint position must not move past rows which are not sent yet
+        flush();
+
+        if (lwnScn != scn) {
+            lwnScn = scn;
+            lwnIdx = 0;
+        }
+
+        appendControl("chkpt", scn, timestamp);
+        arrowValue(controlTable->columns[3], sequence, sizeof(uint64_t));
+        arrowValue(controlTable->columns[4], offset, sizeof(uint64_t));
+        arrowBool(controlTable->columns[5], redo);
+        arrowNull(controlTable->columns[6]);
+        arrowNull(controlTable->columns[7]);
+        arrowNull(controlTable->columns[8]);
+        emitControl(scn, sequence, 0, OUTPUT_BUFFER_MESSAGE_CHECKPOINT);
+    }
+}
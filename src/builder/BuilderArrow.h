@@ -0,0 +1,247 @@
+/* Header for BuilderArrow class
+   Copyright (C) 2018-2024 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <unordered_map>
+#include <vector>
+
+#include "Builder.h"
+#include "../common/OracleColumn.h"
+#include "../common/OracleTable.h"
+#include "../common/table/SysCol.h"
+#include "../metadata/Metadata.h"
+
+#ifndef BUILDER_ARROW_H_
+#define BUILDER_ARROW_H_
+
+namespace OpenLogReplicator {
+    // Arrow IPC stream format, rows of committed transactions are accumulated per table in columnar record batches
+    class BuilderArrow final : public Builder {
+    protected:
+        static constexpr uint8_t ARROW_TYPE_NONE = LOGICAL_TYPE_NONE;
+        static constexpr uint8_t ARROW_TYPE_BOOL = LOGICAL_TYPE_BOOLEAN;
+        static constexpr uint8_t ARROW_TYPE_INT64 = LOGICAL_TYPE_INT64;
+        static constexpr uint8_t ARROW_TYPE_FLOAT = LOGICAL_TYPE_FLOAT;
+        static constexpr uint8_t ARROW_TYPE_DOUBLE = LOGICAL_TYPE_DOUBLE;
+        static constexpr uint8_t ARROW_TYPE_BINARY = LOGICAL_TYPE_BINARY;
+        static constexpr uint8_t ARROW_TYPE_UTF8 = LOGICAL_TYPE_STRING;
+        static constexpr uint8_t ARROW_TYPE_TIMESTAMP = LOGICAL_TYPE_TIMESTAMP;
+        // Types used only by the message envelope
+        static constexpr uint8_t ARROW_TYPE_UINT64 = 8;
+        static constexpr uint8_t ARROW_TYPE_STRUCT = 9;
+        static constexpr uint8_t ARROW_TYPE_TIMESTAMP_UTC = 10;
+
+        // Values from Arrow format definition (Schema.fbs, Message.fbs)
+        static constexpr uint8_t FB_TYPE_INT = 2;
+        static constexpr uint8_t FB_TYPE_FLOATING_POINT = 3;
+        static constexpr uint8_t FB_TYPE_BINARY = 4;
+        static constexpr uint8_t FB_TYPE_UTF8 = 5;
+        static constexpr uint8_t FB_TYPE_BOOL = 6;
+        static constexpr uint8_t FB_TYPE_TIMESTAMP = 10;
+        static constexpr uint8_t FB_TYPE_STRUCT = 13;
+        static constexpr uint8_t FB_HEADER_SCHEMA = 1;
+        static constexpr uint8_t FB_HEADER_RECORD_BATCH = 3;
+        static constexpr int16_t FB_METADATA_V5 = 4;
+        static constexpr int16_t FB_PRECISION_SINGLE = 1;
+        static constexpr int16_t FB_PRECISION_DOUBLE = 2;
+        static constexpr int16_t FB_TIME_UNIT_NANOSECOND = 3;
+
+        // Largest value (in seconds) which fits in a nanosecond precision timestamp
+        static constexpr time_t ARROW_TIMESTAMP_MAX = 9223372035;
+
+        // Minimal flatbuffer serializer, like the reference implementation the buffer is built back to front
+        class FlatBuffer final {
+        protected:
+            std::vector<uint8_t> buffer;
+            uint64_t head;
+            uint64_t minAlign;
+            uint32_t tableStart;
+            std::vector<std::pair<uint16_t, uint32_t>> fields;
+
+            void grow(uint64_t length);
+            void pushValue(uint64_t value, uint64_t length);
+            void pushOffset(uint32_t target);
+
+        public:
+            FlatBuffer();
+
+            [[nodiscard]] uint32_t size() const {
+                return static_cast<uint32_t>(buffer.size() - head);
+            }
+
+            [[nodiscard]] const uint8_t* data() const {
+                return buffer.data() + head;
+            }
+
+            void clear();
+            void align(uint64_t alignment, uint64_t additional);
+            [[nodiscard]] uint32_t createString(const std::string& str);
+            [[nodiscard]] uint32_t createOffsetVector(const std::vector<uint32_t>& offsets);
+            [[nodiscard]] uint32_t createStructVector(const std::vector<std::pair<int64_t, int64_t>>& structs);
+            void startTable();
+            void addBool(uint16_t slot, bool value);
+            void addUInt8(uint16_t slot, uint8_t value);
+            void addInt16(uint16_t slot, int16_t value);
+            void addInt32(uint16_t slot, int32_t value);
+            void addInt64(uint16_t slot, int64_t value);
+            void addOffset(uint16_t slot, uint32_t target);
+            [[nodiscard]] uint32_t endTable();
+            void finish(uint32_t root);
+        };
+
+        struct ArrowColumn {
+            std::string name;
+            uint8_t type;
+            bool nullable;
+            uint64_t length;
+            uint64_t nullCount;
+            std::string validity;
+            std::string offsets;
+            std::string data;
+            std::vector<ArrowColumn*> children;
+        };
+
+        struct ArrowTable {
+            const OracleTable* table;
+            uint64_t version;
+            std::string owner;
+            std::string name;
+            std::vector<ArrowColumn*> columns;
+            ArrowColumn* before;
+            ArrowColumn* after;
+            std::vector<typeCol> cols;
+        };
+
+        uint64_t batchRows;
+        uint64_t batchBytes;
+        uint64_t batchInterval;
+        std::unordered_map<typeObj, ArrowTable*> arrowTables;
+        std::vector<ArrowTable*> pendingTables;
+        ArrowTable* controlTable;
+        uint64_t pendingRows;
+        uint64_t pendingBytes;
+        time_t pendingTimestamp;
+        typeScn pendingScn;
+        typeSeq pendingSequence;
+        typeScn pendingLwnScn;
+        typeIdx pendingLwnIdx;
+        std::string xidStr;
+        FlatBuffer flatBuffer;
+        std::vector<std::pair<int64_t, int64_t>> fbNodes;
+        std::vector<std::pair<int64_t, int64_t>> fbBuffers;
+        ArrowColumn* columnArray;
+        bool columnWritten;
+
+        static inline void arrowAppend(std::string& str, uint64_t value, uint64_t length) {
+            for (uint64_t i = 0; i < length; ++i, value >>= 8)
+                str.push_back(static_cast<char>(value & 0xFF));
+        }
+
+        inline void arrowValid(ArrowColumn* column, bool valid) {
+            if ((column->length & 7) == 0)
+                column->validity.push_back(0);
+            if (valid)
+                column->validity.back() = static_cast<char>(column->validity.back() | (1 << (column->length & 7)));
+            else
+                ++column->nullCount;
+            ++column->length;
+        }
+
+        inline void arrowValue(ArrowColumn* column, uint64_t value, uint64_t length) {
+            arrowAppend(column->data, value, length);
+            arrowValid(column, true);
+            pendingBytes += length;
+        }
+
+        inline void arrowValue(ArrowColumn* column, const char* data, uint64_t length) {
+            column->data.append(data, length);
+            arrowAppend(column->offsets, column->data.length(), sizeof(int32_t));
+            arrowValid(column, true);
+            pendingBytes += length + sizeof(int32_t);
+        }
+
+        inline void arrowBool(ArrowColumn* column, bool value) {
+            if ((column->length & 7) == 0)
+                column->data.push_back(0);
+            if (value)
+                column->data.back() = static_cast<char>(column->data.back() | (1 << (column->length & 7)));
+            arrowValid(column, true);
+        }
+
+        // Values not matching the type of the column array are appended as null by appendImage
+        inline bool columnBegin(uint8_t arrowType) {
+            if (columnWritten || columnArray == nullptr || columnArray->type != arrowType)
+                return false;
+            columnWritten = true;
+            return true;
+        }
+
+        void arrowNull(ArrowColumn* column);
+        void arrowReset(ArrowColumn* column);
+        static ArrowColumn* arrowColumn(const std::string& name, uint8_t type, bool nullable);
+        static void arrowDelete(ArrowColumn* column);
+        ArrowTable* getArrowTable(const OracleTable* table);
+        void dropArrowTable(typeObj obj);
+        void appendMeta(ArrowTable* arrowTable, const char* operation, typeScn scn, time_t timestamp, typeDataObj dataObj, typeDba bdba, typeSlot slot);
+        void appendImage(LobCtx* lobCtx, const XmlCtx* xmlCtx, const ArrowTable* arrowTable, ArrowColumn* image, uint64_t valueType, bool compressed,
+                         uint64_t offset);
+        void appendRow(typeScn scn, typeSeq sequence, time_t timestamp, ArrowTable* arrowTable);
+        uint32_t appendFbField(const ArrowColumn* column);
+        void appendFbBatch(const ArrowColumn* column, int64_t& bodyLength);
+        void appendBody(const ArrowColumn* column);
+        void appendBodyBuffer(const std::string& str);
+        void appendFlatBuffer();
+        void appendStream(const ArrowTable* arrowTable, uint64_t rows);
+        void appendControl(const char* operation, typeScn scn, time_t timestamp);
+        void emitControl(typeScn scn, typeSeq sequence, typeObj obj, uint16_t flags);
+        void flush();
+
+        void columnFloat(const std::string& columnName, double value) override;
+        void columnDouble(const std::string& columnName, long double value) override;
+        void columnString(const std::string& columnName) override;
+        void columnNumber(const std::string& columnName, uint64_t precision, uint64_t scale) override;
+        void columnRaw(const std::string& columnName, const uint8_t* data, uint64_t length) override;
+        void columnRowId(const std::string& columnName, typeRowId rowId) override;
+        void columnTimestamp(const std::string& columnName, time_t timestamp, uint64_t fraction) override;
+        void columnTimestampTz(const std::string& columnName, time_t timestamp, uint64_t fraction, const char* tz) override;
+        void processInsert(typeScn scn, typeSeq sequence, time_t timestamp, LobCtx* lobCtx, const XmlCtx* xmlCtx, const OracleTable* table, typeObj obj,
+                           typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid, uint64_t offset) override;
+        void processUpdate(typeScn scn, typeSeq sequence, time_t timestamp, LobCtx* lobCtx, const XmlCtx* xmlCtx, const OracleTable* table, typeObj obj,
+                           typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid, uint64_t offset) override;
+        void processDelete(typeScn scn, typeSeq sequence, time_t timestamp, LobCtx* lobCtx, const XmlCtx* xmlCtx, const OracleTable* table, typeObj obj,
+                           typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid, uint64_t offset) override;
+        void processDdl(typeScn scn, typeSeq sequence, time_t timestamp, const OracleTable* table, typeObj obj, typeDataObj dataObj, uint16_t type,
+                        uint16_t seq, const char* sql, uint64_t sqlLength,
+                        const char* owner, uint64_t ownerLength, const char* name, uint64_t nameLength) override;
+        void processBeginMessage(typeScn scn, typeSeq sequence, time_t timestamp) override;
+
+    public:
+        BuilderArrow(Ctx* newCtx, Locales* newLocales, Metadata* newMetadata, uint64_t newDbFormat, uint64_t newAttributesFormat,
+                     uint64_t newIntervalDtsFormat, uint64_t newIntervalYtmFormat, uint64_t newMessageFormat, uint64_t newRidFormat, uint64_t newXidFormat,
+                     uint64_t newTimestampFormat, uint64_t newTimestampTzFormat, uint64_t newTimestampAll, uint64_t newCharFormat, uint64_t newScnFormat,
+                     uint64_t newScnAll, uint64_t newUnknownFormat, uint64_t newSchemaFormat, uint64_t newColumnFormat, uint64_t newUnknownType,
+                     uint64_t newFlushBuffer, uint64_t newBatchRows, uint64_t newBatchBytes, uint64_t newBatchInterval);
+        ~BuilderArrow() override;
+
+        void initialize() override;
+        void processCommit(typeScn scn, typeSeq sequence, time_t timestamp) override;
+        void processCheckpoint(typeScn scn, typeSeq sequence, time_t timestamp, uint64_t offset, bool redo) override;
+    };
+}
+
+#endif
@@ -0,0 +1,557 @@
+/* Memory buffer for handling output data in Avro format
+   Copyright (C) 2018-2024 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <set>
+
+#include "../common/OracleColumn.h"
+#include "../common/OracleTable.h"
+#include "../common/typeRowId.h"
+#include "../common/exception/RuntimeException.h"
+#include "../metadata/Metadata.h"
+#include "../state/StateDisk.h"
+#include "BuilderAvro.h"
+
+namespace OpenLogReplicator {
+    BuilderAvro::BuilderAvro(Ctx* newCtx, Locales* newLocales, Metadata* newMetadata, uint64_t newDbFormat, uint64_t newAttributesFormat,
+                             uint64_t newIntervalDtsFormat, uint64_t newIntervalYtmFormat, uint64_t newMessageFormat, uint64_t newRidFormat,
+                             uint64_t newXidFormat, uint64_t newTimestampFormat, uint64_t newTimestampTzFormat, uint64_t newTimestampAll,
+                             uint64_t newCharFormat, uint64_t newScnFormat, uint64_t newScnAll, uint64_t newUnknownFormat, uint64_t newSchemaFormat,
+                             uint64_t newColumnFormat, uint64_t newUnknownType, uint64_t newFlushBuffer, const char* newRegistryPath) :
+            Builder(newCtx, newLocales, newMetadata, newDbFormat, newAttributesFormat, newIntervalDtsFormat, newIntervalYtmFormat, newMessageFormat,
+                    newRidFormat, newXidFormat, newTimestampFormat, newTimestampTzFormat, newTimestampAll, newCharFormat, newScnFormat, newScnAll,
+                    newUnknownFormat, newSchemaFormat, newColumnFormat, newUnknownType, newFlushBuffer),
+            registryPath(newRegistryPath),
+            registry(nullptr),
+            schemaMaxId(0),
+            controlSchemaId(0),
+            columnType(AVRO_TYPE_NONE),
+            columnWritten(false) {
+    }
+
+    BuilderAvro::~BuilderAvro() {
+        for (auto& avroTableIt: avroTables)
+            delete avroTableIt.second;
+        avroTables.clear();
+
+        if (registry != nullptr) {
+            delete registry;
+            registry = nullptr;
+        }
+    }
+
+    void BuilderAvro::initialize() {
+        Builder::initialize();
+
+        registry = new StateDisk(ctx, registryPath.c_str());
+
+        // Load schemas registered by previous runs, ids must stay stable
+        std::set<std::string> namesList;
+        registry->list(namesList);
+        for (const auto& name: namesList) {
+            if (name.length() <= 7 || name.compare(0, 7, "schema-") != 0)
+                continue;
+
+            char* retPtr;
+            uint64_t schemaId = strtoull(name.c_str() + 7, &retPtr, 10);
+            if (*retPtr != 0 || schemaId == 0 || schemaId > UINT32_MAX)
+                continue;
+
+            std::string schema;
+            if (!registry->read(name, SCHEMA_FILE_MAX_SIZE, schema))
+                continue;
+
+            schemaIds.insert_or_assign(schema, static_cast<uint32_t>(schemaId));
+            if (schemaId > schemaMaxId)
+                schemaMaxId = static_cast<uint32_t>(schemaId);
+        }
+
+        std::ostringstream ss;
+        ss << R"({"type":"record","name":"Control","namespace":"OpenLogReplicator","fields":[)"
+              R"({"name":"op","type":"string"},)"
+              R"({"name":"scn","type":"long"},)"
+              R"({"name":"tm","type":{"type":"long","logicalType":"timestamp-nanos"}},)"
+              R"({"name":"c_scn","type":"long"},)"
+              R"({"name":"c_idx","type":"long"},)"
+              R"({"name":"xid","type":["null","string"],"default":null},)"
+              R"({"name":"db","type":["null","string"],"default":null},)"
+              R"({"name":"seq","type":["null","long"],"default":null},)"
+              R"({"name":"offset","type":["null","long"],"default":null},)"
+              R"({"name":"redo","type":["null","boolean"],"default":null},)"
+              R"({"name":"owner","type":["null","string"],"default":null},)"
+              R"({"name":"table","type":["null","string"],"default":null},)"
+              R"({"name":"sql","type":["null","string"],"default":null}]})";
+        controlSchemaId = registerSchema(ss.str());
+    }
+
+    uint32_t BuilderAvro::registerSchema(const std::string& schema) {
+        auto schemaIdsIt = schemaIds.find(schema);
+        if (schemaIdsIt != schemaIds.end())
+            return schemaIdsIt->second;
+
+        if (schemaMaxId == UINT32_MAX)
+            throw RuntimeException(50070, "Avro schema registry " + registryPath + " is full");
+        uint32_t schemaId = ++schemaMaxId;
+
+        std::ostringstream ss;
+        ss << schema;
+        registry->write("schema-" + std::to_string(schemaId), 0, ss);
+        schemaIds.insert_or_assign(schema, schemaId);
+
+        if (ctx->trace & Ctx::TRACE_SYSTEM)
+            ctx->logTrace(Ctx::TRACE_SYSTEM, "registered Avro schema id: " + std::to_string(schemaId));
+        return schemaId;
+    }
+
+    std::string BuilderAvro::avroName(const std::string& name) {
+        std::string avro(name);
+        for (char& character: avro) {
+            if ((character < 'A' || character > 'Z') && (character < 'a' || character > 'z') && (character < '0' || character > '9'))
+                character = '_';
+        }
+        if (avro.empty() || (avro[0] >= '0' && avro[0] <= '9'))
+            avro.insert(0, 1, '_');
+        return avro;
+    }
+
+    BuilderAvro::AvroTable* BuilderAvro::getAvroTable(const OracleTable* table) {
+        auto avroTablesIt = avroTables.find(table->obj);
+        if (avroTablesIt != avroTables.end()) {
+            if (avroTablesIt->second->version == table->version)
+                return avroTablesIt->second;
+
+            // Table definition changed after DDL or dictionary reload, schema needs to be verified again
+            delete avroTablesIt->second;
+            avroTables.erase(avroTablesIt);
+        }
+
+        auto avroTable = new AvroTable();
+        avroTable->version = table->version;
+
+        std::set<std::string> fieldNames;
+        std::ostringstream ss;
+        ss << R"({"type":"record","name":"Envelope","namespace":")" << avroName(table->owner) << '.' << avroName(table->name) << R"(","fields":[)"
+              R"({"name":"op","type":"string"},)"
+              R"({"name":"scn","type":"long"},)"
+              R"({"name":"tm","type":{"type":"long","logicalType":"timestamp-nanos"}},)"
+              R"({"name":"c_scn","type":"long"},)"
+              R"({"name":"c_idx","type":"long"},)"
+              R"({"name":"xid","type":"string"},)"
+              R"({"name":"db","type":["null","string"],"default":null},)"
+              R"({"name":"num","type":["null","long"],"default":null},)"
+              R"({"name":"offset","type":["null","long"],"default":null},)"
+              R"({"name":"rid","type":["null","string"],"default":null},)"
+              R"({"name":"before","type":["null",{"type":"record","name":"Value","fields":[)";
+
+        for (typeCol column = 0; column < static_cast<typeCol>(table->columns.size()); ++column) {
+            const OracleColumn* oracleColumn = table->columns[column];
+            if (oracleColumn == nullptr || !table->isProjected(column))
+                continue;
+
+            uint8_t avroType = getLogicalType(oracleColumn);
+            if (avroType == AVRO_TYPE_NONE)
+                continue;
+
+            std::string fieldName = avroName(oracleColumn->name);
+            if (fieldNames.count(fieldName) > 0)
+                fieldName += "_" + std::to_string(column);
+            fieldNames.insert(fieldName);
+
+            if (!avroTable->columns.empty())
+                ss << ',';
+            ss << R"({"name":")" << fieldName << R"(","type":["null",)";
+            switch (avroType) {
+                case AVRO_TYPE_BOOLEAN:
+                    ss << R"("boolean")";
+                    break;
+
+                case AVRO_TYPE_LONG:
+                    ss << R"("long")";
+                    break;
+
+                case AVRO_TYPE_FLOAT:
+                    ss << R"("float")";
+                    break;
+
+                case AVRO_TYPE_DOUBLE:
+                    ss << R"("double")";
+                    break;
+
+                case AVRO_TYPE_BYTES:
+                    ss << R"("bytes")";
+                    break;
+
+                case AVRO_TYPE_STRING:
+                    ss << R"("string")";
+                    break;
+
+                case AVRO_TYPE_TIMESTAMP:
+                    ss << R"({"type":"long","logicalType":"timestamp-nanos"})";
+                    break;
+            }
+            // Absent column is not distinguishable from null in redo, the Oracle constraint is kept as an attribute
+            ss << R"(],"default":null,"nullable":)" << (oracleColumn->nullable ? "true" : "false") << '}';
+
+            avroTable->columns.push_back(column);
+            avroTable->types.push_back(avroType);
+        }
+
+        ss << R"(]}],"default":null},)"
+              R"({"name":"after","type":["null","Value"],"default":null}]})";
+
+        avroTable->schemaId = registerSchema(ss.str());
+        avroTables.insert_or_assign(table->obj, avroTable);
+        return avroTable;
+    }
+
+    void BuilderAvro::appendXid() {
+        appendAvroString(formatXid());
+    }
+
+    void BuilderAvro::appendHeader(const char* operation, typeScn scn, time_t timestamp) {
+        appendAvroString(operation, strlen(operation));
+        appendAvroLong(static_cast<int64_t>(scn));
+        appendAvroLong(static_cast<int64_t>(timestamp) * 1000000000L);
+        appendAvroLong(static_cast<int64_t>(lwnScn));
+        appendAvroLong(static_cast<int64_t>(lwnIdx));
+    }
+
+    void BuilderAvro::appendControl(const char* operation, typeScn scn, time_t timestamp, bool showXid, bool showDb) {
+        appendFrame(controlSchemaId);
+        appendHeader(operation, scn, timestamp);
+
+        if (showXid) {
+            appendAvroPresent();
+            appendXid();
+        } else
+            appendAvroNull();
+
+        if (showDb) {
+            appendAvroPresent();
+            appendAvroString(metadata->conName);
+        } else
+            appendAvroNull();
+    }
+
+    void BuilderAvro::appendRow(LobCtx* lobCtx, const XmlCtx* xmlCtx, const AvroTable* avroTable, uint64_t valueType, bool compressed, uint64_t offset) {
+        // Compressed row image can't be mapped to table columns
+        if (compressed) {
+            appendAvroNull();
+            return;
+        }
+
+        appendAvroPresent();
+        for (uint64_t i = 0; i < avroTable->columns.size(); ++i) {
+            typeCol column = avroTable->columns[i];
+            columnType = avroTable->types[i];
+            columnWritten = false;
+
+            if (static_cast<uint64_t>(column) < valuesMax && values[column][valueType] != nullptr && lengths[column][valueType] > 0)
+                processValue(lobCtx, xmlCtx, avroTable->table, column, values[column][valueType], lengths[column][valueType], offset,
+                             valueType == VALUE_AFTER, false);
+
+            if (!columnWritten)
+                appendAvroNull();
+        }
+        columnType = AVRO_TYPE_NONE;
+    }
+
+    void BuilderAvro::columnFloat(const std::string& columnName __attribute__((unused)), double value) {
+        if (columnBegin(AVRO_TYPE_FLOAT))
+            appendAvroFloat(static_cast<float>(value));
+    }
+
+    void BuilderAvro::columnDouble(const std::string& columnName __attribute__((unused)), long double value) {
+        if (columnBegin(AVRO_TYPE_DOUBLE))
+            appendAvroDouble(static_cast<double>(value));
+    }
+
+    void BuilderAvro::columnString(const std::string& columnName __attribute__((unused))) {
+        if (columnBegin(AVRO_TYPE_STRING))
+            appendAvroString(valueBuffer, valueLength);
+    }
+
+    void BuilderAvro::columnNumber(const std::string& columnName, uint64_t precision __attribute__((unused)),
+                                   uint64_t scale __attribute__((unused))) {
+        if (columnType == AVRO_TYPE_LONG) {
+            int64_t value;
+            if (parseInt64(columnName, value) && columnBegin(AVRO_TYPE_LONG))
+                appendAvroLong(value);
+        } else if (columnType == AVRO_TYPE_BOOLEAN) {
+            if (columnBegin(AVRO_TYPE_BOOLEAN))
+                appendAvroBoolean(valueLength > 0 && valueBuffer[0] != '0');
+        } else if (columnBegin(AVRO_TYPE_STRING))
+            appendAvroString(valueBuffer, valueLength);
+    }
+
+    void BuilderAvro::columnRaw(const std::string& columnName __attribute__((unused)), const uint8_t* data, uint64_t length) {
+        if (columnBegin(AVRO_TYPE_BYTES)) {
+            appendAvroLong(static_cast<int64_t>(length));
+            append(reinterpret_cast<const char*>(data), length);
+        } else if (columnBegin(AVRO_TYPE_STRING)) {
+            // XMLTYPE which could not be decoded
+            appendAvroLong(static_cast<int64_t>(length * 2));
+            for (uint64_t j = 0; j < length; ++j) {
+                append(Ctx::map16((data[j] >> 4) & 0x0F));
+                append(Ctx::map16(data[j] & 0x0F));
+            }
+        }
+    }
+
+    void BuilderAvro::columnRowId(const std::string& columnName __attribute__((unused)), typeRowId rowId) {
+        if (columnBegin(AVRO_TYPE_STRING)) {
+            char str[19];
+            rowId.toHex(str);
+            appendAvroString(str, 18);
+        }
+    }
+
+    void BuilderAvro::columnTimestamp(const std::string& columnName __attribute__((unused)), time_t timestamp, uint64_t fraction) {
+        // Values outside of years 1677-2262 can't be expressed in nanoseconds, they are left as null
+        if (timestamp > AVRO_TIMESTAMP_MAX || timestamp < -AVRO_TIMESTAMP_MAX)
+            return;
+
+        if (columnBegin(AVRO_TYPE_TIMESTAMP))
+            appendAvroLong(static_cast<int64_t>(timestamp) * 1000000000L + static_cast<int64_t>(fraction));
+    }
+
+    void BuilderAvro::columnTimestampTz(const std::string& columnName __attribute__((unused)), time_t timestamp, uint64_t fraction, const char* tz) {
+        if (columnBegin(AVRO_TYPE_STRING))
+            appendAvroString(formatTimestampTz(timestamp, fraction, tz));
+    }
+
+    void BuilderAvro::processBeginMessage(typeScn scn, typeSeq sequence, time_t timestamp) {
+        newTran = false;
+
+        if ((messageFormat & MESSAGE_FORMAT_SKIP_BEGIN) != 0)
+            return;
+
+        builderBegin(scn, sequence, 0, 0);
+        appendControl("begin", msg->scn, timestamp, true, (dbFormat & DB_FORMAT_ADD_DML) != 0);
+        // seq, offset, redo, owner, table, sql
+        for (uint64_t i = 0; i < 6; ++i)
+            appendAvroNull();
+        builderCommit(false);
+    }
+
+    void BuilderAvro::processCommit(typeScn scn, typeSeq sequence, time_t timestamp) {
+        // Skip empty transaction
+        if (newTran) {
+            newTran = false;
+            return;
+        }
+
+        if ((messageFormat & MESSAGE_FORMAT_SKIP_COMMIT) == 0) {
+            builderBegin(scn, sequence, 0, 0);
+            appendControl("commit", msg->scn, timestamp, true, (dbFormat & DB_FORMAT_ADD_DML) != 0);
+            // seq, offset, redo, owner, table, sql
+            for (uint64_t i = 0; i < 6; ++i)
+                appendAvroNull();
+            builderCommit(true);
+        }
+        num = 0;
+    }
+
+    void BuilderAvro::processInsert(typeScn scn, typeSeq sequence, time_t timestamp, LobCtx* lobCtx, const XmlCtx* xmlCtx, const OracleTable* table,
+                                    typeObj obj, typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid __attribute__((unused)), uint64_t offset) {
+        if (newTran)
+            processBeginMessage(scn, sequence, timestamp);
+
+        // Without table definition there is no schema to encode the row with
+        if (table == nullptr) {
+            ++num;
+            return;
+        }
+
+        const AvroTable* avroTable = getAvroTable(table);
+        builderBegin(scn, sequence, obj, 0);
+        appendFrame(avroTable->schemaId);
+        appendHeader("c", msg->scn, timestamp);
+        appendXid();
+        if ((dbFormat & DB_FORMAT_ADD_DML) != 0) {
+            appendAvroPresent();
+            appendAvroString(metadata->conName);
+        } else
+            appendAvroNull();
+        if ((messageFormat & MESSAGE_FORMAT_ADD_SEQUENCES) != 0) {
+            appendAvroPresent();
+            appendAvroLong(static_cast<int64_t>(num));
+        } else
+            appendAvroNull();
+        if ((messageFormat & MESSAGE_FORMAT_ADD_OFFSET) != 0) {
+            appendAvroPresent();
+            appendAvroLong(static_cast<int64_t>(offset));
+        } else
+            appendAvroNull();
+        if (ridFormat == RID_FORMAT_TEXT) {
+            typeRowId rowId(dataObj, bdba, slot);
+            char str[19];
+            rowId.toString(str);
+            appendAvroPresent();
+            appendAvroString(str, 18);
+        } else
+            appendAvroNull();
+
+        appendAvroNull();
+        appendRow(lobCtx, xmlCtx, avroTable, VALUE_AFTER, compressedAfter, offset);
+        builderCommit(false);
+        ++num;
+    }
+
+    void BuilderAvro::processUpdate(typeScn scn, typeSeq sequence, time_t timestamp, LobCtx* lobCtx, const XmlCtx* xmlCtx, const OracleTable* table,
+                                    typeObj obj, typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid __attribute__((unused)), uint64_t offset) {
+        if (newTran)
+            processBeginMessage(scn, sequence, timestamp);
+
+        // Without table definition there is no schema to encode the row with
+        if (table == nullptr) {
+            ++num;
+            return;
+        }
+
+        const AvroTable* avroTable = getAvroTable(table);
+        builderBegin(scn, sequence, obj, 0);
+        appendFrame(avroTable->schemaId);
+        appendHeader("u", msg->scn, timestamp);
+        appendXid();
+        if ((dbFormat & DB_FORMAT_ADD_DML) != 0) {
+            appendAvroPresent();
+            appendAvroString(metadata->conName);
+        } else
+            appendAvroNull();
+        if ((messageFormat & MESSAGE_FORMAT_ADD_SEQUENCES) != 0) {
+            appendAvroPresent();
+            appendAvroLong(static_cast<int64_t>(num));
+        } else
+            appendAvroNull();
+        if ((messageFormat & MESSAGE_FORMAT_ADD_OFFSET) != 0) {
+            appendAvroPresent();
+            appendAvroLong(static_cast<int64_t>(offset));
+        } else
+            appendAvroNull();
+        if (ridFormat == RID_FORMAT_TEXT) {
+            typeRowId rowId(dataObj, bdba, slot);
+            char str[19];
+            rowId.toString(str);
+            appendAvroPresent();
+            appendAvroString(str, 18);
+        } else
+            appendAvroNull();
+
+        appendRow(lobCtx, xmlCtx, avroTable, VALUE_BEFORE, compressedBefore, offset);
+        appendRow(lobCtx, xmlCtx, avroTable, VALUE_AFTER, compressedAfter, offset);
+        builderCommit(false);
+        ++num;
+    }
+
+    void BuilderAvro::processDelete(typeScn scn, typeSeq sequence, time_t timestamp, LobCtx* lobCtx, const XmlCtx* xmlCtx, const OracleTable* table,
+                                    typeObj obj, typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid __attribute__((unused)), uint64_t offset) {
+        if (newTran)
+            processBeginMessage(scn, sequence, timestamp);
+
+        // Without table definition there is no schema to encode the row with
+        if (table == nullptr) {
+            ++num;
+            return;
+        }
+
+        const AvroTable* avroTable = getAvroTable(table);
+        builderBegin(scn, sequence, obj, 0);
+        appendFrame(avroTable->schemaId);
+        appendHeader("d", msg->scn, timestamp);
+        appendXid();
+        if ((dbFormat & DB_FORMAT_ADD_DML) != 0) {
+            appendAvroPresent();
+            appendAvroString(metadata->conName);
+        } else
+            appendAvroNull();
+        if ((messageFormat & MESSAGE_FORMAT_ADD_SEQUENCES) != 0) {
+            appendAvroPresent();
+            appendAvroLong(static_cast<int64_t>(num));
+        } else
+            appendAvroNull();
+        if ((messageFormat & MESSAGE_FORMAT_ADD_OFFSET) != 0) {
+            appendAvroPresent();
+            appendAvroLong(static_cast<int64_t>(offset));
+        } else
+            appendAvroNull();
+        if (ridFormat == RID_FORMAT_TEXT) {
+            typeRowId rowId(dataObj, bdba, slot);
+            char str[19];
+            rowId.toString(str);
+            appendAvroPresent();
+            appendAvroString(str, 18);
+        } else
+            appendAvroNull();
+
+        appendRow(lobCtx, xmlCtx, avroTable, VALUE_BEFORE, compressedBefore, offset);
+        appendAvroNull();
+        builderCommit(false);
+        ++num;
+    }
+
+    void BuilderAvro::processDdl(typeScn scn, typeSeq sequence, time_t timestamp, const OracleTable* table __attribute__((unused)), typeObj obj,
+                                 typeDataObj dataObj __attribute__((unused)), uint16_t type __attribute__((unused)), uint16_t seq __attribute__((unused)),
+                                 const char* sql, uint64_t sqlLength, const char* owner, uint64_t ownerLength, const char* name, uint64_t nameLength) {
+        if (newTran)
+            processBeginMessage(scn, sequence, timestamp);
+
+        // Table definition might change, the schema is verified again on next use
+        auto avroTablesIt = avroTables.find(obj);
+        if (avroTablesIt != avroTables.end()) {
+            delete avroTablesIt->second;
+            avroTables.erase(avroTablesIt);
+        }
+
+        builderBegin(scn, sequence, obj, 0);
+        appendControl("ddl", msg->scn, timestamp, true, (dbFormat & DB_FORMAT_ADD_DDL) != 0);
+        // seq, offset, redo
+        appendAvroNull();
+        appendAvroNull();
+        appendAvroNull();
+        appendAvroPresent();
+        appendAvroString(owner, ownerLength);
+        appendAvroPresent();
+        appendAvroString(name, nameLength);
+        appendAvroPresent();
+        appendAvroString(sql, sqlLength);
+        builderCommit(true);
+        ++num;
+    }
+
+    void BuilderAvro::processCheckpoint(typeScn scn, typeSeq sequence, time_t timestamp, uint64_t offset, bool redo) {
+        if (lwnScn != scn) {
+            lwnScn = scn;
+            lwnIdx = 0;
+        }
+
+        builderBegin(scn, sequence, 0, OUTPUT_BUFFER_MESSAGE_CHECKPOINT);
+        appendControl("chkpt", msg->scn, timestamp, false, false);
+        appendAvroPresent();
+        appendAvroLong(static_cast<int64_t>(sequence));
+        appendAvroPresent();
+        appendAvroLong(static_cast<int64_t>(offset));
+        appendAvroPresent();
+        appendAvroBoolean(redo);
+        // owner, table, sql
+        appendAvroNull();
+        appendAvroNull();
+        appendAvroNull();
+        builderCommit(true);
+    }
+}
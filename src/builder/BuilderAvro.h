@@ -0,0 +1,172 @@
+/* Header for BuilderAvro class
+   Copyright (C) 2018-2024 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <unordered_map>
+#include <vector>
+
+#include "Builder.h"
+#include "../common/OracleColumn.h"
+#include "../common/OracleTable.h"
+#include "../common/table/SysCol.h"
+#include "../metadata/Metadata.h"
+
+#ifndef BUILDER_AVRO_H_
+#define BUILDER_AVRO_H_
+
+namespace OpenLogReplicator {
+    class State;
+
+    // Avro binary encoding, every message is framed as: magic byte 0, 4-byte big-endian schema id, datum
+    class BuilderAvro final : public Builder {
+    protected:
+        static constexpr uint64_t SCHEMA_FILE_MAX_SIZE = 16777216;
+
+        static constexpr uint8_t AVRO_TYPE_NONE = LOGICAL_TYPE_NONE;
+        static constexpr uint8_t AVRO_TYPE_BOOLEAN = LOGICAL_TYPE_BOOLEAN;
+        static constexpr uint8_t AVRO_TYPE_LONG = LOGICAL_TYPE_INT64;
+        static constexpr uint8_t AVRO_TYPE_FLOAT = LOGICAL_TYPE_FLOAT;
+        static constexpr uint8_t AVRO_TYPE_DOUBLE = LOGICAL_TYPE_DOUBLE;
+        static constexpr uint8_t AVRO_TYPE_BYTES = LOGICAL_TYPE_BINARY;
+        static constexpr uint8_t AVRO_TYPE_STRING = LOGICAL_TYPE_STRING;
+        static constexpr uint8_t AVRO_TYPE_TIMESTAMP = LOGICAL_TYPE_TIMESTAMP;
+
+        // Largest value (in seconds) which fits in a nanosecond precision Avro long
+        static constexpr time_t AVRO_TIMESTAMP_MAX = 9223372035;
+
+        struct AvroTable {
+            const OracleTable* table;
+            uint64_t version;
+            uint32_t schemaId;
+            std::vector<typeCol> columns;
+            std::vector<uint8_t> types;
+        };
+
+        std::string registryPath;
+        State* registry;
+        std::unordered_map<std::string, uint32_t> schemaIds;
+        uint32_t schemaMaxId;
+        uint32_t controlSchemaId;
+        std::unordered_map<typeObj, AvroTable*> avroTables;
+        uint8_t columnType;
+        bool columnWritten;
+
+        inline void appendAvroLong(int64_t value) {
+            uint64_t zigZag = (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+            while (zigZag > 0x7F) {
+                append(static_cast<char>((zigZag & 0x7F) | 0x80));
+                zigZag >>= 7;
+            }
+            append(static_cast<char>(zigZag));
+        }
+
+        inline void appendAvroBoolean(bool value) {
+            append(static_cast<char>(value ? 1 : 0));
+        }
+
+        inline void appendAvroFloat(float value) {
+            uint32_t bits;
+            memcpy(reinterpret_cast<void*>(&bits), reinterpret_cast<const void*>(&value), sizeof(bits));
+            for (uint64_t i = 0; i < sizeof(bits); ++i, bits >>= 8)
+                append(static_cast<char>(bits & 0xFF));
+        }
+
+        inline void appendAvroDouble(double value) {
+            uint64_t bits;
+            memcpy(reinterpret_cast<void*>(&bits), reinterpret_cast<const void*>(&value), sizeof(bits));
+            for (uint64_t i = 0; i < sizeof(bits); ++i, bits >>= 8)
+                append(static_cast<char>(bits & 0xFF));
+        }
+
+        inline void appendAvroString(const char* str, uint64_t length) {
+            appendAvroLong(static_cast<int64_t>(length));
+            append(str, length);
+        }
+
+        inline void appendAvroString(const std::string& str) {
+            appendAvroLong(static_cast<int64_t>(str.length()));
+            append(str);
+        }
+
+        inline void appendAvroNull() {
+            appendAvroLong(0);
+        }
+
+        inline void appendAvroPresent() {
+            appendAvroLong(1);
+        }
+
+        inline void appendFrame(uint32_t schemaId) {
+            append(static_cast<char>(0));
+            append(static_cast<char>((schemaId >> 24) & 0xFF));
+            append(static_cast<char>((schemaId >> 16) & 0xFF));
+            append(static_cast<char>((schemaId >> 8) & 0xFF));
+            append(static_cast<char>(schemaId & 0xFF));
+        }
+
+        // The union branch is chosen by the schema, a value of any other type stays null
+        inline bool columnBegin(uint8_t avroType) {
+            if (columnWritten || columnType != avroType)
+                return false;
+            appendAvroPresent();
+            columnWritten = true;
+            return true;
+        }
+
+        void appendXid();
+        void appendHeader(const char* operation, typeScn scn, time_t timestamp);
+        void appendControl(const char* operation, typeScn scn, time_t timestamp, bool showXid, bool showDb);
+        void appendRow(LobCtx* lobCtx, const XmlCtx* xmlCtx, const AvroTable* avroTable, uint64_t valueType, bool compressed, uint64_t offset);
+        AvroTable* getAvroTable(const OracleTable* table);
+        [[nodiscard]] uint32_t registerSchema(const std::string& schema);
+        static std::string avroName(const std::string& name);
+
+        void columnFloat(const std::string& columnName, double value) override;
+        void columnDouble(const std::string& columnName, long double value) override;
+        void columnString(const std::string& columnName) override;
+        void columnNumber(const std::string& columnName, uint64_t precision, uint64_t scale) override;
+        void columnRaw(const std::string& columnName, const uint8_t* data, uint64_t length) override;
+        void columnRowId(const std::string& columnName, typeRowId rowId) override;
+        void columnTimestamp(const std::string& columnName, time_t timestamp, uint64_t fraction) override;
+        void columnTimestampTz(const std::string& columnName, time_t timestamp, uint64_t fraction, const char* tz) override;
+        void processInsert(typeScn scn, typeSeq sequence, time_t timestamp, LobCtx* lobCtx, const XmlCtx* xmlCtx, const OracleTable* table, typeObj obj,
+                           typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid, uint64_t offset) override;
+        void processUpdate(typeScn scn, typeSeq sequence, time_t timestamp, LobCtx* lobCtx, const XmlCtx* xmlCtx, const OracleTable* table, typeObj obj,
+                           typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid, uint64_t offset) override;
+        void processDelete(typeScn scn, typeSeq sequence, time_t timestamp, LobCtx* lobCtx, const XmlCtx* xmlCtx, const OracleTable* table, typeObj obj,
+                           typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid, uint64_t offset) override;
+        void processDdl(typeScn scn, typeSeq sequence, time_t timestamp, const OracleTable* table, typeObj obj, typeDataObj dataObj, uint16_t type,
+                        uint16_t seq, const char* sql, uint64_t sqlLength,
+                        const char* owner, uint64_t ownerLength, const char* name, uint64_t nameLength) override;
+        void processBeginMessage(typeScn scn, typeSeq sequence, time_t timestamp) override;
+
+    public:
+        BuilderAvro(Ctx* newCtx, Locales* newLocales, Metadata* newMetadata, uint64_t newDbFormat, uint64_t newAttributesFormat,
+                    uint64_t newIntervalDtsFormat, uint64_t newIntervalYtmFormat, uint64_t newMessageFormat, uint64_t newRidFormat, uint64_t newXidFormat,
+                    uint64_t newTimestampFormat, uint64_t newTimestampTzFormat, uint64_t newTimestampAll, uint64_t newCharFormat, uint64_t newScnFormat,
+                    uint64_t newScnAll, uint64_t newUnknownFormat, uint64_t newSchemaFormat, uint64_t newColumnFormat, uint64_t newUnknownType,
+                    uint64_t newFlushBuffer, const char* newRegistryPath);
+        ~BuilderAvro() override;
+
+        void initialize() override;
+        void processCommit(typeScn scn, typeSeq sequence, time_t timestamp) override;
+        void processCheckpoint(typeScn scn, typeSeq sequence, time_t timestamp, uint64_t offset, bool redo) override;
+    };
+}
+
+#endif
@@ -17,6 +17,10 @@ You should have received a copy of the GNU General Public License
 along with OpenLogReplicator; see the file LICENSE;  If not see
 <http://www.gnu.org/licenses/>.  */
 
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+
 #include "../common/OracleTable.h"
 #include "../common/typeRowId.h"
 #include "../metadata/Metadata.h"
@@ -28,13 +32,18 @@ namespace OpenLogReplicator {
                              uint64_t newIntervalDtsFormat, uint64_t newIntervalYtmFormat, uint64_t newMessageFormat, uint64_t newRidFormat,
                              uint64_t newXidFormat, uint64_t newTimestampFormat, uint64_t newTimestampTzFormat, uint64_t newTimestampAll,
                              uint64_t newCharFormat, uint64_t newScnFormat, uint64_t newScnAll, uint64_t newUnknownFormat, uint64_t newSchemaFormat,
-                             uint64_t newColumnFormat, uint64_t newUnknownType, uint64_t newFlushBuffer) :
+                             uint64_t newColumnFormat, uint64_t newUnknownType, uint64_t newFlushBuffer,
+                             uint64_t newBatchRows, uint64_t newBatchBytes) :
             Builder(newCtx, newLocales, newMetadata, newDbFormat, newAttributesFormat, newIntervalDtsFormat, newIntervalYtmFormat, newMessageFormat,
                     newRidFormat, newXidFormat, newTimestampFormat, newTimestampTzFormat, newTimestampAll, newCharFormat, newScnFormat, newScnAll,
                     newUnknownFormat, newSchemaFormat, newColumnFormat, newUnknownType, newFlushBuffer),
             hasPreviousValue(false),
             hasPreviousRedo(false),
-            hasPreviousColumn(false) {
+            hasPreviousColumn(false),
+            batchRows(newBatchRows),
+            batchBytes(newBatchBytes),
+            batchCount(0),
+            batchObj(0) {
     }
 
     void BuilderJson::columnFloat(const std::string& columnName, double value) {
@@ -47,9 +56,21 @@ namespace OpenLogReplicator {
         appendEscape(columnName);
         append(R"(":)", sizeof(R"(":)") - 1);
 
-        std::ostringstream ss;
-        ss << value;
-        append(ss.str());
+        // Shortest text which parses back to the same value
+        char buffer[32];
+#ifdef __cpp_lib_to_chars
+        std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), static_cast<float>(value));
+        append(buffer, result.ptr - buffer);
+#else
+        // Floating point std::to_chars is missing before GCC 11, 9 digits are always enough for a float
+        int length = 0;
+        for (int precision = 6; precision <= 9; ++precision) {
+            length = snprintf(buffer, sizeof(buffer), "%.*g", precision, static_cast<double>(static_cast<float>(value)));
+            if (strtof(buffer, nullptr) == static_cast<float>(value))
+                break;
+        }
+        append(buffer, length);
+#endif
     }
 
     void BuilderJson::columnDouble(const std::string& columnName, long double value) {
@@ -62,9 +83,21 @@ namespace OpenLogReplicator {
         appendEscape(columnName);
         append(R"(":)", sizeof(R"(":)") - 1);
 
-        std::ostringstream ss;
-        ss << value;
-        append(ss.str());
+        // Shortest text which parses back to the same value
+        char buffer[32];
+#ifdef __cpp_lib_to_chars
+        std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), static_cast<double>(value));
+        append(buffer, result.ptr - buffer);
+#else
+        // Floating point std::to_chars is missing before GCC 11, 17 digits are always enough for a double
+        int length = 0;
+        for (int precision = 15; precision <= 17; ++precision) {
+            length = snprintf(buffer, sizeof(buffer), "%.*g", precision, static_cast<double>(value));
+            if (strtod(buffer, nullptr) == static_cast<double>(value))
+                break;
+        }
+        append(buffer, length);
+#endif
     }
 
     void BuilderJson::columnString(const std::string& columnName) {
@@ -92,6 +125,21 @@ namespace OpenLogReplicator {
         append(valueBuffer, valueLength);
     }
 
+    void BuilderJson::columnLobFile(const std::string& columnName) {
+        if (hasPreviousColumn)
+            append(',');
+        else
+            hasPreviousColumn = true;
+
+        append('"');
+        appendEscape(columnName);
+        append(R"(":{"file":")", sizeof(R"(":{"file":")") - 1);
+        appendEscape(lobFileName);
+        append(R"(","length":)", sizeof(R"(","length":)") - 1);
+        appendDec(lobFileLength);
+        append('}');
+    }
+
     void BuilderJson::columnRowId(const std::string& columnName, typeRowId rowId) {
         if (hasPreviousColumn)
             append(',');
@@ -208,7 +256,7 @@ namespace OpenLogReplicator {
             case TIMESTAMP_FORMAT_ISO8601_NANO_TZ:
                 // "2024-04-05T19:34:38.123456789Z"
                 append('"');
-                append(buffer, ctx->epochToIso8601(timestamp, buffer, true, false));
+                append(buffer, epochToIso8601(timestamp, buffer, true, false));
                 append('.');
                 appendDec(fraction, 9);
                 append(R"(Z")", sizeof(R"(Z")") - 1);
@@ -223,7 +271,7 @@ namespace OpenLogReplicator {
                     ++timestamp;
                 }
                 append('"');
-                append(buffer, ctx->epochToIso8601(timestamp, buffer, true, false));
+                append(buffer, epochToIso8601(timestamp, buffer, true, false));
                 append('.');
                 appendDec(fraction, 6);
                 append(R"(Z")", sizeof(R"(Z")") - 1);
@@ -238,7 +286,7 @@ namespace OpenLogReplicator {
                     ++timestamp;
                 }
                 append('"');
-                append(buffer, ctx->epochToIso8601(timestamp, buffer, true, false));
+                append(buffer, epochToIso8601(timestamp, buffer, true, false));
                 append('.');
                 appendDec(fraction, 3);
                 append(R"(Z")", sizeof(R"(Z")") - 1);
@@ -249,13 +297,13 @@ namespace OpenLogReplicator {
                 if (fraction >= 500000000)
                     ++timestamp;
                 append('"');
-                append(buffer, ctx->epochToIso8601(timestamp, buffer, true, false));
+                append(buffer, epochToIso8601(timestamp, buffer, true, false));
                 append(R"(Z")", sizeof(R"(Z")") - 1);
                 break;
             case TIMESTAMP_FORMAT_ISO8601_NANO:
                 // "2024-04-05 19:34:38.123456789"
                 append('"');
-                append(buffer, ctx->epochToIso8601(timestamp, buffer, false, false));
+                append(buffer, epochToIso8601(timestamp, buffer, false, false));
                 append('.');
                 appendDec(fraction, 9);
                 append('"');
@@ -270,7 +318,7 @@ namespace OpenLogReplicator {
                     ++timestamp;
                 }
                 append('"');
-                append(buffer, ctx->epochToIso8601(timestamp, buffer, false, false));
+                append(buffer, epochToIso8601(timestamp, buffer, false, false));
                 append('.');
                 appendDec(fraction, 6);
                 append('"');
@@ -285,7 +333,7 @@ namespace OpenLogReplicator {
                     ++timestamp;
                 }
                 append('"');
-                append(buffer, ctx->epochToIso8601(timestamp, buffer, false, false));
+                append(buffer, epochToIso8601(timestamp, buffer, false, false));
                 append('.');
                 appendDec(fraction, 3);
                 append('"');
@@ -296,7 +344,7 @@ namespace OpenLogReplicator {
                 if (fraction >= 500000000)
                     ++timestamp;
                 append('"');
-                append(buffer, ctx->epochToIso8601(timestamp, buffer, false, false));
+                append(buffer, epochToIso8601(timestamp, buffer, false, false));
                 append('"');
                 break;
         }
@@ -365,7 +413,7 @@ namespace OpenLogReplicator {
             case TIMESTAMP_TZ_FORMAT_ISO8601_NANO_TZ:
                 // "2024-04-05T19:34:38.123456789Z Europe/Warsaw"
                 append('"');
-                append(buffer, ctx->epochToIso8601(timestamp, buffer, true, false));
+                append(buffer, epochToIso8601(timestamp, buffer, true, false));
                 append('.');
                 appendDec(fraction, 9);
                 append("Z ", sizeof("Z ") - 1);
@@ -382,7 +430,7 @@ namespace OpenLogReplicator {
                     ++timestamp;
                 }
                 append('"');
-                append(buffer, ctx->epochToIso8601(timestamp, buffer, true, false));
+                append(buffer, epochToIso8601(timestamp, buffer, true, false));
                 append('.');
                 appendDec(fraction, 6);
                 append("Z ", sizeof("Z ") - 1);
@@ -399,7 +447,7 @@ namespace OpenLogReplicator {
                     ++timestamp;
                 }
                 append('"');
-                append(buffer, ctx->epochToIso8601(timestamp, buffer, true, false));
+                append(buffer, epochToIso8601(timestamp, buffer, true, false));
                 append('.');
                 appendDec(fraction, 3);
                 append("Z ", sizeof("Z ") - 1);
@@ -412,7 +460,7 @@ namespace OpenLogReplicator {
                 if (fraction >= 500000000)
                     ++timestamp;
                 append('"');
-                append(buffer, ctx->epochToIso8601(timestamp, buffer, true, false));
+                append(buffer, epochToIso8601(timestamp, buffer, true, false));
                 append("Z ", sizeof("Z ") - 1);
                 append(tz);
                 append('"');
@@ -421,7 +469,7 @@ namespace OpenLogReplicator {
             case TIMESTAMP_TZ_FORMAT_ISO8601_NANO:
                 // "2024-04-05 19:34:38.123456789,Europe/Warsaw"
                 append('"');
-                append(buffer, ctx->epochToIso8601(timestamp, buffer, false, false));
+                append(buffer, epochToIso8601(timestamp, buffer, false, false));
                 append('.');
                 appendDec(fraction, 9);
                 append(' ');
@@ -438,7 +486,7 @@ namespace OpenLogReplicator {
                     ++timestamp;
                 }
                 append('"');
-                append(buffer, ctx->epochToIso8601(timestamp, buffer, false, false));
+                append(buffer, epochToIso8601(timestamp, buffer, false, false));
                 append('.');
                 appendDec(fraction, 6);
                 append(' ');
@@ -455,7 +503,7 @@ namespace OpenLogReplicator {
                     ++timestamp;
                 }
                 append('"');
-                append(buffer, ctx->epochToIso8601(timestamp, buffer, false, false));
+                append(buffer, epochToIso8601(timestamp, buffer, false, false));
                 append('.');
                 appendDec(fraction, 3);
                 append(' ');
@@ -468,7 +516,7 @@ namespace OpenLogReplicator {
                 if (fraction >= 500000000)
                     ++timestamp;
                 append('"');
-                append(buffer, ctx->epochToIso8601(timestamp, buffer, false, false));
+                append(buffer, epochToIso8601(timestamp, buffer, false, false));
                 append(' ');
                 append(tz);
                 append('"');
@@ -504,6 +552,39 @@ namespace OpenLogReplicator {
         }
     }
 
+    void BuilderJson::processBatchBegin(typeScn scn, typeSeq sequence, time_t timestamp, typeObj obj) {
+        // Consecutive rows of the same table share one message and one header
+        if (batchCount > 0) {
+            if (batchObj == obj) {
+                append(',');
+                return;
+            }
+            processBatchEnd();
+        }
+
+        batchObj = obj;
+        builderBegin(scn, sequence, obj, 0);
+        append('{');
+        hasPreviousValue = false;
+        appendHeader(scn, timestamp, false, (dbFormat & DB_FORMAT_ADD_DML) != 0, true);
+
+        if (hasPreviousValue)
+            append(',');
+        else
+            hasPreviousValue = true;
+
+        if ((attributesFormat & ATTRIBUTES_FORMAT_DML) != 0)
+            appendAttributes();
+
+        append(R"("payload":[)", sizeof(R"("payload":[)") - 1);
+    }
+
+    void BuilderJson::processBatchEnd() {
+        append("]}", sizeof("]}") - 1);
+        builderCommit(false);
+        batchCount = 0;
+    }
+
     void BuilderJson::processCommit(typeScn scn, typeSeq sequence, time_t timestamp) {
         // Skip empty transaction
         if (newTran) {
@@ -511,6 +592,9 @@ namespace OpenLogReplicator {
             return;
         }
 
+        if (batchCount > 0)
+            processBatchEnd();
+
         if ((messageFormat & MESSAGE_FORMAT_FULL) != 0) {
             append("]}", sizeof("]}") - 1);
             builderCommit(true);
@@ -545,6 +629,8 @@ namespace OpenLogReplicator {
                 append(',');
             else
                 hasPreviousRedo = true;
+        } else if ((messageFormat & MESSAGE_FORMAT_BATCH) != 0) {
+            processBatchBegin(scn, sequence, timestamp, obj);
         } else {
             builderBegin(scn, sequence, obj, 0);
             append('{');
@@ -573,7 +659,11 @@ namespace OpenLogReplicator {
         appendAfter(lobCtx, xmlCtx, table, offset);
         append('}');
 
-        if ((messageFormat & MESSAGE_FORMAT_FULL) == 0) {
+        if ((messageFormat & MESSAGE_FORMAT_BATCH) != 0) {
+            ++batchCount;
+            if (batchCount >= batchRows || messageLength + messagePosition >= batchBytes)
+                processBatchEnd();
+        } else if ((messageFormat & MESSAGE_FORMAT_FULL) == 0) {
             append("]}", sizeof("]}") - 1);
             builderCommit(false);
         }
@@ -590,6 +680,8 @@ namespace OpenLogReplicator {
                 append(',');
             else
                 hasPreviousRedo = true;
+        } else if ((messageFormat & MESSAGE_FORMAT_BATCH) != 0) {
+            processBatchBegin(scn, sequence, timestamp, obj);
         } else {
             builderBegin(scn, sequence, obj, 0);
             append('{');
@@ -617,9 +709,15 @@ namespace OpenLogReplicator {
         appendRowid(dataObj, bdba, slot);
         appendBefore(lobCtx, xmlCtx, table, offset);
         appendAfter(lobCtx, xmlCtx, table, offset);
+        if ((messageFormat & MESSAGE_FORMAT_CHANGED) != 0)
+            appendChanged(table);
         append('}');
 
-        if ((messageFormat & MESSAGE_FORMAT_FULL) == 0) {
+        if ((messageFormat & MESSAGE_FORMAT_BATCH) != 0) {
+            ++batchCount;
+            if (batchCount >= batchRows || messageLength + messagePosition >= batchBytes)
+                processBatchEnd();
+        } else if ((messageFormat & MESSAGE_FORMAT_FULL) == 0) {
             append("]}", sizeof("]}") - 1);
             builderCommit(false);
         }
@@ -636,6 +734,8 @@ namespace OpenLogReplicator {
                 append(',');
             else
                 hasPreviousRedo = true;
+        } else if ((messageFormat & MESSAGE_FORMAT_BATCH) != 0) {
+            processBatchBegin(scn, sequence, timestamp, obj);
         } else {
             builderBegin(scn, sequence, obj, 0);
             append('{');
@@ -664,7 +764,11 @@ namespace OpenLogReplicator {
         appendBefore(lobCtx, xmlCtx, table, offset);
         append('}');
 
-        if ((messageFormat & MESSAGE_FORMAT_FULL) == 0) {
+        if ((messageFormat & MESSAGE_FORMAT_BATCH) != 0) {
+            ++batchCount;
+            if (batchCount >= batchRows || messageLength + messagePosition >= batchBytes)
+                processBatchEnd();
+        } else if ((messageFormat & MESSAGE_FORMAT_FULL) == 0) {
             append("]}", sizeof("]}") - 1);
             builderCommit(false);
         }
@@ -677,6 +781,9 @@ namespace OpenLogReplicator {
         if (newTran)
             processBeginMessage(scn, sequence, timestamp);
 
+        if (batchCount > 0)
+            processBatchEnd();
+
         if ((messageFormat & MESSAGE_FORMAT_FULL) != 0) {
             if (hasPreviousRedo)
                 append(',');
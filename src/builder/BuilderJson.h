@@ -33,6 +33,10 @@ namespace OpenLogReplicator {
         bool hasPreviousValue;
         bool hasPreviousRedo;
         bool hasPreviousColumn;
+        uint64_t batchRows;
+        uint64_t batchBytes;
+        uint64_t batchCount;
+        typeObj batchObj;
 
         inline void columnNull(const OracleTable* table, typeCol col, bool after) {
             if (table != nullptr && unknownType == UNKNOWN_TYPE_HIDE) {
@@ -182,49 +186,49 @@ namespace OpenLogReplicator {
 
                     case TIMESTAMP_FORMAT_ISO8601_NANO_TZ:
                         append(R"("tms":")", sizeof(R"("tms":")") - 1);
-                        append(buffer, ctx->epochToIso8601(timestamp, buffer, true, false));
+                        append(buffer, epochToIso8601(timestamp, buffer, true, false));
                         append(R"(.000000000Z")", sizeof(R"(.000000000Z")") - 1);
                         break;
 
                     case TIMESTAMP_FORMAT_ISO8601_MICRO_TZ:
                         append(R"("tms":")", sizeof(R"("tms":")") - 1);
-                        append(buffer, ctx->epochToIso8601(timestamp, buffer, true, true));
+                        append(buffer, epochToIso8601(timestamp, buffer, true, false));
                         append(R"(.000000Z")", sizeof(R"(.000000Z")") - 1);
                         break;
 
                     case TIMESTAMP_FORMAT_ISO8601_MILLI_TZ:
                         append(R"("tms":")", sizeof(R"("tms":")") - 1);
-                        append(buffer, ctx->epochToIso8601(timestamp, buffer, true, false));
+                        append(buffer, epochToIso8601(timestamp, buffer, true, false));
                         append(R"(.000Z")", sizeof(R"(.000Z")") - 1);
                         break;
 
                     case TIMESTAMP_FORMAT_ISO8601_TZ:
                         append(R"("tms":")", sizeof(R"("tms":")") - 1);
-                        append(buffer, ctx->epochToIso8601(timestamp, buffer, true, true));
+                        append(buffer, epochToIso8601(timestamp, buffer, true, true));
                         append('"');
                         break;
 
                     case TIMESTAMP_FORMAT_ISO8601_NANO:
                         append(R"("tms":")", sizeof(R"("tms":")") - 1);
-                        append(buffer, ctx->epochToIso8601(timestamp, buffer, false, false));
+                        append(buffer, epochToIso8601(timestamp, buffer, false, false));
                         append(R"(.000000000")", sizeof(R"(.000000000")") - 1);
                         break;
 
                     case TIMESTAMP_FORMAT_ISO8601_MICRO:
                         append(R"("tms":")", sizeof(R"("tms":")") - 1);
-                        append(buffer, ctx->epochToIso8601(timestamp, buffer, false, false));
+                        append(buffer, epochToIso8601(timestamp, buffer, false, false));
                         append(R"(.000000")", sizeof(R"(.000000")") - 1);
                         break;
 
                     case TIMESTAMP_FORMAT_ISO8601_MILLI:
                         append(R"("tms":")", sizeof(R"("tms":")") - 1);
-                        append(buffer, ctx->epochToIso8601(timestamp, buffer, false, false));
+                        append(buffer, epochToIso8601(timestamp, buffer, false, false));
                         append(R"(.000")", sizeof(R"(.000")") - 1);
                         break;
 
                     case TIMESTAMP_FORMAT_ISO8601:
                         append(R"("tms":")", sizeof(R"("tms":")") - 1);
-                        append(buffer, ctx->epochToIso8601(timestamp, buffer, false, false));
+                        append(buffer, epochToIso8601(timestamp, buffer, false, false));
                         append('"');
                         break;
                 }
@@ -353,7 +357,7 @@ namespace OpenLogReplicator {
 
                 bool hasPrev = false;
                 for (typeCol column = 0; column < static_cast<typeCol>(table->columns.size()); ++column) {
-                    if (table->columns[column] == nullptr)
+                    if (table->columns[column] == nullptr || !table->isProjected(column))
                         continue;
 
                     if (hasPrev)
@@ -624,7 +628,7 @@ namespace OpenLogReplicator {
             hasPreviousColumn = false;
             if (columnFormat > 0 && table != nullptr) {
                 for (typeCol column = 0; column < table->maxSegCol; ++column) {
-                    if (values[column][VALUE_AFTER] != nullptr) {
+                    if (values[column][VALUE_AFTER] != nullptr && table->isProjected(column)) {
                         if (lengths[column][VALUE_AFTER] > 0)
                             processValue(lobCtx, xmlCtx, table, column, values[column][VALUE_AFTER], lengths[column][VALUE_AFTER], offset, true,
                                          compressedAfter);
@@ -641,6 +645,8 @@ namespace OpenLogReplicator {
                             break;
                         if ((valuesSet[base] & mask) == 0)
                             continue;
+                        if (table != nullptr && !table->isProjected(column))
+                            continue;
 
                         if (values[column][VALUE_AFTER] != nullptr) {
                             if (lengths[column][VALUE_AFTER] > 0)
@@ -655,13 +661,55 @@ namespace OpenLogReplicator {
             append('}');
         }
 
+        inline void appendChanged(const OracleTable* table) {
+            // Values of compressed rows are not compared
+            if (compressedBefore || compressedAfter)
+                return;
+
+            append(R"(,"changed":[)", sizeof(R"(,"changed":[)") - 1);
+            bool hasPreviousChanged = false;
+            uint64_t baseMax = valuesMax >> 6;
+            for (uint64_t base = 0; base <= baseMax; ++base) {
+                auto column = static_cast<typeCol>(base << 6);
+                for (uint64_t mask = 1; mask != 0; mask <<= 1, ++column) {
+                    if (valuesChanged[base] < mask)
+                        break;
+                    if ((valuesChanged[base] & mask) == 0)
+                        continue;
+                    if (table != nullptr) {
+                        if (!table->isProjected(column))
+                            continue;
+                        if (table->columns[column]->guard && !ctx->flagsSet(Ctx::REDO_FLAGS_SHOW_GUARD_COLUMNS))
+                            continue;
+                        if (table->columns[column]->hidden && !ctx->flagsSet(Ctx::REDO_FLAGS_SHOW_HIDDEN_COLUMNS))
+                            continue;
+                    }
+
+                    if (hasPreviousChanged)
+                        append(',');
+                    else
+                        hasPreviousChanged = true;
+
+                    append('"');
+                    if (table != nullptr)
+                        appendEscape(table->columns[column]->name);
+                    else {
+                        std::string columnName("COL_" + std::to_string(column));
+                        append(columnName);
+                    }
+                    append('"');
+                }
+            }
+            append(']');
+        }
+
         inline void appendBefore(LobCtx* lobCtx, const XmlCtx* xmlCtx, const OracleTable* table, uint64_t offset) {
             append(R"(,"before":{)", sizeof(R"(,"before":{)") - 1);
 
             hasPreviousColumn = false;
             if (columnFormat > 0 && table != nullptr) {
                 for (typeCol column = 0; column < table->maxSegCol; ++column) {
-                    if (values[column][VALUE_BEFORE] != nullptr) {
+                    if (values[column][VALUE_BEFORE] != nullptr && table->isProjected(column)) {
                         if (lengths[column][VALUE_BEFORE] > 0)
                             processValue(lobCtx, xmlCtx, table, column, values[column][VALUE_BEFORE], lengths[column][VALUE_BEFORE], offset,
                                          false, compressedBefore);
@@ -678,6 +726,8 @@ namespace OpenLogReplicator {
                             break;
                         if ((valuesSet[base] & mask) == 0)
                             continue;
+                        if (table != nullptr && !table->isProjected(column))
+                            continue;
 
                         if (values[column][VALUE_BEFORE] != nullptr) {
                             if (lengths[column][VALUE_BEFORE] > 0)
@@ -701,6 +751,7 @@ namespace OpenLogReplicator {
         virtual void columnRowId(const std::string& columnName, typeRowId rowId) override;
         virtual void columnTimestamp(const std::string& columnName, time_t timestamp, uint64_t fraction) override;
         virtual void columnTimestampTz(const std::string& columnName, time_t timestamp, uint64_t fraction, const char* tz) override;
+        virtual void columnLobFile(const std::string& columnName) override;
         virtual void processInsert(typeScn scn, typeSeq sequence, time_t timestamp, LobCtx* lobCtx, const XmlCtx* xmlCtx, const OracleTable* table, typeObj obj,
                                    typeDataObj dataObj, typeDba bdba, typeSlot slot, typeXid xid, uint64_t offset) override;
         virtual void processUpdate(typeScn scn, typeSeq sequence, time_t timestamp, LobCtx* lobCtx, const XmlCtx* xmlCtx, const OracleTable* table, typeObj obj,
@@ -710,12 +761,15 @@ namespace OpenLogReplicator {
         virtual void processDdl(typeScn scn, typeSeq sequence, time_t timestamp, const OracleTable* table, typeObj obj, typeDataObj dataObj, uint16_t type,
                                 uint16_t seq, const char* sql, uint64_t sqlLength, const char* owner, uint64_t ownerLength, const char* name, uint64_t nameLength) override;
         virtual void processBeginMessage(typeScn scn, typeSeq sequence, time_t timestamp) override;
+        void processBatchBegin(typeScn scn, typeSeq sequence, time_t timestamp, typeObj obj);
+        void processBatchEnd();
 
     public:
         BuilderJson(Ctx* newCtx, Locales* newLocales, Metadata* newMetadata, uint64_t newDbFormat, uint64_t newAttributesFormat, uint64_t newIntervalDtsFormat,
                     uint64_t newIntervalYtmFormat, uint64_t newMessageFormat, uint64_t newRidFormat, uint64_t newXidFormat, uint64_t newTimestampFormat,
                     uint64_t newTimestampTzFormat, uint64_t newTimestampAll, uint64_t newCharFormat, uint64_t newScnFormat, uint64_t newScnAll,
-                    uint64_t newUnknownFormat, uint64_t newSchemaFormat, uint64_t newColumnFormat, uint64_t newUnknownType, uint64_t newFlushBuffer);
+                    uint64_t newUnknownFormat, uint64_t newSchemaFormat, uint64_t newColumnFormat, uint64_t newUnknownType, uint64_t newFlushBuffer,
+                    uint64_t newBatchRows, uint64_t newBatchBytes);
 
         virtual void processCommit(typeScn scn, typeSeq sequence, time_t timestamp) override;
         virtual void processCheckpoint(typeScn scn, typeSeq sequence, time_t timestamp, uint64_t offset, bool redo) override;
@@ -0,0 +1,221 @@
+/* Pool of threads formatting committed transactions
+   Copyright (C) 2018-2024 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include "../common/Ctx.h"
+#include "../parser/Transaction.h"
+#include "../parser/TransactionBuffer.h"
+#include "Builder.h"
+#include "BuilderPool.h"
+#include "BuilderWorker.h"
+
+namespace OpenLogReplicator {
+    BuilderPool::BuilderPool(Ctx* newCtx, Builder* newBuilder, Metadata* newMetadata, TransactionBuffer* newTransactionBuffer) :
+            ctx(newCtx),
+            builder(newBuilder),
+            metadata(newMetadata),
+            transactionBuffer(newTransactionBuffer),
+            publishing(false),
+            lwnScn(Ctx::ZERO_SCN),
+            lwnSlot(0) {
+    }
+
+    BuilderPool::~BuilderPool() {
+        for (BuilderWorker* worker: workers)
+            delete worker;
+        workers.clear();
+
+        // Transactions not published before shutdown
+        for (BuilderTask* task: publishTasks)
+            finishedTasks.push_back(task);
+        publishTasks.clear();
+        formatTasks.clear();
+        release();
+    }
+
+    void BuilderPool::addWorker(Builder* newBuilder, const std::string& newAlias) {
+        auto worker = new BuilderWorker(ctx, newAlias, this, newBuilder, metadata);
+        workers.push_back(worker);
+        ctx->spawnThread(worker);
+    }
+
+    void BuilderPool::processTransaction(Transaction* transaction, typeScn newLwnScn) {
+        release();
+
+        auto task = new BuilderTask();
+        task->transaction = transaction;
+        task->worker = nullptr;
+        task->lwnScn = newLwnScn;
+        task->lwnIdx = nextLwnIdx(newLwnScn);
+        task->ready = false;
+
+        std::unique_lock<std::mutex> lck(mtx);
+        // Transactions are released only after publishing, the parser waits when the workers do not keep up
+        while (publishTasks.size() >= workers.size() * TASKS_PER_WORKER && !ctx->hardShutdown) {
+            if (ctx->trace & Ctx::TRACE_SLEEP)
+                ctx->logTrace(Ctx::TRACE_SLEEP, "BuilderPool:processTransaction");
+            condPublished.wait(lck);
+        }
+        formatTasks.push_back(task);
+        publishTasks.push_back(task);
+        condWorker.notify_one();
+    }
+
+    void BuilderPool::processCheckpoint(typeScn scn, typeSeq sequence, time_t timestamp, uint64_t offset, bool redo) {
+        release();
+
+        auto task = new BuilderTask();
+        task->transaction = nullptr;
+        task->worker = nullptr;
+        task->lwnScn = scn;
+        task->lwnIdx = nextLwnIdx(scn);
+        task->scn = scn;
+        task->sequence = sequence;
+        task->timestamp = timestamp;
+        task->offset = offset;
+        task->redo = redo;
+        task->ready = true;
+
+        std::unique_lock<std::mutex> lck(mtx);
+        publishTasks.push_back(task);
+        publish(lck);
+    }
+
+    void BuilderPool::drain() {
+        {
+            std::unique_lock<std::mutex> lck(mtx);
+            while ((!publishTasks.empty() || publishing) && !ctx->hardShutdown) {
+                if (ctx->trace & Ctx::TRACE_SLEEP)
+                    ctx->logTrace(Ctx::TRACE_SLEEP, "BuilderPool:drain");
+                condPublished.wait(lck);
+            }
+        }
+
+        release();
+    }
+
+    void BuilderPool::drain(typeScn newLwnScn) {
+        drain();
+
+        // Output formatted next by the parser thread takes the next range of positions of the LWN
+        builder->lwnScn = newLwnScn;
+        builder->lwnIdx = nextLwnIdx(newLwnScn);
+    }
+
+    typeIdx BuilderPool::nextLwnIdx(typeScn newLwnScn) {
+        if (lwnScn != newLwnScn) {
+            lwnScn = newLwnScn;
+            lwnSlot = 0;
+        }
+        return (lwnSlot++) << LWN_SLOT_BITS;
+    }
+
+    uint64_t BuilderPool::getMaxMessageMb() const {
+        return builder->getMaxMessageMb();
+    }
+
+    bool BuilderPool::getMessageTags() const {
+        return builder->getMessageTags();
+    }
+
+    BuilderTask* BuilderPool::formatBegin(BuilderWorker* worker) {
+        std::unique_lock<std::mutex> lck(mtx);
+        while (!ctx->hardShutdown) {
+            if (!formatTasks.empty()) {
+                BuilderTask* task = formatTasks.front();
+                formatTasks.pop_front();
+                task->worker = worker;
+                return task;
+            }
+
+            if (ctx->softShutdown && ctx->replicatorFinished)
+                break;
+
+            if (ctx->trace & Ctx::TRACE_SLEEP)
+                ctx->logTrace(Ctx::TRACE_SLEEP, "BuilderPool:formatBegin");
+            condWorker.wait(lck);
+        }
+        return nullptr;
+    }
+
+    void BuilderPool::formatEnd(BuilderWorker* worker, BuilderTask* task) {
+        std::unique_lock<std::mutex> lck(mtx);
+        task->ready = true;
+        worker->pending = true;
+        publish(lck);
+
+        // The private queue of the worker is reused after the output is copied to the builder
+        while (worker->pending && !ctx->hardShutdown)
+            condPublished.wait(lck);
+    }
+
+    void BuilderPool::publish(std::unique_lock<std::mutex>& lck) {
+        // Some other thread is already publishing in order
+        if (publishing)
+            return;
+        publishing = true;
+
+        while (!publishTasks.empty() && publishTasks.front()->ready && !ctx->hardShutdown) {
+            BuilderTask* task = publishTasks.front();
+            publishTasks.pop_front();
+
+            lck.unlock();
+            if (task->transaction != nullptr)
+                builder->appendSegment(task->worker->builder, task->lwnScn, task->lwnIdx);
+            else {
+                builder->lwnScn = task->lwnScn;
+                builder->lwnIdx = task->lwnIdx;
+                builder->processCheckpoint(task->scn, task->sequence, task->timestamp, task->offset, task->redo);
+            }
+            lck.lock();
+
+            if (task->worker != nullptr)
+                task->worker->pending = false;
+            finishedTasks.push_back(task);
+            condPublished.notify_all();
+        }
+
+        publishing = false;
+        condPublished.notify_all();
+    }
+
+    void BuilderPool::release() {
+        // Transaction chunks are returned to the transaction buffer by the parser thread only
+        std::vector<BuilderTask*> tasks;
+        {
+            std::unique_lock<std::mutex> lck(mtx);
+            if (finishedTasks.empty())
+                return;
+            tasks.swap(finishedTasks);
+        }
+
+        for (BuilderTask* task: tasks) {
+            if (task->transaction != nullptr) {
+                task->transaction->purge(transactionBuffer);
+                delete task->transaction;
+            }
+            delete task;
+        }
+    }
+
+    void BuilderPool::wakeUp() {
+        std::unique_lock<std::mutex> lck(mtx);
+        condWorker.notify_all();
+        condPublished.notify_all();
+    }
+}
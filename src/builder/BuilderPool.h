@@ -0,0 +1,99 @@
+/* Header for BuilderPool class
+   Copyright (C) 2018-2024 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../common/types.h"
+
+#ifndef BUILDER_POOL_H_
+#define BUILDER_POOL_H_
+
+namespace OpenLogReplicator {
+    class Builder;
+    class BuilderWorker;
+    class Ctx;
+    class Metadata;
+    class Transaction;
+    class TransactionBuffer;
+
+    struct BuilderTask {
+        Transaction* transaction;
+        BuilderWorker* worker;
+        typeScn lwnScn;
+        typeIdx lwnIdx;
+        typeScn scn;
+        typeSeq sequence;
+        time_t timestamp;
+        uint64_t offset;
+        bool redo;
+        bool ready;
+    };
+
+    // Committed transactions are formatted by workers in parallel, the output is published to the builder in commit order
+    class BuilderPool final {
+    protected:
+        // Every transaction and checkpoint of an LWN gets own range of positions, known before it is formatted
+        static constexpr uint64_t LWN_SLOT_BITS = 32;
+        static constexpr uint64_t TASKS_PER_WORKER = 4;
+
+        Ctx* ctx;
+        Builder* builder;
+        Metadata* metadata;
+        TransactionBuffer* transactionBuffer;
+        std::vector<BuilderWorker*> workers;
+
+        std::mutex mtx;
+        std::condition_variable condWorker;
+        std::condition_variable condPublished;
+        std::deque<BuilderTask*> formatTasks;
+        std::deque<BuilderTask*> publishTasks;
+        std::vector<BuilderTask*> finishedTasks;
+        bool publishing;
+        // Used by the parser thread only
+        typeScn lwnScn;
+        uint64_t lwnSlot;
+
+        [[nodiscard]] typeIdx nextLwnIdx(typeScn newLwnScn);
+        void publish(std::unique_lock<std::mutex>& lck);
+        void release();
+
+    public:
+        BuilderPool(Ctx* newCtx, Builder* newBuilder, Metadata* newMetadata, TransactionBuffer* newTransactionBuffer);
+        virtual ~BuilderPool();
+
+        void addWorker(Builder* newBuilder, const std::string& newAlias);
+        void processTransaction(Transaction* transaction, typeScn newLwnScn);
+        void processCheckpoint(typeScn scn, typeSeq sequence, time_t timestamp, uint64_t offset, bool redo);
+        void drain();
+        void drain(typeScn newLwnScn);
+        [[nodiscard]] uint64_t getMaxMessageMb() const;
+        [[nodiscard]] bool getMessageTags() const;
+
+        // Used by worker threads
+        [[nodiscard]] BuilderTask* formatBegin(BuilderWorker* worker);
+        void formatEnd(BuilderWorker* worker, BuilderTask* task);
+        void wakeUp();
+    };
+}
+
+#endif
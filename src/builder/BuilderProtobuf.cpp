@@ -17,6 +17,9 @@ You should have received a copy of the GNU General Public License
 along with OpenLogReplicator; see the file LICENSE;  If not see
 <http://www.gnu.org/licenses/>.  */
 
+#include <climits>
+#include <google/protobuf/io/coded_stream.h>
+
 #include "../common/OracleColumn.h"
 #include "../common/OracleTable.h"
 #include "../common/typeRowId.h"
@@ -27,6 +30,32 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 #include "BuilderProtobuf.h"
 
 namespace OpenLogReplicator {
+    BuilderProtobuf::OutputStream::OutputStream(BuilderProtobuf* newBuilder) :
+            builder(newBuilder),
+            byteCount(0) {
+    }
+
+    bool BuilderProtobuf::OutputStream::Next(void** data, int* size) {
+        if (builder->lastBuilderQueue->length + builder->messagePosition >= OUTPUT_BUFFER_DATA_SIZE)
+            builder->builderRotate(true);
+
+        uint64_t available = OUTPUT_BUFFER_DATA_SIZE - builder->lastBuilderQueue->length - builder->messagePosition;
+        *data = builder->lastBuilderQueue->data + builder->lastBuilderQueue->length + builder->messagePosition;
+        *size = static_cast<int>(available);
+        builder->messagePosition += available;
+        byteCount += static_cast<int64_t>(available);
+        return true;
+    }
+
+    void BuilderProtobuf::OutputStream::BackUp(int count) {
+        builder->messagePosition -= count;
+        byteCount -= count;
+    }
+
+    int64_t BuilderProtobuf::OutputStream::ByteCount() const {
+        return byteCount;
+    }
+
     BuilderProtobuf::BuilderProtobuf(Ctx* newCtx, Locales* newLocales, Metadata* newMetadata, uint64_t newDbFormat, uint64_t newAttributesFormat,
                                      uint64_t newIntervalDtsFormat, uint64_t newIntervalYtmFormat, uint64_t newMessageFormat, uint64_t newRidFormat,
                                      uint64_t newXidFormat, uint64_t newTimestampFormat, uint64_t newTimestampTzFormat, uint64_t newTimestampAll,
@@ -35,6 +64,8 @@ namespace OpenLogReplicator {
             Builder(newCtx, newLocales, newMetadata, newDbFormat, newAttributesFormat, newIntervalDtsFormat, newIntervalYtmFormat, newMessageFormat,
                     newRidFormat, newXidFormat, newTimestampFormat, newTimestampTzFormat, newTimestampAll, newCharFormat, newScnFormat, newScnAll,
                     newUnknownFormat, newSchemaFormat, newColumnFormat, newUnknownType, newFlushBuffer),
+            arenaPB(nullptr),
+            redoResponseArenaPB(nullptr),
             redoResponsePB(nullptr),
             valuePB(nullptr),
             payloadPB(nullptr),
@@ -42,13 +73,43 @@ namespace OpenLogReplicator {
     }
 
     BuilderProtobuf::~BuilderProtobuf() {
-        if (redoResponsePB != nullptr) {
-            delete redoResponsePB;
-            redoResponsePB = nullptr;
+        redoResponsePB = nullptr;
+        redoResponseArenaPB = nullptr;
+        if (arenaPB != nullptr) {
+            delete arenaPB;
+            arenaPB = nullptr;
         }
         google::protobuf::ShutdownProtobufLibrary();
     }
 
+    void BuilderProtobuf::appendResponse(const char* operation) {
+        uint64_t size = redoResponsePB->ByteSizeLong();
+        if (size > INT_MAX)
+            throw RuntimeException(50017, "PB " + std::string(operation) + " processing failed, error serializing message");
+
+        if (lastBuilderQueue->length + messagePosition + size < OUTPUT_BUFFER_DATA_SIZE) {
+            // Serialize directly to the output buffer
+            redoResponsePB->SerializeWithCachedSizesToArray(lastBuilderQueue->data + lastBuilderQueue->length + messagePosition);
+            messagePosition += size;
+        } else {
+            // Message spans across output buffer chunks
+            bool ret;
+            {
+                OutputStream outputStream(this);
+                google::protobuf::io::CodedOutputStream codedOutputStream(&outputStream);
+                redoResponsePB->SerializeWithCachedSizes(&codedOutputStream);
+                ret = !codedOutputStream.HadError();
+            }
+            if (!ret)
+                throw RuntimeException(50017, "PB " + std::string(operation) + " processing failed, error serializing message");
+
+            if (lastBuilderQueue->length + messagePosition >= OUTPUT_BUFFER_DATA_SIZE)
+                builderRotate(true);
+        }
+
+        releaseResponse();
+    }
+
     void BuilderProtobuf::columnFloat(const std::string& columnName, double value) {
         valuePB->set_name(columnName);
         valuePB->set_value_double(value);
@@ -119,14 +180,7 @@ namespace OpenLogReplicator {
             payloadPB = redoResponsePB->mutable_payload(redoResponsePB->payload_size() - 1);
             payloadPB->set_op(pb::BEGIN);
 
-            std::string output;
-            bool ret = redoResponsePB->SerializeToString(&output);
-            delete redoResponsePB;
-            redoResponsePB = nullptr;
-
-            if (!ret)
-                throw RuntimeException(50017, "PB begin processing failed, error serializing to string");
-            append(output);
+            appendResponse("begin");
             builderCommit(false);
         }
     }
@@ -155,14 +209,7 @@ namespace OpenLogReplicator {
         appendAfter(lobCtx, xmlCtx, table, offset);
 
         if ((messageFormat & MESSAGE_FORMAT_FULL) == 0) {
-            std::string output;
-            bool ret = redoResponsePB->SerializeToString(&output);
-            delete redoResponsePB;
-            redoResponsePB = nullptr;
-
-            if (!ret)
-                throw RuntimeException(50017, "PB insert processing failed, error serializing to string");
-            append(output);
+            appendResponse("insert");
             builderCommit(false);
         }
         ++num;
@@ -193,14 +240,7 @@ namespace OpenLogReplicator {
         appendAfter(lobCtx, xmlCtx, table, offset);
 
         if ((messageFormat & MESSAGE_FORMAT_FULL) == 0) {
-            std::string output;
-            bool ret = redoResponsePB->SerializeToString(&output);
-            delete redoResponsePB;
-            redoResponsePB = nullptr;
-
-            if (!ret)
-                throw RuntimeException(50017, "PB update processing failed, error serializing to string");
-            append(output);
+            appendResponse("update");
             builderCommit(false);
         }
         ++num;
@@ -230,14 +270,7 @@ namespace OpenLogReplicator {
         appendBefore(lobCtx, xmlCtx, table, offset);
 
         if ((messageFormat & MESSAGE_FORMAT_FULL) == 0) {
-            std::string output;
-            bool ret = redoResponsePB->SerializeToString(&output);
-            delete redoResponsePB;
-            redoResponsePB = nullptr;
-
-            if (!ret)
-                throw RuntimeException(50017, "PB delete processing failed, error serializing to string");
-            append(output);
+            appendResponse("delete");
             builderCommit(false);
         }
         ++num;
@@ -267,14 +300,7 @@ namespace OpenLogReplicator {
         }
 
         if ((messageFormat & MESSAGE_FORMAT_FULL) == 0) {
-            std::string output;
-            bool ret = redoResponsePB->SerializeToString(&output);
-            delete redoResponsePB;
-            redoResponsePB = nullptr;
-
-            if (!ret)
-                throw RuntimeException(50017, "PB commit processing failed, error serializing to string");
-            append(output);
+            appendResponse("ddl");
             builderCommit(true);
         }
         ++num;
@@ -284,6 +310,9 @@ namespace OpenLogReplicator {
         Builder::initialize();
 
         GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+        arenaPB = new google::protobuf::Arena;
+        redoResponseArenaPB = google::protobuf::Arena::CreateMessage<pb::RedoResponse>(arenaPB);
     }
 
     void BuilderProtobuf::processCommit(typeScn scn, typeSeq sequence, time_t timestamp) {
@@ -306,14 +335,7 @@ namespace OpenLogReplicator {
             payloadPB->set_op(pb::COMMIT);
         }
 
-        std::string output;
-        bool ret = redoResponsePB->SerializeToString(&output);
-        delete redoResponsePB;
-        redoResponsePB = nullptr;
-
-        if (!ret)
-            throw RuntimeException(50017, "PB commit processing failed, error serializing to string");
-        append(output);
+        appendResponse("commit");
         builderCommit(true);
 
         num = 0;
@@ -336,14 +358,7 @@ namespace OpenLogReplicator {
         payloadPB->set_offset(offset);
         payloadPB->set_redo(redo);
 
-        std::string output;
-        bool ret = redoResponsePB->SerializeToString(&output);
-        delete redoResponsePB;
-        redoResponsePB = nullptr;
-
-        if (!ret)
-            throw RuntimeException(50017, "PB commit processing failed, error serializing to string");
-        append(output);
+        appendResponse("checkpoint");
         builderCommit(true);
     }
 }
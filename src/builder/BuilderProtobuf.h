@@ -17,6 +17,9 @@ You should have received a copy of the GNU General Public License
 along with OpenLogReplicator; see the file LICENSE;  If not see
 <http://www.gnu.org/licenses/>.  */
 
+#include <google/protobuf/arena.h>
+#include <google/protobuf/io/zero_copy_stream.h>
+
 #include "../common/OracleTable.h"
 #include "../common/OraProtoBuf.pb.h"
 #include "../metadata/Metadata.h"
@@ -29,6 +32,24 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 namespace OpenLogReplicator {
     class BuilderProtobuf final : public Builder {
     protected:
+        static constexpr uint64_t ARENA_MAX_SIZE = Ctx::MEMORY_CHUNK_SIZE;
+
+        // Exposes the remaining space of output buffer chunks to protobuf serializer, rotating chunks as they fill up
+        class OutputStream final : public google::protobuf::io::ZeroCopyOutputStream {
+        protected:
+            BuilderProtobuf* builder;
+            int64_t byteCount;
+
+        public:
+            explicit OutputStream(BuilderProtobuf* newBuilder);
+
+            bool Next(void** data, int* size) override;
+            void BackUp(int count) override;
+            [[nodiscard]] int64_t ByteCount() const override;
+        };
+
+        google::protobuf::Arena* arenaPB;
+        pb::RedoResponse* redoResponseArenaPB;
         pb::RedoResponse* redoResponsePB;
         pb::Value* valuePB;
         pb::Payload* payloadPB;
@@ -144,7 +165,7 @@ namespace OpenLogReplicator {
 
                     case TIMESTAMP_FORMAT_ISO8601:
                         char buffer[22];
-                        str.assign(buffer, ctx->epochToIso8601(timestamp, buffer, true, true));
+                        str.assign(buffer, epochToIso8601(timestamp, buffer, true, true));
                         redoResponsePB->set_tms(str);
                         break;
                 }
@@ -217,7 +238,7 @@ namespace OpenLogReplicator {
                 pb::Column* columnPB = schemaPB->mutable_column(schemaPB->column_size() - 1);
 
                 for (typeCol column = 0; column < static_cast<typeCol>(table->columns.size()); ++column) {
-                    if (table->columns[column] == nullptr)
+                    if (table->columns[column] == nullptr || !table->isProjected(column))
                         continue;
 
                     columnPB->set_name(table->columns[column]->name);
@@ -316,7 +337,7 @@ namespace OpenLogReplicator {
         inline void appendAfter(LobCtx* lobCtx, const XmlCtx* xmlCtx, const OracleTable* table, uint64_t offset) {
             if (columnFormat > 0 && table != nullptr) {
                 for (typeCol column = 0; column < table->maxSegCol; ++column) {
-                    if (values[column][VALUE_AFTER] != nullptr) {
+                    if (values[column][VALUE_AFTER] != nullptr && table->isProjected(column)) {
                         if (lengths[column][VALUE_AFTER] > 0) {
                             payloadPB->add_after();
                             valuePB = payloadPB->mutable_after(payloadPB->after_size() - 1);
@@ -338,6 +359,8 @@ namespace OpenLogReplicator {
                             break;
                         if ((valuesSet[base] & mask) == 0)
                             continue;
+                        if (table != nullptr && !table->isProjected(column))
+                            continue;
 
                         if (values[column][VALUE_AFTER] != nullptr) {
                             if (lengths[column][VALUE_AFTER] > 0) {
@@ -359,7 +382,7 @@ namespace OpenLogReplicator {
         inline void appendBefore(LobCtx* lobCtx, const XmlCtx* xmlCtx, const OracleTable* table, uint64_t offset) {
             if (columnFormat > 0 && table != nullptr) {
                 for (typeCol column = 0; column < table->maxSegCol; ++column) {
-                    if (values[column][VALUE_BEFORE] != nullptr) {
+                    if (values[column][VALUE_BEFORE] != nullptr && table->isProjected(column)) {
                         if (lengths[column][VALUE_BEFORE] > 0) {
                             payloadPB->add_before();
                             valuePB = payloadPB->mutable_before(payloadPB->before_size() - 1);
@@ -381,6 +404,8 @@ namespace OpenLogReplicator {
                             break;
                         if ((valuesSet[base] & mask) == 0)
                             continue;
+                        if (table != nullptr && !table->isProjected(column))
+                            continue;
 
                         if (values[column][VALUE_BEFORE] != nullptr) {
                             if (lengths[column][VALUE_BEFORE] > 0) {
@@ -402,9 +427,22 @@ namespace OpenLogReplicator {
         inline void createResponse() {
             if (redoResponsePB != nullptr)
                 throw RuntimeException(50016, "PB commit processing failed, message already exists");
-            redoResponsePB = new pb::RedoResponse;
+            redoResponsePB = redoResponseArenaPB;
+        }
+
+        inline void releaseResponse() {
+            redoResponsePB->Clear();
+            redoResponsePB = nullptr;
+
+            // Large message (full transaction) - return memory to the system
+            if (arenaPB->SpaceAllocated() > ARENA_MAX_SIZE) {
+                arenaPB->Reset();
+                redoResponseArenaPB = google::protobuf::Arena::CreateMessage<pb::RedoResponse>(arenaPB);
+            }
         }
 
+        void appendResponse(const char* operation);
+
         void numToString(uint64_t value, char* buf, uint64_t length) {
             uint64_t j = (length - 1) * 4;
             for (uint64_t i = 0; i < length; ++i) {
@@ -0,0 +1,93 @@
+/* Thread formatting committed transactions for the builder pool
+   Copyright (C) 2018-2024 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <thread>
+
+#include "../common/Ctx.h"
+#include "../common/exception/DataException.h"
+#include "../common/exception/RedoLogException.h"
+#include "../common/exception/RuntimeException.h"
+#include "../parser/Transaction.h"
+#include "Builder.h"
+#include "BuilderPool.h"
+#include "BuilderWorker.h"
+
+namespace OpenLogReplicator {
+    BuilderWorker::BuilderWorker(Ctx* newCtx, const std::string& newAlias, BuilderPool* newPool, Builder* newBuilder, Metadata* newMetadata) :
+            Thread(newCtx, newAlias),
+            pool(newPool),
+            metadata(newMetadata),
+            builder(newBuilder),
+            pending(false) {
+    }
+
+    BuilderWorker::~BuilderWorker() {
+        if (builder != nullptr) {
+            delete builder;
+            builder = nullptr;
+        }
+    }
+
+    void BuilderWorker::wakeUp() {
+        pool->wakeUp();
+    }
+
+    void BuilderWorker::run() {
+        if (ctx->trace & Ctx::TRACE_THREADS) {
+            std::ostringstream ss;
+            ss << std::this_thread::get_id();
+            ctx->logTrace(Ctx::TRACE_THREADS, "builder worker (" + ss.str() + ") start");
+        }
+
+        try {
+            while (!ctx->hardShutdown) {
+                BuilderTask* task = pool->formatBegin(this);
+                if (task == nullptr)
+                    break;
+
+                // Writer could have changed the limit after the pool was created
+                builder->setMaxMessageMb(pool->getMaxMessageMb());
+                builder->setMessageTags(pool->getMessageTags());
+                // Positions in the payload are the same as assigned when the output is published
+                builder->lwnScn = task->lwnScn;
+                builder->lwnIdx = task->lwnIdx;
+                task->transaction->flush(metadata, nullptr, builder, task->lwnScn);
+                pool->formatEnd(this, task);
+            }
+        } catch (DataException& ex) {
+            ctx->error(ex.code, ex.msg);
+            ctx->stopHard();
+        } catch (RedoLogException& ex) {
+            ctx->error(ex.code, ex.msg);
+            ctx->stopHard();
+        } catch (RuntimeException& ex) {
+            ctx->error(ex.code, ex.msg);
+            ctx->stopHard();
+        } catch (std::bad_alloc& ex) {
+            ctx->error(10018, "memory allocation failed: " + std::string(ex.what()));
+            ctx->stopHard();
+        }
+
+        if (ctx->trace & Ctx::TRACE_THREADS) {
+            std::ostringstream ss;
+            ss << std::this_thread::get_id();
+            ctx->logTrace(Ctx::TRACE_THREADS, "builder worker (" + ss.str() + ") stop");
+        }
+    }
+}
@@ -2342,9 +2342,9 @@ namespace OpenLogReplicator {
         metadata->schema->dropUnusedMetadata(metadata->users, metadata->schemaElements, msgsDropped);
 
         for (const SchemaElement* element: metadata->schemaElements)
-            metadata->schema->buildMaps(element->owner, element->table, element->keys, element->keysStr, element->conditionStr, element->options, msgsUpdated,
-                                        metadata->suppLogDbPrimary, metadata->suppLogDbAll, metadata->defaultCharacterMapId,
-                                        metadata->defaultCharacterNcharMapId);
+            metadata->schema->buildMaps(element->owner, element->table, element->keys, element->keysStr, element->conditionStr, element->columnsInclude,
+                                        element->columnsExclude, element->options, msgsUpdated, metadata->suppLogDbPrimary, metadata->suppLogDbAll,
+                                        metadata->defaultCharacterMapId, metadata->defaultCharacterNcharMapId, true);
         metadata->schema->resetTouched();
 
         for (const auto& msg: msgsDropped) {
@@ -66,6 +66,7 @@ namespace OpenLogReplicator {
         static constexpr uint64_t JSON_SERVER_LENGTH = 4096;
         static constexpr uint64_t JSON_KEY_LENGTH = 4096;
         static constexpr uint64_t JSON_CONDITION_LENGTH = 16384;
+        static constexpr uint64_t JSON_COLUMNS_LENGTH = 16384;
         static constexpr uint64_t JSON_XID_LENGTH = 32;
 
         static constexpr uint64_t LOG_LEVEL_SILENT = 0;
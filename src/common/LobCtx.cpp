@@ -51,11 +51,11 @@ namespace OpenLogReplicator {
         }
 
         LobDataElement element(page, pageOffset);
-        auto dataMapIt = lobData->dataMap.find(element);
-        if (dataMapIt != lobData->dataMap.end()) {
+        uint8_t** dataPrev = lobData->dataMap.lookup(element);
+        if (dataPrev != nullptr) {
             if (ctx->trace & Ctx::TRACE_LOB)
                 ctx->logTrace(Ctx::TRACE_LOB, "id: " + lobId.lower() + " page: " + std::to_string(page) + " OVERWRITE");
-            delete[] dataMapIt->second;
+            delete[] *dataPrev;
         }
 
         lobData->dataMap.insert_or_assign(element, data);
@@ -73,11 +73,11 @@ namespace OpenLogReplicator {
 
         uint32_t pageNo = redoLogRecordLob->lobPageNo;
         if (pageNo != RedoLogRecord::INVALID_LOB_PAGE_NO) {
-            auto indexMapIt = lobData->indexMap.find(page);
-            if (indexMapIt != lobData->indexMap.end()) {
-                if (indexMapIt->second != page)
+            const typeDba* pagePrev = lobData->indexMap.lookup(page);
+            if (pagePrev != nullptr) {
+                if (*pagePrev != page)
                     throw RedoLogException(50004, "duplicate index lobid: " + lobId.upper() + ", page: " + std::to_string(page) +
-                                                  ", already set to: " + std::to_string(indexMapIt->second) + ", xid: " + xid.toString() + ", offset: " +
+                                                  ", already set to: " + std::to_string(*pagePrev) + ", xid: " + xid.toString() + ", offset: " +
                                                   std::to_string(offset));
             } else {
                 lobData->indexMap.insert_or_assign(pageNo, page);
@@ -174,11 +174,11 @@ namespace OpenLogReplicator {
             lobs.insert_or_assign(lobId, lobData);
         }
 
-        auto indexMapIt = lobData->indexMap.find(page);
-        if (indexMapIt != lobData->indexMap.end()) {
-            if (indexMapIt->second != page)
+        const typeDba* pagePrev = lobData->indexMap.lookup(page);
+        if (pagePrev != nullptr) {
+            if (*pagePrev != page)
                 throw RedoLogException(50004, "duplicate index lobid: " + lobId.upper() + ", page: " + std::to_string(page) +
-                                              ", already set to: " + std::to_string(indexMapIt->second) + ", xid: " + xid.toString() + ", offset: " +
+                                              ", already set to: " + std::to_string(*pagePrev) + ", xid: " + xid.toString() + ", offset: " +
                                               std::to_string(offset));
             return;
         }
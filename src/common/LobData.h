@@ -17,7 +17,10 @@ You should have received a copy of the GNU General Public License
 along with OpenLogReplicator; see the file LICENSE;  If not see
 <http://www.gnu.org/licenses/>.  */
 
+#include <algorithm>
 #include <map>
+#include <utility>
+#include <vector>
 
 #include "types.h"
 
@@ -37,13 +40,101 @@ namespace OpenLogReplicator {
         uint32_t offset;
     };
 
+    // Map kept as a sorted vector, pages mostly come in order and are appended at the end.
+    // Pages out of order are kept in a std::map and merged into the vector once, at the first read of the assembled LOB.
+    template<typename Key, typename Value>
+    class LobMap final {
+    protected:
+        std::vector<std::pair<Key, Value>> elements;
+        std::map<Key, Value> unordered;
+
+        static bool keyLess(const std::pair<Key, Value>& element, const Key& key) {
+            return element.first < key;
+        }
+
+        void merge() {
+            if (unordered.empty())
+                return;
+
+            std::vector<std::pair<Key, Value>> merged;
+            merged.reserve(elements.size() + unordered.size());
+            auto elementsIt = elements.begin();
+            for (const auto& unorderedIt: unordered) {
+                while (elementsIt != elements.end() && elementsIt->first < unorderedIt.first)
+                    merged.push_back(*elementsIt++);
+                merged.emplace_back(unorderedIt.first, unorderedIt.second);
+            }
+            merged.insert(merged.end(), elementsIt, elements.end());
+            elements.swap(merged);
+            unordered.clear();
+        }
+
+    public:
+        typedef typename std::vector<std::pair<Key, Value>>::iterator iterator;
+
+        iterator begin() {
+            merge();
+            return elements.begin();
+        }
+
+        iterator end() {
+            merge();
+            return elements.end();
+        }
+
+        [[nodiscard]] bool empty() const { return elements.empty() && unordered.empty(); }
+
+        [[nodiscard]] size_t size() const { return elements.size() + unordered.size(); }
+
+        void clear() {
+            elements.clear();
+            unordered.clear();
+        }
+
+        iterator lowerBound(const Key& key) {
+            merge();
+            return std::lower_bound(elements.begin(), elements.end(), key, keyLess);
+        }
+
+        iterator find(const Key& key) {
+            auto it = lowerBound(key);
+            if (it != elements.end() && !(key < it->first))
+                return it;
+            return elements.end();
+        }
+
+        // Lookup while the LOB is assembled, does not merge the pages out of order
+        Value* lookup(const Key& key) {
+            auto it = std::lower_bound(elements.begin(), elements.end(), key, keyLess);
+            if (it != elements.end() && !(key < it->first))
+                return &it->second;
+            auto unorderedIt = unordered.find(key);
+            if (unorderedIt != unordered.end())
+                return &unorderedIt->second;
+            return nullptr;
+        }
+
+        void insert_or_assign(const Key& key, Value value) {
+            if (elements.empty() || elements.back().first < key) {
+                elements.emplace_back(key, value);
+                return;
+            }
+
+            auto it = std::lower_bound(elements.begin(), elements.end(), key, keyLess);
+            if (it != elements.end() && !(key < it->first))
+                it->second = value;
+            else
+                unordered.insert_or_assign(key, value);
+        }
+    };
+
     class LobData final {
     public:
         LobData();
         virtual ~LobData();
 
-        std::map<LobDataElement, uint8_t*> dataMap;
-        std::map<uint32_t, typeDba> indexMap;
+        LobMap<LobDataElement, uint8_t*> dataMap;
+        LobMap<uint32_t, typeDba> indexMap;
 
         uint32_t pageSize;
         uint32_t sizePages;
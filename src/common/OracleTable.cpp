@@ -17,18 +17,25 @@ You should have received a copy of the GNU General Public License
 along with OpenLogReplicator; see the file LICENSE;  If not see
 <http://www.gnu.org/licenses/>.  */
 
+#include <algorithm>
+
 #include "Ctx.h"
 #include "OracleColumn.h"
 #include "OracleLob.h"
 #include "OracleTable.h"
+#include "exception/DataException.h"
 #include "exception/RuntimeException.h"
 #include "expression/BoolValue.h"
+#include "expression/Condition.h"
 #include "expression/Token.h"
 
 namespace OpenLogReplicator {
+    std::atomic<uint64_t> OracleTable::versionCounter(0);
+
     OracleTable::OracleTable(typeObj newObj, typeDataObj newDataObj, typeUser newUser, typeCol newCluCols, typeOptions newOptions, const std::string& newOwner,
                              const std::string& newName) :
             obj(newObj),
+            version(++versionCounter),
             dataObj(newDataObj),
             user(newUser),
             cluCols(newCluCols),
@@ -40,7 +47,8 @@ namespace OpenLogReplicator {
             owner(newOwner),
             name(newName),
             conditionStr(""),
-            condition(nullptr) {
+            condition(nullptr),
+            conditionCompiled(nullptr) {
 
         systemTable = 0;
         if (this->owner == "SYS") {
@@ -113,6 +121,10 @@ namespace OpenLogReplicator {
             delete token;
         tokens.clear();
 
+        if (conditionCompiled != nullptr)
+            delete conditionCompiled;
+        conditionCompiled = nullptr;
+
         if (condition != nullptr)
             delete condition;
         condition = nullptr;
@@ -147,10 +159,11 @@ namespace OpenLogReplicator {
         tablePartitions.push_back(objx);
     }
 
-    bool OracleTable::matchesCondition(const Ctx* ctx, char op, const std::unordered_map<std::string, std::string>* attributes) {
+    bool OracleTable::matchesCondition(const Ctx* ctx, char op, const std::unordered_map<std::string, std::string>* attributes, const ExpressionRow* row,
+                                       ConditionCache* cache) {
         bool result = true;
-        if (condition != nullptr)
-            result = condition->evaluateToBool(op, attributes);
+        if (conditionCompiled != nullptr)
+            result = conditionCompiled->evaluate(op, attributes, row, cache);
 
         if (ctx->trace & Ctx::TRACE_CONDITION)
             ctx->logTrace(Ctx::TRACE_CONDITION, "matchesCondition: table: " + owner + "." + name + ", condition: " + conditionStr + ", result: " +
@@ -158,13 +171,47 @@ namespace OpenLogReplicator {
         return result;
     }
 
-    void OracleTable::setConditionStr(const std::string& newConditionStr) {
+    void OracleTable::setConditionStr(const Ctx* ctx, const Locales* locales, const std::string& newConditionStr) {
         this->conditionStr = newConditionStr;
         if (newConditionStr == "")
             return;
 
         Expression::buildTokens(newConditionStr, tokens);
-        condition = Expression::buildCondition(newConditionStr, tokens, stack);
+        condition = Expression::buildCondition(ctx, locales, this, newConditionStr, tokens, stack);
+        conditionCompiled = new Condition(condition);
+    }
+
+    void OracleTable::setProjection(const Ctx* ctx, const std::vector<std::string>& columnsInclude, const std::vector<std::string>& columnsExclude,
+                                    bool afterDdl) {
+        version = ++versionCounter;
+        columnsProjected.assign((columns.size() + 63) >> 6, 0);
+
+        if (columnsInclude.empty()) {
+            for (typeCol column = 0; column < static_cast<typeCol>(columns.size()); ++column)
+                columnsProjected[column >> 6] |= static_cast<uint64_t>(1) << (column & 0x3F);
+        } else {
+            for (const std::string& columnName: columnsInclude) {
+                typeCol column = 0;
+                while (column < static_cast<typeCol>(columns.size()) && (columns[column] == nullptr || columns[column]->name != columnName))
+                    ++column;
+                if (column == static_cast<typeCol>(columns.size())) {
+                    // The column could have been dropped by DDL, the configuration is only verified when loaded
+                    if (!afterDdl)
+                        throw DataException(10071, "table " + owner + "." + name + " - couldn't find column: " + columnName + " listed in columns");
+                    ctx->warning(60039, "table " + owner + "." + name + " - couldn't find column: " + columnName + " listed in columns, ignoring");
+                    continue;
+                }
+                columnsProjected[column >> 6] |= static_cast<uint64_t>(1) << (column & 0x3F);
+            }
+        }
+
+        // Excluded column could be missing in the table, no need to check
+        for (typeCol column = 0; column < static_cast<typeCol>(columns.size()); ++column) {
+            if (columns[column] == nullptr)
+                continue;
+            if (std::find(columnsExclude.begin(), columnsExclude.end(), columns[column]->name) != columnsExclude.end())
+                columnsProjected[column >> 6] &= ~(static_cast<uint64_t>(1) << (column & 0x3F));
+        }
     }
 
     std::ostream& operator<<(std::ostream& os, const OracleTable& table) {
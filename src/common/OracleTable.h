@@ -17,6 +17,7 @@ You should have received a copy of the GNU General Public License
 along with OpenLogReplicator; see the file LICENSE;  If not see
 <http://www.gnu.org/licenses/>.  */
 
+#include <atomic>
 #include <unordered_map>
 #include <vector>
 
@@ -28,11 +29,14 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 
 namespace OpenLogReplicator {
     class BoolValue;
+    class Condition;
     class Ctx;
     class Expression;
+    class Locales;
     class OracleColumn;
     class OracleLob;
     class Token;
+    struct ConditionCache;
 
     class OracleTable final {
     public:
@@ -64,7 +68,13 @@ namespace OpenLogReplicator {
         static constexpr uint64_t XDB_XPT = 18;
         static constexpr uint64_t XDB_XQN = 19;
 
+    private:
+        static std::atomic<uint64_t> versionCounter;
+
+    public:
         typeObj obj;
+        // Unique for every table definition, changes whenever columns sent to output change
+        uint64_t version;
         typeDataObj dataObj;
         typeUser user;
         typeCol cluCols;
@@ -78,12 +88,15 @@ namespace OpenLogReplicator {
         std::string tokSuf;
         std::string conditionStr;
         BoolValue* condition;
+        Condition* conditionCompiled;
         std::vector<OracleColumn*> columns;
         std::vector<OracleLob*> lobs;
         std::vector<typeObj2> tablePartitions;
         std::vector<typeCol> pk;
         std::vector<Token*> tokens;
         std::vector<Expression*> stack;
+        // Bitmap of columns sent to output, empty when all columns are sent
+        std::vector<uint64_t> columnsProjected;
         uint64_t systemTable;
         bool sys;
 
@@ -94,8 +107,16 @@ namespace OpenLogReplicator {
         void addColumn(OracleColumn* column);
         void addLob(OracleLob* lob);
         void addTablePartition(typeObj newObj, typeDataObj newDataObj);
-        bool matchesCondition(const Ctx* ctx, char op, const std::unordered_map<std::string, std::string>* attributes);
-        void setConditionStr(const std::string& newConditionStr);
+        bool matchesCondition(const Ctx* ctx, char op, const std::unordered_map<std::string, std::string>* attributes, const ExpressionRow* row,
+                              ConditionCache* cache);
+        void setConditionStr(const Ctx* ctx, const Locales* locales, const std::string& newConditionStr);
+        void setProjection(const Ctx* ctx, const std::vector<std::string>& columnsInclude, const std::vector<std::string>& columnsExclude, bool afterDdl);
+
+        [[nodiscard]] inline bool isProjected(typeCol column) const {
+            if (columnsProjected.empty())
+                return true;
+            return (columnsProjected[column >> 6] & (static_cast<uint64_t>(1) << (column & 0x3F))) != 0;
+        }
 
         friend std::ostream& operator<<(std::ostream& os, const OracleTable& table);
     };
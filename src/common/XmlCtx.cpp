@@ -59,6 +59,35 @@ namespace OpenLogReplicator {
             ctx->error(50029, "key map XDB.X$QN" + tokSuf + " not empty, left: " + std::to_string(xdbXQnMapId.size()) + " at exit");
     }
 
+    uint64_t XmlCtx::idToCode(const std::string& id) {
+        // Binary XML refers to the tokens by the numeric value of the hex id
+        uint64_t code = 0;
+        for (char c: id) {
+            code <<= 4;
+            if (c >= '0' && c <= '9')
+                code |= c - '0';
+            else if (c >= 'A' && c <= 'F')
+                code |= c - 'A' + 10;
+            else if (c >= 'a' && c <= 'f')
+                code |= c - 'a' + 10;
+        }
+        return code;
+    }
+
+    std::string XmlCtx::codeToId(uint64_t code) {
+        std::string id;
+        int shift = 4;
+        if (code >= 0x1000000)
+            shift = 28;
+        else if (code >= 0x10000)
+            shift = 20;
+        else if (code >= 0x100)
+            shift = 12;
+        for (; shift >= 0; shift -= 4)
+            id.push_back(Ctx::map16U((code >> shift) & 0x0F));
+        return id;
+    }
+
     XdbXNm* XmlCtx::dictXdbXNmFind(typeRowId rowId) {
         auto xdbXNmMapRowIdIt = xdbXNmMapRowId.find(rowId);
         if (xdbXNmMapRowIdIt != xdbXNmMapRowId.end())
@@ -91,6 +120,9 @@ namespace OpenLogReplicator {
 
         xdbXNmMapRowId.insert_or_assign(xdbXNm->rowId, xdbXNm);
         xdbXNmMapId.insert_or_assign(xdbXNm->id, xdbXNm);
+
+        xdbXNm->code = idToCode(xdbXNm->id);
+        xdbXNmMapCode.insert_or_assign(xdbXNm->code, xdbXNm);
     }
 
     void XmlCtx::dictXdbXPtAdd(XdbXPt* xdbXPt) {
@@ -109,6 +141,11 @@ namespace OpenLogReplicator {
 
         xdbXQnMapRowId.insert_or_assign(xdbXQn->rowId, xdbXQn);
         xdbXQnMapId.insert_or_assign(xdbXQn->id, xdbXQn);
+
+        xdbXQn->code = idToCode(xdbXQn->id);
+        xdbXQn->nmSpcCode = idToCode(xdbXQn->nmSpcId);
+        xdbXQn->isAttribute = !xdbXQn->flags.empty() && (((xdbXQn->flags.back() - '0') & XdbXQn::FLAG_ISATTRIBUTE) != 0);
+        xdbXQnMapCode.insert_or_assign(xdbXQn->code, xdbXQn);
     }
 
     void XmlCtx::dictXdbXNmDrop(XdbXNm* xdbXNm) {
@@ -117,6 +154,10 @@ namespace OpenLogReplicator {
             return;
         xdbXNmMapRowId.erase(xdbXNmMapRowIdIt);
 
+        auto xdbXNmMapCodeIt = xdbXNmMapCode.find(xdbXNm->code);
+        if (xdbXNmMapCodeIt != xdbXNmMapCode.end() && xdbXNmMapCodeIt->second == xdbXNm)
+            xdbXNmMapCode.erase(xdbXNmMapCodeIt);
+
         auto xdbXNmMapIdIt = xdbXNmMapId.find(xdbXNm->id);
         if (xdbXNmMapIdIt != xdbXNmMapId.end())
             xdbXNmMapId.erase(xdbXNmMapIdIt);
@@ -143,6 +184,10 @@ namespace OpenLogReplicator {
             return;
         xdbXQnMapRowId.erase(xdbXQnMapRowIdIt);
 
+        auto xdbXQnMapCodeIt = xdbXQnMapCode.find(xdbXQn->code);
+        if (xdbXQnMapCodeIt != xdbXQnMapCode.end() && xdbXQnMapCodeIt->second == xdbXQn)
+            xdbXQnMapCode.erase(xdbXQnMapCodeIt);
+
         auto xdbXQnMapIdIt = xdbXQnMapId.find(xdbXQn->id);
         if (xdbXQnMapIdIt != xdbXQnMapId.end())
             xdbXQnMapId.erase(xdbXQnMapIdIt);
@@ -36,10 +36,12 @@ namespace OpenLogReplicator {
         // XDB.X$NMxxx
         std::map<typeRowId, XdbXNm*> xdbXNmMapRowId;
         std::unordered_map<std::string, XdbXNm*> xdbXNmMapId;
+        std::unordered_map<uint64_t, XdbXNm*> xdbXNmMapCode;
 
         // XDB.X$QNxxx
         std::map<typeRowId, XdbXQn*> xdbXQnMapRowId;
         std::unordered_map<std::string, XdbXQn*> xdbXQnMapId;
+        std::unordered_map<uint64_t, XdbXQn*> xdbXQnMapCode;
 
         // XDB.X$PTxxx
         std::map<typeRowId, XdbXPt*> xdbXPtMapRowId;
@@ -53,6 +55,22 @@ namespace OpenLogReplicator {
         virtual ~XmlCtx();
 
         void purgeDicts();
+        static uint64_t idToCode(const std::string& id);
+        static std::string codeToId(uint64_t code);
+
+        const XdbXNm* dictXdbXNmFindCode(uint64_t code) const {
+            auto xdbXNmMapCodeIt = xdbXNmMapCode.find(code);
+            if (xdbXNmMapCodeIt != xdbXNmMapCode.end())
+                return xdbXNmMapCodeIt->second;
+            return nullptr;
+        }
+
+        const XdbXQn* dictXdbXQnFindCode(uint64_t code) const {
+            auto xdbXQnMapCodeIt = xdbXQnMapCode.find(code);
+            if (xdbXQnMapCodeIt != xdbXQnMapCode.end())
+                return xdbXQnMapCodeIt->second;
+            return nullptr;
+        }
 
         XdbXNm* dictXdbXNmFind(typeRowId rowId);
         XdbXPt* dictXdbXPtFind(typeRowId rowId);
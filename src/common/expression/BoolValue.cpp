@@ -18,7 +18,6 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 <http://www.gnu.org/licenses/>.  */
 
 #include "../Ctx.h"
-#include "../exception/RuntimeException.h"
 #include "BoolValue.h"
 #include "StringValue.h"
 
@@ -41,39 +40,4 @@ namespace OpenLogReplicator {
             right = nullptr;
         }
     }
-
-    bool BoolValue::evaluateToBool(char op, const std::unordered_map<std::string, std::string>* attributes) {
-        switch (boolType) {
-            case VALUE_FALSE:
-                return false;
-
-            case VALUE_TRUE:
-                return true;
-
-            case OPERATOR_AND:
-                if (!left->evaluateToBool(op, attributes))
-                    return false;
-                return right->evaluateToBool(op, attributes);
-
-            case OPERATOR_OR:
-                if (left->evaluateToBool(op, attributes))
-                    return true;
-                return right->evaluateToBool(op, attributes);
-
-            case OPERATOR_NOT:
-                return !left->evaluateToBool(op, attributes);
-
-            case OPERATOR_EQUAL:
-                return (left->evaluateToString(op, attributes) == right->evaluateToString(op, attributes));
-
-            case OPERATOR_NOT_EQUAL:
-                return (left->evaluateToString(op, attributes) != right->evaluateToString(op, attributes));
-        }
-        throw RuntimeException(50066, "invalid expression evaluation: invalid bool type");
-    }
-
-    std::string BoolValue::evaluateToString(char op __attribute__((unused)), const std::unordered_map<std::string,
-            std::string>* attributes __attribute__((unused))) {
-        throw RuntimeException(50066, "invalid expression evaluation: bool to string");
-    }
 }
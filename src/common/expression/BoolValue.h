@@ -29,6 +29,8 @@ namespace OpenLogReplicator {
         Expression* left;
         Expression* right;
 
+        friend class Condition;
+
     public:
         static constexpr uint64_t VALUE_FALSE = 0;
         static constexpr uint64_t VALUE_TRUE = 1;
@@ -43,8 +45,6 @@ namespace OpenLogReplicator {
 
         virtual bool isBool() override { return true; }
 
-        virtual bool evaluateToBool(char op, const std::unordered_map<std::string, std::string>* attributes) override;
-        virtual std::string evaluateToString(char op, const std::unordered_map<std::string, std::string>* attributes) override;
     };
 }
 
@@ -0,0 +1,235 @@
+/* Column reference in expressions, compared using raw redo values
+   Copyright (C) 2018-2024 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include "../../locales/CharacterSet.h"
+#include "../../locales/Locales.h"
+#include "../OracleColumn.h"
+#include "../exception/RuntimeException.h"
+#include "../table/SysCol.h"
+#include "ColumnValue.h"
+#include "StringValue.h"
+
+namespace OpenLogReplicator {
+    ColumnValue::ColumnValue(typeCol newColumn, const OracleColumn* oracleColumn) :
+            Expression(),
+            column(newColumn),
+            columnType(oracleColumn->type),
+            charsetId(oracleColumn->charsetId) {
+    }
+
+    ColumnValue::~ColumnValue() {
+    }
+
+    void ColumnValue::encodeLiteral(const Ctx* ctx, const Locales* locales, const std::string& conditionStr, StringValue* literal) const {
+        if (literal->stringType != StringValue::VALUE)
+            return;
+
+        switch (columnType) {
+            case SysCol::TYPE_NUMBER:
+                literal->stringValue = encodeNumber(conditionStr, literal->stringValue);
+                return;
+
+            case SysCol::TYPE_VARCHAR:
+            case SysCol::TYPE_CHAR:
+                literal->stringValue = encodeString(ctx, locales, conditionStr, literal->stringValue);
+                return;
+
+            case SysCol::TYPE_RAW: {
+                // Literal is a hex string
+                const std::string& hex = literal->stringValue;
+                if ((hex.length() & 1) != 0)
+                    throw RuntimeException(50067, "invalid condition: " + conditionStr + " invalid hex value: " + hex);
+                std::string value;
+                for (uint64_t i = 0; i < hex.length(); i += 2) {
+                    uint64_t byte = 0;
+                    for (uint64_t j = i; j < i + 2; ++j) {
+                        byte <<= 4;
+                        if (hex[j] >= '0' && hex[j] <= '9')
+                            byte |= hex[j] - '0';
+                        else if (hex[j] >= 'a' && hex[j] <= 'f')
+                            byte |= hex[j] - 'a' + 10;
+                        else if (hex[j] >= 'A' && hex[j] <= 'F')
+                            byte |= hex[j] - 'A' + 10;
+                        else
+                            throw RuntimeException(50067, "invalid condition: " + conditionStr + " invalid hex value: " + hex);
+                    }
+                    value.push_back(static_cast<char>(byte));
+                }
+                literal->stringValue = value;
+                return;
+            }
+        }
+
+        throw RuntimeException(50067, "invalid condition: " + conditionStr + " column type: " + std::to_string(columnType) + " can't be compared");
+    }
+
+    std::string ColumnValue::encodeNumber(const std::string& conditionStr, const std::string& literal) {
+        uint64_t i = 0;
+        bool negative = false;
+        if (i < literal.length() && (literal[i] == '-' || literal[i] == '+')) {
+            negative = (literal[i] == '-');
+            ++i;
+        }
+
+        std::string integerDigits;
+        std::string fractionDigits;
+        bool dot = false;
+        bool digits = false;
+        for (; i < literal.length(); ++i) {
+            if (literal[i] >= '0' && literal[i] <= '9') {
+                if (dot)
+                    fractionDigits.push_back(literal[i]);
+                else if (!integerDigits.empty() || literal[i] != '0')
+                    integerDigits.push_back(literal[i]);
+                digits = true;
+            } else if (literal[i] == '.' && !dot)
+                dot = true;
+            else
+                throw RuntimeException(50067, "invalid condition: " + conditionStr + " invalid number: " + literal);
+        }
+        if (!digits)
+            throw RuntimeException(50067, "invalid condition: " + conditionStr + " invalid number: " + literal);
+
+        while (!fractionDigits.empty() && fractionDigits.back() == '0')
+            fractionDigits.pop_back();
+
+        // Zero
+        if (integerDigits.empty() && fractionDigits.empty())
+            return std::string(1, static_cast<char>(0x80));
+
+        // Base 100 digits are aligned to the decimal point
+        if ((integerDigits.length() & 1) != 0)
+            integerDigits.insert(0, 1, '0');
+        if ((fractionDigits.length() & 1) != 0)
+            fractionDigits.push_back('0');
+        std::string number = integerDigits + fractionDigits;
+        int64_t exponent = static_cast<int64_t>(integerDigits.length() / 2) - 1;
+
+        uint64_t start = 0;
+        while (number[start] == '0' && number[start + 1] == '0') {
+            start += 2;
+            --exponent;
+        }
+        uint64_t end = number.length();
+        while (number[end - 2] == '0' && number[end - 1] == '0')
+            end -= 2;
+
+        if ((end - start) / 2 > 20 || exponent < -64 || exponent > 62)
+            throw RuntimeException(50067, "invalid condition: " + conditionStr + " number out of range: " + literal);
+
+        std::string value;
+        if (negative)
+            value.push_back(static_cast<char>(0x3E - exponent));
+        else
+            value.push_back(static_cast<char>(0xC1 + exponent));
+        for (uint64_t j = start; j < end; j += 2) {
+            uint64_t digit = (number[j] - '0') * 10 + (number[j + 1] - '0');
+            if (negative)
+                value.push_back(static_cast<char>(101 - digit));
+            else
+                value.push_back(static_cast<char>(digit + 1));
+        }
+        if (negative && value.length() < 21)
+            value.push_back(static_cast<char>(0x66));
+        return value;
+    }
+
+    std::string ColumnValue::encodeString(const Ctx* ctx, const Locales* locales, const std::string& conditionStr, const std::string& literal) const {
+        std::string value(literal);
+        // CHAR values are compared without padding
+        if (columnType == SysCol::TYPE_CHAR) {
+            while (!value.empty() && value.back() == ' ')
+                value.pop_back();
+        }
+
+        // Condition is written in UTF-8
+        if (charsetId == 873)
+            return value;
+
+        if (charsetId == 871) {
+            for (char character: value) {
+                if ((static_cast<uint8_t>(character) & 0xF8) == 0xF0)
+                    throw RuntimeException(50067, "invalid condition: " + conditionStr + " value: " + literal +
+                                                  " can't be converted to UTF8 character set");
+            }
+            return value;
+        }
+
+        if (charsetId == 2000) {
+            std::string utf16;
+            uint64_t i = 0;
+            while (i < value.length()) {
+                auto byte1 = static_cast<uint8_t>(value[i]);
+                typeUnicode character;
+                uint64_t length;
+                if (byte1 < 0x80) {
+                    character = byte1;
+                    length = 1;
+                } else if ((byte1 & 0xE0) == 0xC0) {
+                    character = byte1 & 0x1F;
+                    length = 2;
+                } else if ((byte1 & 0xF0) == 0xE0) {
+                    character = byte1 & 0x0F;
+                    length = 3;
+                } else if ((byte1 & 0xF8) == 0xF0) {
+                    character = byte1 & 0x07;
+                    length = 4;
+                } else
+                    throw RuntimeException(50067, "invalid condition: " + conditionStr + " invalid UTF-8 value: " + literal);
+
+                if (i + length > value.length())
+                    throw RuntimeException(50067, "invalid condition: " + conditionStr + " invalid UTF-8 value: " + literal);
+                for (uint64_t j = 1; j < length; ++j)
+                    character = (character << 6) | (static_cast<uint8_t>(value[i + j]) & 0x3F);
+                i += length;
+
+                if (character >= 0x10000) {
+                    character -= 0x10000;
+                    typeUnicode high = 0xD800 | (character >> 10);
+                    typeUnicode low = 0xDC00 | (character & 0x3FF);
+                    utf16.push_back(static_cast<char>(high >> 8));
+                    utf16.push_back(static_cast<char>(high & 0xFF));
+                    utf16.push_back(static_cast<char>(low >> 8));
+                    utf16.push_back(static_cast<char>(low & 0xFF));
+                } else {
+                    utf16.push_back(static_cast<char>(character >> 8));
+                    utf16.push_back(static_cast<char>(character & 0xFF));
+                }
+            }
+            return utf16;
+        }
+
+        // Other character sets: only 7-bit characters which are decoded to themselves
+        auto characterMapIt = locales->characterMap.find(charsetId);
+        if (characterMapIt == locales->characterMap.end())
+            throw RuntimeException(50067, "invalid condition: " + conditionStr + " unsupported character set: " + std::to_string(charsetId));
+        const CharacterSet* characterSet = characterMapIt->second;
+
+        typeXid xid;
+        for (char character: value) {
+            auto byte = static_cast<uint8_t>(character);
+            const uint8_t* str = &byte;
+            uint64_t length = 1;
+            if (byte >= 0x80 || characterSet->decode(ctx, xid, str, length) != byte)
+                throw RuntimeException(50067, "invalid condition: " + conditionStr + " value: " + literal + " can't be converted to " +
+                                              characterSet->name + " character set");
+        }
+        return value;
+    }
+}
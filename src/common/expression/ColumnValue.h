@@ -0,0 +1,53 @@
+/* Header for ColumnValue class
+   Copyright (C) 2018-2024 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include "Expression.h"
+
+#ifndef COLUMN_VALUE_H_
+#define COLUMN_VALUE_H_
+
+namespace OpenLogReplicator {
+    class OracleColumn;
+    class StringValue;
+
+    class ColumnValue : public Expression {
+    protected:
+        typeCol column;
+        uint64_t columnType;
+        uint64_t charsetId;
+
+        friend class Condition;
+
+        static std::string encodeNumber(const std::string& conditionStr, const std::string& literal);
+        std::string encodeString(const Ctx* ctx, const Locales* locales, const std::string& conditionStr, const std::string& literal) const;
+
+    public:
+        ColumnValue(typeCol newColumn, const OracleColumn* oracleColumn);
+        virtual ~ColumnValue();
+
+        virtual bool isString() override { return true; }
+
+        virtual bool isColumn() override { return true; }
+
+        void encodeLiteral(const Ctx* ctx, const Locales* locales, const std::string& conditionStr, StringValue* literal) const;
+
+    };
+}
+
+#endif
@@ -0,0 +1,171 @@
+/* Condition compiled for evaluation without allocations
+   Copyright (C) 2018-2024 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include "../exception/RuntimeException.h"
+#include "../table/SysCol.h"
+#include "BoolValue.h"
+#include "ColumnValue.h"
+#include "Condition.h"
+#include "StringValue.h"
+
+namespace OpenLogReplicator {
+    std::atomic<uint64_t> Condition::nextId{1};
+
+    Condition::Condition(Expression* root) :
+            id(nextId++) {
+        compile(root);
+    }
+
+    void Condition::compile(Expression* expression) {
+        auto boolValue = dynamic_cast<BoolValue*>(expression);
+        if (boolValue == nullptr)
+            throw RuntimeException(50066, "invalid expression evaluation: string to bool");
+
+        Step step{STEP_FALSE, {OPERAND_OP, 0}, {OPERAND_OP, 0}, 0};
+        switch (boolValue->boolType) {
+            case BoolValue::VALUE_FALSE:
+                steps.push_back(step);
+                return;
+
+            case BoolValue::VALUE_TRUE:
+                step.type = STEP_TRUE;
+                steps.push_back(step);
+                return;
+
+            case BoolValue::OPERATOR_NOT:
+                compile(boolValue->left);
+                step.type = STEP_NOT;
+                steps.push_back(step);
+                return;
+
+            case BoolValue::OPERATOR_AND:
+            case BoolValue::OPERATOR_OR: {
+                // The right side is skipped when the left side decides the result
+                compile(boolValue->left);
+                step.type = (boolValue->boolType == BoolValue::OPERATOR_AND) ? STEP_JUMP_IF_FALSE : STEP_JUMP_IF_TRUE;
+                uint64_t jumpStep = steps.size();
+                steps.push_back(step);
+                compile(boolValue->right);
+                steps[jumpStep].jump = steps.size();
+                return;
+            }
+
+            case BoolValue::OPERATOR_EQUAL:
+            case BoolValue::OPERATOR_NOT_EQUAL:
+                step.type = (boolValue->boolType == BoolValue::OPERATOR_EQUAL) ? STEP_EQUAL : STEP_NOT_EQUAL;
+                step.left = compileOperand(boolValue->left);
+                step.right = compileOperand(boolValue->right);
+                steps.push_back(step);
+                return;
+        }
+
+        throw RuntimeException(50066, "invalid expression evaluation: invalid bool type");
+    }
+
+    Condition::Operand Condition::compileOperand(Expression* expression) {
+        if (expression->isColumn()) {
+            const auto columnValue = dynamic_cast<ColumnValue*>(expression);
+            if (columnValue->columnType != SysCol::TYPE_CHAR)
+                return {OPERAND_COLUMN, static_cast<uint64_t>(columnValue->column)};
+            if (columnValue->charsetId == 2000)
+                return {OPERAND_COLUMN_TRIM16, static_cast<uint64_t>(columnValue->column)};
+            return {OPERAND_COLUMN_TRIM, static_cast<uint64_t>(columnValue->column)};
+        }
+
+        const auto stringValue = dynamic_cast<StringValue*>(expression);
+        if (stringValue == nullptr)
+            throw RuntimeException(50066, "invalid expression evaluation: bool to string");
+
+        switch (stringValue->stringType) {
+            case StringValue::OP:
+                return {OPERAND_OP, 0};
+
+            case StringValue::SESSION_ATTRIBUTE:
+                // Attribute keys are interned, every key is resolved once per transaction
+                for (uint64_t i = 0; i < attributeKeys.size(); ++i) {
+                    if (attributeKeys[i] == stringValue->stringValue)
+                        return {OPERAND_ATTRIBUTE, i};
+                }
+                attributeKeys.push_back(stringValue->stringValue);
+                return {OPERAND_ATTRIBUTE, attributeKeys.size() - 1};
+
+            case StringValue::VALUE:
+                values.push_back(stringValue->stringValue);
+                return {OPERAND_VALUE, values.size() - 1};
+        }
+
+        throw RuntimeException(50066, "invalid expression evaluation: invalid string type");
+    }
+
+    bool Condition::evaluate(char op, const std::unordered_map<std::string, std::string>* attributes, const ExpressionRow* row,
+                             ConditionCache* cache) const {
+        if (cache->conditions.size() <= id)
+            cache->conditions.resize(id + 1, ConditionAttributes{0, {}});
+        ConditionAttributes& conditionAttributes = cache->conditions[id];
+        if (conditionAttributes.transaction != cache->transaction) {
+            conditionAttributes.transaction = cache->transaction;
+            conditionAttributes.values.clear();
+            for (const std::string& key: attributeKeys) {
+                auto attributesIt = attributes->find(key);
+                if (attributesIt == attributes->end())
+                    conditionAttributes.values.emplace_back();
+                else
+                    conditionAttributes.values.emplace_back(attributesIt->second);
+            }
+        }
+
+        bool result = false;
+        uint64_t i = 0;
+        while (i < steps.size()) {
+            const Step& step = steps[i++];
+            switch (step.type) {
+                case STEP_FALSE:
+                    result = false;
+                    break;
+
+                case STEP_TRUE:
+                    result = true;
+                    break;
+
+                case STEP_NOT:
+                    result = !result;
+                    break;
+
+                case STEP_JUMP_IF_FALSE:
+                    if (!result)
+                        i = step.jump;
+                    break;
+
+                case STEP_JUMP_IF_TRUE:
+                    if (result)
+                        i = step.jump;
+                    break;
+
+                case STEP_EQUAL:
+                    result = (operand(step.left, op, row, cache) == operand(step.right, op, row, cache));
+                    break;
+
+                case STEP_NOT_EQUAL:
+                    result = (operand(step.left, op, row, cache) != operand(step.right, op, row, cache));
+                    break;
+            }
+        }
+        return result;
+    }
+}
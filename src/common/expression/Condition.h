@@ -0,0 +1,131 @@
+/* Header for Condition class
+   Copyright (C) 2018-2024 Adam Leszczynski (aleszczynski@bersler.com)
+
+This file is part of OpenLogReplicator.
+
+OpenLogReplicator is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License as published
+by the Free Software Foundation; either version 3, or (at your option)
+any later version.
+
+OpenLogReplicator is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OpenLogReplicator; see the file LICENSE;  If not see
+<http://www.gnu.org/licenses/>.  */
+
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Expression.h"
+
+#ifndef CONDITION_H_
+#define CONDITION_H_
+
+namespace OpenLogReplicator {
+    struct ConditionAttributes {
+        uint64_t transaction;
+        std::vector<std::string_view> values;
+    };
+
+    // Attribute values of the current transaction, resolved once for every condition, indexed by condition id
+    struct ConditionCache {
+        uint64_t transaction;
+        std::vector<ConditionAttributes> conditions;
+    };
+
+    // Expression tree compiled to a flat list of steps with one result register
+    class Condition final {
+    protected:
+        static constexpr uint8_t STEP_FALSE = 0;
+        static constexpr uint8_t STEP_TRUE = 1;
+        static constexpr uint8_t STEP_NOT = 2;
+        static constexpr uint8_t STEP_JUMP_IF_FALSE = 3;
+        static constexpr uint8_t STEP_JUMP_IF_TRUE = 4;
+        static constexpr uint8_t STEP_EQUAL = 5;
+        static constexpr uint8_t STEP_NOT_EQUAL = 6;
+
+        static constexpr uint8_t OPERAND_OP = 0;
+        static constexpr uint8_t OPERAND_ATTRIBUTE = 1;
+        static constexpr uint8_t OPERAND_VALUE = 2;
+        static constexpr uint8_t OPERAND_COLUMN = 3;
+        static constexpr uint8_t OPERAND_COLUMN_TRIM = 4;
+        static constexpr uint8_t OPERAND_COLUMN_TRIM16 = 5;
+
+        struct Operand {
+            uint8_t type;
+            uint64_t index;
+        };
+
+        struct Step {
+            uint8_t type;
+            Operand left;
+            Operand right;
+            uint64_t jump;
+        };
+
+        static std::atomic<uint64_t> nextId;
+
+        uint64_t id;
+        std::vector<Step> steps;
+        std::vector<std::string> attributeKeys;
+        std::vector<std::string> values;
+
+        void compile(Expression* expression);
+        Operand compileOperand(Expression* expression);
+
+        [[nodiscard]] inline std::string_view operand(const Operand& operand, const char& op, const ExpressionRow* row, const ConditionCache* cache) const {
+            switch (operand.type) {
+                case OPERAND_OP:
+                    return {&op, 1};
+
+                case OPERAND_ATTRIBUTE:
+                    return cache->conditions[id].values[operand.index];
+
+                case OPERAND_VALUE:
+                    return values[operand.index];
+            }
+
+            // Missing row image is the same as null
+            if (row == nullptr)
+                return {};
+
+            // Delete is matched by the old value, insert and update by the new value
+            const uint8_t* data;
+            int64_t length;
+            if (op != 'd' && row->values[operand.index][ExpressionRow::VALUE_AFTER] != nullptr) {
+                data = row->values[operand.index][ExpressionRow::VALUE_AFTER];
+                length = row->lengths[operand.index][ExpressionRow::VALUE_AFTER];
+            } else if (row->values[operand.index][ExpressionRow::VALUE_BEFORE] != nullptr) {
+                data = row->values[operand.index][ExpressionRow::VALUE_BEFORE];
+                length = row->lengths[operand.index][ExpressionRow::VALUE_BEFORE];
+            } else
+                return {};
+            if (length <= 0)
+                return {};
+
+            if (operand.type == OPERAND_COLUMN_TRIM) {
+                while (length > 0 && data[length - 1] == ' ')
+                    --length;
+            } else if (operand.type == OPERAND_COLUMN_TRIM16) {
+                while (length >= 2 && data[length - 2] == 0 && data[length - 1] == ' ')
+                    length -= 2;
+            }
+            return {reinterpret_cast<const char*>(data), static_cast<size_t>(length)};
+        }
+
+    public:
+        explicit Condition(Expression* root);
+
+        [[nodiscard]] bool evaluate(char op, const std::unordered_map<std::string, std::string>* attributes, const ExpressionRow* row,
+                                    ConditionCache* cache) const;
+    };
+}
+
+#endif
@@ -17,8 +17,11 @@ You should have received a copy of the GNU General Public License
 along with OpenLogReplicator; see the file LICENSE;  If not see
 <http://www.gnu.org/licenses/>.  */
 
+#include "../OracleColumn.h"
+#include "../OracleTable.h"
 #include "../exception/RuntimeException.h"
 #include "BoolValue.h"
+#include "ColumnValue.h"
 #include "Expression.h"
 #include "StringValue.h"
 #include "Token.h"
@@ -51,6 +54,10 @@ namespace OpenLogReplicator {
                         expressionType = Token::TYPE_IDENTIFIER;
                         tokenIndex = ++i;
                         continue;
+                    } else if (conditionStr[i] == '{') {
+                        expressionType = Token::TYPE_COLUMN;
+                        tokenIndex = ++i;
+                        continue;
                     } else if (conditionStr[i] == '|' || conditionStr[i] == '&' || conditionStr[i] == '!' || conditionStr[i] == '=') {
                         expressionType = Token::TYPE_OPERATOR;
                         tokenIndex = i++;
@@ -78,6 +85,18 @@ namespace OpenLogReplicator {
                     ++i;
                     continue;
 
+                case Token::TYPE_COLUMN:
+                    if (conditionStr[i] != '}') {
+                        ++i;
+                        continue;
+                    }
+
+                    // ends with '}'
+                    tokens.push_back(new Token(expressionType, conditionStr.substr(tokenIndex, i - tokenIndex)));
+                    expressionType = Token::TYPE_NONE;
+                    ++i;
+                    continue;
+
                 case Token::TYPE_LEFT_PARENTHESIS:
                 case Token::TYPE_RIGHT_PARENTHESIS:
                 case Token::TYPE_COMMA:
@@ -126,14 +145,15 @@ namespace OpenLogReplicator {
         }
 
         // Reached end and the token is not finished
-        if (expressionType == Token::TYPE_STRING || expressionType == Token::TYPE_IDENTIFIER)
+        if (expressionType == Token::TYPE_STRING || expressionType == Token::TYPE_IDENTIFIER || expressionType == Token::TYPE_COLUMN)
             throw RuntimeException(50067, "invalid condition: " + conditionStr + " unfinished token: " + conditionStr.substr(tokenIndex, i - tokenIndex));
 
         if (expressionType != Token::TYPE_NONE)
             tokens.push_back(new Token(expressionType, conditionStr.substr(tokenIndex, i - tokenIndex)));
     }
 
-    BoolValue* Expression::buildCondition(const std::string& conditionStr, std::vector<Token*>& tokens, std::vector<Expression*>& stack) {
+    BoolValue* Expression::buildCondition(const Ctx* ctx, const Locales* locales, const OracleTable* table, const std::string& conditionStr,
+                                          std::vector<Token*>& tokens, std::vector<Expression*>& stack) {
         uint64_t i = 0;
         while (stack.size() > 1 || i < tokens.size()) {
             if (stack.size() >= 2) {
@@ -178,6 +198,14 @@ namespace OpenLogReplicator {
                 if (left->isString() && middle->isToken() && right->isString()) {
                     const Token* middleToken = dynamic_cast<Token*>(middle);
 
+                    // Literal compared with a column is converted to the redo format of the column
+                    if (middleToken->stringValue == "==" || middleToken->stringValue == "!=") {
+                        if (left->isColumn() && !right->isColumn())
+                            dynamic_cast<ColumnValue*>(left)->encodeLiteral(ctx, locales, conditionStr, dynamic_cast<StringValue*>(right));
+                        else if (right->isColumn() && !left->isColumn())
+                            dynamic_cast<ColumnValue*>(right)->encodeLiteral(ctx, locales, conditionStr, dynamic_cast<StringValue*>(left));
+                    }
+
                     // A == B
                     if (middleToken->stringValue == "==") {
                         stack.pop_back();
@@ -243,8 +271,26 @@ namespace OpenLogReplicator {
                         continue;
 
                     case Token::TYPE_STRING:
+                    case Token::TYPE_NUMBER:
                         stack.push_back(new StringValue(StringValue::VALUE, token->stringValue));
                         continue;
+
+                    case Token::TYPE_COLUMN: {
+                        if (table == nullptr)
+                            throw RuntimeException(50067, "invalid condition: " + conditionStr + " column: " + token->stringValue +
+                                                          " used without table");
+
+                        typeCol column = 0;
+                        while (column < static_cast<typeCol>(table->columns.size()) &&
+                               (table->columns[column] == nullptr || table->columns[column]->name != token->stringValue))
+                            ++column;
+                        if (column == static_cast<typeCol>(table->columns.size()))
+                            throw RuntimeException(50067, "invalid condition: " + conditionStr + " column: " + token->stringValue +
+                                                          " not found in table " + table->owner + "." + table->name);
+
+                        stack.push_back(new ColumnValue(column, table->columns[column]));
+                        continue;
+                    }
                 }
             }
 
@@ -27,12 +27,25 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 
 namespace OpenLogReplicator {
     class BoolValue;
+    class Ctx;
+    class Locales;
+    class OracleTable;
     class Token;
 
+    // Raw column values of the evaluated row, indexed by column and image, same as in Builder
+    struct ExpressionRow {
+        static constexpr uint64_t VALUE_BEFORE = 0;
+        static constexpr uint64_t VALUE_AFTER = 1;
+
+        uint8_t* (*values)[4];
+        int64_t (*lengths)[4];
+    };
+
     class Expression {
     public:
         static void buildTokens(const std::string& conditionStr, std::vector<Token*>& tokens);
-        static BoolValue* buildCondition(const std::string& conditionStr, std::vector<Token*>& tokens, std::vector<Expression*>& stack);
+        static BoolValue* buildCondition(const Ctx* ctx, const Locales* locales, const OracleTable* table, const std::string& conditionStr,
+                                         std::vector<Token*>& tokens, std::vector<Expression*>& stack);
 
         Expression();
         virtual ~Expression();
@@ -43,8 +56,7 @@ namespace OpenLogReplicator {
 
         virtual bool isToken() { return false; }
 
-        virtual bool evaluateToBool(char op, const std::unordered_map<std::string, std::string>* attributes) = 0;
-        virtual std::string evaluateToString(char op, const std::unordered_map<std::string, std::string>* attributes) = 0;
+        virtual bool isColumn() { return false; }
     };
 }
 
@@ -17,7 +17,6 @@ You should have received a copy of the GNU General Public License
 along with OpenLogReplicator; see the file LICENSE;  If not see
 <http://www.gnu.org/licenses/>.  */
 
-#include "../exception/RuntimeException.h"
 #include "StringValue.h"
 
 namespace OpenLogReplicator {
@@ -29,27 +28,4 @@ namespace OpenLogReplicator {
 
     StringValue::~StringValue() {
     }
-
-    bool StringValue::evaluateToBool(char op __attribute__((unused)), const std::unordered_map<std::string, std::string>* attributes __attribute__((unused))) {
-        throw RuntimeException(50066, "invalid expression evaluation: string to bool");
-    }
-
-    std::string StringValue::evaluateToString(char op, const std::unordered_map<std::string, std::string>* attributes) {
-        switch (stringType) {
-            case SESSION_ATTRIBUTE: {
-                auto attributesIt = attributes->find(stringValue);
-                if (attributesIt == attributes->end())
-                    return "";
-                return attributesIt->second;
-            }
-
-            case OP:
-                return std::string(1, op);
-
-            case VALUE:
-                return stringValue;
-        }
-
-        throw RuntimeException(50066, "invalid expression evaluation: invalid string type");
-    }
 }
@@ -38,8 +38,6 @@ namespace OpenLogReplicator {
 
         virtual bool isString() override { return true; }
 
-        virtual bool evaluateToBool(char op, const std::unordered_map<std::string, std::string>* attributes) override;
-        virtual std::string evaluateToString(char op, const std::unordered_map<std::string, std::string>* attributes) override;
     };
 }
 
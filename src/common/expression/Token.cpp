@@ -17,7 +17,6 @@ You should have received a copy of the GNU General Public License
 along with OpenLogReplicator; see the file LICENSE;  If not see
 <http://www.gnu.org/licenses/>.  */
 
-#include "../exception/RuntimeException.h"
 #include "Token.h"
 
 namespace OpenLogReplicator {
@@ -29,14 +28,4 @@ namespace OpenLogReplicator {
 
     Token::~Token() {
     }
-
-    bool Token::evaluateToBool(char op __attribute__((unused)), const std::unordered_map<std::string,
-            std::string>* attributes __attribute__((unused))) {
-        throw RuntimeException(50066, "invalid expression evaluation: token to bool");
-    }
-
-    std::string Token::evaluateToString(char op __attribute__((unused)), const std::unordered_map<std::string,
-            std::string>* attributes __attribute__((unused))) {
-        throw RuntimeException(50066, "invalid expression evaluation: token to string");
-    }
 }
@@ -37,6 +37,7 @@ namespace OpenLogReplicator {
         static constexpr uint64_t TYPE_OPERATOR = 5;
         static constexpr uint64_t TYPE_NUMBER = 6;
         static constexpr uint64_t TYPE_STRING = 7;
+        static constexpr uint64_t TYPE_COLUMN = 8;
 
         uint64_t tokenType;
         std::string stringValue;
@@ -46,8 +47,6 @@ namespace OpenLogReplicator {
 
         virtual bool isToken() override { return true; }
 
-        virtual bool evaluateToBool(char op, const std::unordered_map<std::string, std::string>* attributes) override;
-        virtual std::string evaluateToString(char op, const std::unordered_map<std::string, std::string>* attributes) override;
     };
 }
 
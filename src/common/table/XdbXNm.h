@@ -32,7 +32,8 @@ namespace OpenLogReplicator {
         XdbXNm(typeRowId newRowId, const char* newNmSpcUri, const char* newId) :
                 rowId(newRowId),
                 nmSpcUri(newNmSpcUri),
-                id(newId) {
+                id(newId),
+                code(0) {
         }
 
         bool operator!=(const XdbXNm& other) const {
@@ -42,6 +43,9 @@ namespace OpenLogReplicator {
         typeRowId rowId;
         std::string nmSpcUri;
         std::string id;
+
+        // Decoded form of the id, set when added to the XML context
+        uint64_t code;
     };
 }
 
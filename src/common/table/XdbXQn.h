@@ -37,7 +37,10 @@ namespace OpenLogReplicator {
                 nmSpcId(newNmSpcId),
                 localName(newLocalName),
                 flags(newFlags),
-                id(newId) {
+                id(newId),
+                code(0),
+                nmSpcCode(0),
+                isAttribute(false) {
         }
 
         bool operator!=(const XdbXQn& other) const {
@@ -49,6 +52,11 @@ namespace OpenLogReplicator {
         std::string localName;
         std::string flags;
         std::string id;
+
+        // Decoded form of the dictionary values, set when added to the XML context
+        uint64_t code;
+        uint64_t nmSpcCode;
+        bool isAttribute;
     };
 }
 
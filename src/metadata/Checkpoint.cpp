@@ -183,6 +183,14 @@ namespace OpenLogReplicator {
                             }
                         } else
                             element->keysStr = "";
+
+                        if (tableElementJson.HasMember("columns"))
+                            SchemaElement::parseColumns(Ctx::getJsonFieldS(configFileName, Ctx::JSON_COLUMNS_LENGTH, tableElementJson, "columns"),
+                                                        element->columnsInclude);
+
+                        if (tableElementJson.HasMember("skip-columns"))
+                            SchemaElement::parseColumns(Ctx::getJsonFieldS(configFileName, Ctx::JSON_COLUMNS_LENGTH, tableElementJson, "skip-columns"),
+                                                        element->columnsExclude);
                     }
 
                     for (auto& user: metadata->users) {
@@ -203,6 +211,7 @@ namespace OpenLogReplicator {
         // Suspend transaction processing for the schema update
         {
             std::unique_lock<std::mutex> lckTransaction(metadata->mtxTransaction);
+            std::unique_lock<std::shared_mutex> lckFormat(metadata->mtxFormat);
             metadata->commitElements();
             metadata->schema->purgeMetadata();
 
@@ -216,9 +225,9 @@ namespace OpenLogReplicator {
                     msgs.push_back("- creating table schema for owner: " + element->owner + " table: " + element->table + " options: " +
                                    std::to_string(element->options));
 
-                metadata->schema->buildMaps(element->owner, element->table, element->keys, element->keysStr, element->conditionStr, element->options, msgs,
-                                            metadata->suppLogDbPrimary, metadata->suppLogDbAll, metadata->defaultCharacterMapId,
-                                            metadata->defaultCharacterNcharMapId);
+                metadata->schema->buildMaps(element->owner, element->table, element->keys, element->keysStr, element->conditionStr, element->columnsInclude,
+                                            element->columnsExclude, element->options, msgs, metadata->suppLogDbPrimary, metadata->suppLogDbAll,
+                                            metadata->defaultCharacterMapId, metadata->defaultCharacterNcharMapId, false);
             }
             for (const auto& msg: msgs) {
                 ctx->info(0, "- found: " + msg);
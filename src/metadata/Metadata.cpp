@@ -83,6 +83,11 @@ namespace OpenLogReplicator {
             nextScn(Ctx::ZERO_SCN),
             clientScn(Ctx::ZERO_SCN),
             clientIdx(0),
+            writersRegistered(0),
+            writersStarted(0),
+            writersStartScn(Ctx::ZERO_SCN),
+            writersStartIdx(0),
+            writersWithoutCheckpoint(false),
             checkpoints(0),
             checkpointScn(Ctx::ZERO_SCN),
             lastCheckpointScn(Ctx::ZERO_SCN),
@@ -334,6 +339,49 @@ namespace OpenLogReplicator {
         condWriter.notify_all();
     }
 
+    void Metadata::registerWriter() {
+        std::unique_lock<std::mutex> lck(mtxCheckpoint);
+        ++writersRegistered;
+    }
+
+    void Metadata::writerStarted(typeScn scn, typeIdx idx) {
+        std::unique_lock<std::mutex> lck(mtxCheckpoint);
+
+        ++writersStarted;
+        if (scn == Ctx::ZERO_SCN)
+            writersWithoutCheckpoint = true;
+        else if (writersStartScn == Ctx::ZERO_SCN || scn < writersStartScn || (scn == writersStartScn && idx < writersStartIdx)) {
+            writersStartScn = scn;
+            writersStartIdx = idx;
+        }
+
+        // No checkpoint at all - the writers wait for the regular start
+        if (writersStarted < writersRegistered || writersStartScn == Ctx::ZERO_SCN)
+            return;
+
+        // Started earlier - continue from the oldest checkpoint & ignore default startup parameters
+        if (writersWithoutCheckpoint) {
+            clientScn = Ctx::ZERO_SCN;
+            clientIdx = 0;
+        } else {
+            clientScn = writersStartScn;
+            clientIdx = writersStartIdx;
+        }
+        startScn = writersStartScn;
+        startSequence = Ctx::ZERO_SEQ;
+        startTime.clear();
+        startTimeRel = 0;
+
+        status = STATUS_REPLICATE;
+        condReplicator.notify_all();
+        condWriter.notify_all();
+    }
+
+    bool Metadata::allWritersStarted() {
+        std::unique_lock<std::mutex> lck(mtxCheckpoint);
+        return writersStarted >= writersRegistered;
+    }
+
     void Metadata::wakeUp() {
         std::unique_lock<std::mutex> lck(mtxCheckpoint);
 
@@ -607,4 +655,12 @@ namespace OpenLogReplicator {
 
         return false;
     }
+
+    bool Metadata::isConfirmedLwn(typeScn scn) {
+        // Message index is restarted for every LWN, so all messages of older LWN were delivered
+        if (clientScn == Ctx::ZERO_SCN)
+            return false;
+
+        return scn < clientScn;
+    }
 }
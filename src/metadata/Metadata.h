@@ -24,6 +24,7 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 #include <rapidjson/document.h>
 #include <rapidjson/error/en.h>
 #include <set>
+#include <shared_mutex>
 #include <unordered_map>
 #include <vector>
 
@@ -100,6 +101,8 @@ namespace OpenLogReplicator {
 
         // Transaction schema consistency mutex
         std::mutex mtxTransaction;
+        // Held shared by builder workers, exclusive when the schema is rebuilt
+        std::shared_mutex mtxFormat;
 
         // Checkpoint information
         std::mutex mtxCheckpoint;
@@ -114,6 +117,12 @@ namespace OpenLogReplicator {
         typeScn nextScn;
         typeScn clientScn;
         typeIdx clientIdx;
+        // Writers sharing the output, replication starts after all of them read their checkpoints
+        uint64_t writersRegistered;
+        uint64_t writersStarted;
+        typeScn writersStartScn;
+        typeIdx writersStartIdx;
+        bool writersWithoutCheckpoint;
         uint64_t checkpoints;
         typeScn checkpointScn;
         typeScn lastCheckpointScn;
@@ -162,6 +171,9 @@ namespace OpenLogReplicator {
         void setStatusReady();
         void setStatusStart();
         void setStatusReplicate();
+        void registerWriter();
+        void writerStarted(typeScn scn, typeIdx idx);
+        [[nodiscard]] bool allWritersStarted();
         void wakeUp();
         void checkpoint(typeScn newCheckpointScn, typeTime newCheckpointTime, typeSeq newCheckpointSequence, uint64_t newCheckpointOffset,
                         uint64_t newCheckpointBytes, typeSeq newMinSequence, uint64_t newMinOffset, typeXid newMinXid);
@@ -172,6 +184,7 @@ namespace OpenLogReplicator {
         void loadAdaptiveSchema();
         void allowCheckpoints();
         bool isNewData(typeScn scn, typeIdx idx);
+        bool isConfirmedLwn(typeScn scn);
     };
 }
 
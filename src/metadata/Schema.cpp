@@ -2486,8 +2486,9 @@ namespace OpenLogReplicator {
     }
 
     void Schema::buildMaps(const std::string& owner, const std::string& table, const std::vector<std::string>& keys, const std::string& keysStr,
-                           const std::string& conditionStr, typeOptions options, std::vector<std::string>& msgs, bool suppLogDbPrimary, bool suppLogDbAll,
-                           uint64_t defaultCharacterMapId, uint64_t defaultCharacterNcharMapId) {
+                           const std::string& conditionStr, const std::vector<std::string>& columnsInclude,
+                           const std::vector<std::string>& columnsExclude, typeOptions options, std::vector<std::string>& msgs, bool suppLogDbPrimary,
+                           bool suppLogDbAll, uint64_t defaultCharacterMapId, uint64_t defaultCharacterNcharMapId, bool afterDdl) {
         std::regex regexOwner(owner);
         std::regex regexTable(table);
         char sysLobConstraintName[26] = "SYS_LOB0000000000C00000$$";
@@ -2917,7 +2918,9 @@ namespace OpenLogReplicator {
             }
             msgs.push_back(ss.str());
 
-            tableTmp->setConditionStr(conditionStr);
+            tableTmp->setConditionStr(ctx, locales, conditionStr);
+            if (!columnsInclude.empty() || !columnsExclude.empty())
+                tableTmp->setProjection(ctx, columnsInclude, columnsExclude, afterDdl);
             addTableToDict(tableTmp);
             tableTmp = nullptr;
         }
@@ -17,6 +17,9 @@ You should have received a copy of the GNU General Public License
 along with OpenLogReplicator; see the file LICENSE;  If not see
 <http://www.gnu.org/licenses/>.  */
 
+#include <algorithm>
+#include <sstream>
+
 #include "SchemaElement.h"
 
 namespace OpenLogReplicator {
@@ -25,4 +28,17 @@ namespace OpenLogReplicator {
             table(newTable),
             options(newOptions) {
     }
+
+    void SchemaElement::parseColumns(const std::string& columnsStr, std::vector<std::string>& columns) {
+        std::stringstream columnsStream(columnsStr);
+
+        while (columnsStream.good()) {
+            std::string column;
+            getline(columnsStream, column, ',');
+            column.erase(remove(column.begin(), column.end(), ' '), column.end());
+            transform(column.begin(), column.end(), column.begin(), ::toupper);
+            if (!column.empty())
+                columns.push_back(column);
+        }
+    }
 }
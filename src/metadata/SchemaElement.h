@@ -32,9 +32,13 @@ namespace OpenLogReplicator {
         std::vector<std::string> keys;
         std::string keysStr;
         std::string conditionStr;
+        std::vector<std::string> columnsInclude;
+        std::vector<std::string> columnsExclude;
         typeOptions options;
 
         SchemaElement(const char* newOwner, const char* newTable, typeOptions newOptions);
+
+        static void parseColumns(const std::string& columnsStr, std::vector<std::string>& columns);
     };
 }
 
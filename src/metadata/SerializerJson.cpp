@@ -712,9 +712,9 @@ namespace OpenLogReplicator {
                             msgs.push_back("- creating table schema for owner: " + element->owner + " table: " + element->table + " options: " +
                                            std::to_string(element->options));
 
-                        metadata->schema->buildMaps(element->owner, element->table, element->keys, element->keysStr, element->conditionStr, element->options,
-                                                    msgs, metadata->suppLogDbPrimary, metadata->suppLogDbAll, metadata->defaultCharacterMapId,
-                                                    metadata->defaultCharacterNcharMapId);
+                        metadata->schema->buildMaps(element->owner, element->table, element->keys, element->keysStr, element->conditionStr,
+                                                    element->columnsInclude, element->columnsExclude, element->options, msgs, metadata->suppLogDbPrimary,
+                                                    metadata->suppLogDbAll, metadata->defaultCharacterMapId, metadata->defaultCharacterNcharMapId, false);
                     }
 
                     metadata->schema->resetTouched();
@@ -18,6 +18,7 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 <http://www.gnu.org/licenses/>.  */
 
 #include "../builder/Builder.h"
+#include "../builder/BuilderPool.h"
 #include "../common/Clock.h"
 #include "../common/LobCtx.h"
 #include "../common/OracleLob.h"
@@ -774,6 +775,7 @@ namespace OpenLogReplicator {
             return;
 
         transaction->log(ctx, "C   ", redoLogRecord1);
+        bool pooled = false;
         transaction->commitTimestamp = lwnTimestamp;
         transaction->commitScn = redoLogRecord1->scnRecord;
         transaction->commitSequence = sequence;
@@ -784,7 +786,20 @@ namespace OpenLogReplicator {
             (transaction->commitScn > metadata->firstSchemaScn && transaction->system)) {
 
             if (transaction->begin) {
-                transaction->flush(metadata, transactionBuffer, builder, lwnScn);
+                if (!transaction->system && !transaction->shutdown && metadata->isConfirmedLwn(lwnScn)) {
+                    // Catch-up after restart: the client has already received all output of this LWN
+                    if (ctx->trace & Ctx::TRACE_TRANSACTION)
+                        ctx->logTrace(Ctx::TRACE_TRANSACTION, "skip confirmed: " + transaction->toString());
+                } else if (builder->pool != nullptr && !transaction->system && !transaction->rollback && !transaction->shutdown &&
+                        ctx->stopTransactions == 0) {
+                    // Formatted by a builder worker, the transaction is released after the output is published
+                    builder->pool->processTransaction(transaction, lwnScn);
+                    pooled = true;
+                } else {
+                    if (builder->pool != nullptr)
+                        builder->pool->drain(lwnScn);
+                    transaction->flush(metadata, transactionBuffer, builder, lwnScn);
+                }
                 if (ctx->metrics != nullptr) {
                     if (transaction->rollback)
                         ctx->metrics->emitTransactionsRollbackOut(1);
@@ -826,8 +841,11 @@ namespace OpenLogReplicator {
         }
 
         transactionBuffer->dropTransaction(redoLogRecord1->xid, redoLogRecord1->conId);
-        transaction->purge(transactionBuffer);
         lastTransaction = nullptr;
+        if (pooled)
+            return;
+
+        transaction->purge(transactionBuffer);
         delete transaction;
     }
 
@@ -1459,8 +1477,15 @@ namespace OpenLogReplicator {
                     if (lwnScn > metadata->firstDataScn) {
                         if (ctx->trace & Ctx::TRACE_CHECKPOINT)
                             ctx->logTrace(Ctx::TRACE_CHECKPOINT, "on: " + std::to_string(lwnScn));
-                        builder->processCheckpoint(lwnScn, sequence, lwnTimestamp.toEpoch(ctx->hostTimezone),
-                                                   static_cast<uint64_t>(currentBlock) * reader->getBlockSize(), switchRedo);
+                        if (builder->pool != nullptr && ctx->stopCheckpoints == 0)
+                            builder->pool->processCheckpoint(lwnScn, sequence, lwnTimestamp.toEpoch(ctx->hostTimezone),
+                                                             static_cast<uint64_t>(currentBlock) * reader->getBlockSize(), switchRedo);
+                        else {
+                            if (builder->pool != nullptr)
+                                builder->pool->drain(lwnScn);
+                            builder->processCheckpoint(lwnScn, sequence, lwnTimestamp.toEpoch(ctx->hostTimezone),
+                                                       static_cast<uint64_t>(currentBlock) * reader->getBlockSize(), switchRedo);
+                        }
 
                         typeSeq minSequence = Ctx::ZERO_SEQ;
                         uint64_t minOffset = -1;
@@ -1509,8 +1534,12 @@ namespace OpenLogReplicator {
                     switchRedo = true;
                     if (ctx->trace & Ctx::TRACE_CHECKPOINT)
                         ctx->logTrace(Ctx::TRACE_CHECKPOINT, "on: " + std::to_string(lwnScn) + " with switch");
-                    builder->processCheckpoint(lwnScn, sequence, lwnTimestamp.toEpoch(ctx->hostTimezone),
-                                               static_cast<uint64_t>(currentBlock) * reader->getBlockSize(), switchRedo);
+                    if (builder->pool != nullptr)
+                        builder->pool->processCheckpoint(lwnScn, sequence, lwnTimestamp.toEpoch(ctx->hostTimezone),
+                                                         static_cast<uint64_t>(currentBlock) * reader->getBlockSize(), switchRedo);
+                    else
+                        builder->processCheckpoint(lwnScn, sequence, lwnTimestamp.toEpoch(ctx->hostTimezone),
+                                                   static_cast<uint64_t>(currentBlock) * reader->getBlockSize(), switchRedo);
                     if (ctx->metrics)
                         ctx->metrics->emitCheckpointsOut(1);
                 } else {
@@ -1522,8 +1551,12 @@ namespace OpenLogReplicator {
             if (ctx->softShutdown) {
                 if (ctx->trace & Ctx::TRACE_CHECKPOINT)
                     ctx->logTrace(Ctx::TRACE_CHECKPOINT, "on: " + std::to_string(lwnScn) + " at exit");
-                builder->processCheckpoint(lwnScn, sequence, lwnTimestamp.toEpoch(ctx->hostTimezone),
-                                           static_cast<uint64_t>(currentBlock) * reader->getBlockSize(), false);
+                if (builder->pool != nullptr)
+                    builder->pool->processCheckpoint(lwnScn, sequence, lwnTimestamp.toEpoch(ctx->hostTimezone),
+                                                     static_cast<uint64_t>(currentBlock) * reader->getBlockSize(), false);
+                else
+                    builder->processCheckpoint(lwnScn, sequence, lwnTimestamp.toEpoch(ctx->hostTimezone),
+                                               static_cast<uint64_t>(currentBlock) * reader->getBlockSize(), false);
                 if (ctx->metrics)
                     ctx->metrics->emitCheckpointsOut(1);
 
@@ -1591,6 +1624,10 @@ namespace OpenLogReplicator {
             ctx->dumpStream->close();
         }
 
+        // All output of this redo log is published before the next one is processed
+        if (builder->pool != nullptr)
+            builder->pool->drain();
+
         freeLwn();
         return reader->getRet();
     }
@@ -197,9 +197,16 @@ namespace OpenLogReplicator {
         bool opFlush;
         deallocTc = nullptr;
         uint64_t maxMessageMb = builder->getMaxMessageMb();
-        std::unique_lock<std::mutex> lckTransaction(metadata->mtxTransaction);
+        std::unique_lock<std::mutex> lckTransaction(metadata->mtxTransaction, std::defer_lock);
+        std::shared_lock<std::shared_mutex> lckFormat(metadata->mtxFormat, std::defer_lock);
         std::unique_lock<std::mutex> lckSchema(metadata->mtxSchema, std::defer_lock);
 
+        // Builder worker: chunks are kept until the output is published, the schema is guarded against reload only
+        if (transactionBuffer != nullptr)
+            lckTransaction.lock();
+        else
+            lckFormat.lock();
+
         if (opCodes == 0 || rollback)
             return;
         if (metadata->ctx->trace & Ctx::TRACE_TRANSACTION)
@@ -358,7 +365,7 @@ namespace OpenLogReplicator {
                                                                             std::to_string(redoLogRecord2->lobPageSize));
 
                                 lobCtx.addLob(metadata->ctx, redoLogRecord2->lobId, redoLogRecord2->dba, redoLogRecord2->lobOffset,
-                                              transactionBuffer->allocateLob(redoLogRecord2), xid, redoLogRecord2->lobData);
+                                              TransactionBuffer::allocateLob(redoLogRecord2), xid, redoLogRecord2->lobData);
                                 break;
                         }
                         break;
@@ -566,10 +573,12 @@ namespace OpenLogReplicator {
             }
 
             TransactionChunk* nextTc = tc->next;
-            tc->next = deallocTc;
-            deallocTc = tc;
+            if (transactionBuffer != nullptr) {
+                tc->next = deallocTc;
+                deallocTc = tc;
+                firstTc = nextTc;
+            }
             tc = nextTc;
-            firstTc = tc;
         }
 
         while (deallocTc != nullptr) {
@@ -578,9 +587,11 @@ namespace OpenLogReplicator {
             deallocTc = nextTc;
         }
 
-        firstTc = nullptr;
-        lastTc = nullptr;
-        opCodes = 0;
+        if (transactionBuffer != nullptr) {
+            firstTc = nullptr;
+            lastTc = nullptr;
+            opCodes = 0;
+        }
 
         if (system) {
             builder->systemTransaction->commit(commitScn);
@@ -967,7 +967,7 @@ namespace OpenLogReplicator {
 
             for (const SchemaElement* element: metadata->schemaElements)
                 createSchemaForTable(metadata->firstDataScn, element->owner, element->table, element->keys, element->keysStr, element->conditionStr,
-                                     element->options, msgs);
+                                     element->columnsInclude, element->columnsExclude, element->options, msgs);
             metadata->schema->resetTouched();
 
             if (metadata->ctx->trace & Ctx::TRACE_CHECKPOINT)
@@ -1828,17 +1828,18 @@ namespace OpenLogReplicator {
     }
 
     void ReplicatorOnline::createSchemaForTable(typeScn targetScn, const std::string& owner, const std::string& table, const std::vector<std::string>& keys,
-                                                const std::string& keysStr, const std::string& conditionStr, typeOptions options,
-                                                std::vector<std::string>& msgs) {
+                                                const std::string& keysStr, const std::string& conditionStr,
+                                                const std::vector<std::string>& columnsInclude, const std::vector<std::string>& columnsExclude,
+                                                typeOptions options, std::vector<std::string>& msgs) {
         if (ctx->trace & Ctx::TRACE_REDO)
             ctx->logTrace(Ctx::TRACE_REDO, "creating table schema for owner: " + owner + " table: " + table + " options: " +
                                            std::to_string(static_cast<uint64_t>(options)));
 
         readSystemDictionaries(metadata->schema, targetScn, owner, table, options);
 
-        metadata->schema->buildMaps(owner, table, keys, keysStr, conditionStr, options, msgs, metadata->suppLogDbPrimary,
-                                    metadata->suppLogDbAll, metadata->defaultCharacterMapId,
-                                    metadata->defaultCharacterNcharMapId);
+        metadata->schema->buildMaps(owner, table, keys, keysStr, conditionStr, columnsInclude, columnsExclude, options, msgs,
+                                    metadata->suppLogDbPrimary, metadata->suppLogDbAll, metadata->defaultCharacterMapId,
+                                    metadata->defaultCharacterNcharMapId, false);
     }
 
     void ReplicatorOnline::updateOnlineRedoLogData() {
@@ -17,6 +17,9 @@ You should have received a copy of the GNU General Public License
 along with OpenLogReplicator; see the file LICENSE;  If not see
 <http://www.gnu.org/licenses/>.  */
 
+#include <cstring>
+#include <vector>
+
 #include "../common/Ctx.h"
 #include "Stream.h"
 
@@ -27,4 +30,24 @@ namespace OpenLogReplicator {
     }
 
     Stream::~Stream() = default;
+
+    void Stream::sendMessageParts(const struct iovec* parts, uint64_t count, uint64_t length) {
+        // Transports without gather support get the message in one buffer
+        std::vector<uint8_t> msg(length);
+        uint64_t copied = 0;
+        for (uint64_t i = 0; i < count; ++i) {
+            memcpy(reinterpret_cast<void*>(msg.data() + copied), parts[i].iov_base, parts[i].iov_len);
+            copied += parts[i].iov_len;
+        }
+        sendMessage(msg.data(), length);
+    }
+
+    int Stream::getWakeUpFD() const {
+        return -1;
+    }
+
+    bool Stream::waitForEvents(uint64_t timeUs __attribute__((unused))) {
+        // No event notification, the caller sleeps instead
+        return false;
+    }
 }
@@ -17,6 +17,8 @@ You should have received a copy of the GNU General Public License
 along with OpenLogReplicator; see the file LICENSE;  If not see
 <http://www.gnu.org/licenses/>.  */
 
+#include <sys/uio.h>
+
 #include "../common/types.h"
 
 #ifndef STREAM_H_
@@ -40,9 +42,12 @@ namespace OpenLogReplicator {
         virtual void initializeClient() = 0;
         virtual void initializeServer() = 0;
         virtual void sendMessage(const void* msg, uint64_t length) = 0;
+        virtual void sendMessageParts(const struct iovec* parts, uint64_t count, uint64_t length);
         virtual uint64_t receiveMessage(void* msg, uint64_t length) = 0;
         virtual uint64_t receiveMessageNB(void* msg, uint64_t length) = 0;
         [[nodiscard]] virtual bool isConnected() = 0;
+        [[nodiscard]] virtual int getWakeUpFD() const;
+        virtual bool waitForEvents(uint64_t timeUs);
         virtual void initialize() = 0;
     };
 }
@@ -17,11 +17,17 @@ You should have received a copy of the GNU General Public License
 along with OpenLogReplicator; see the file LICENSE;  If not see
 <http://www.gnu.org/licenses/>.  */
 
+#include <algorithm>
 #include <cerrno>
+#include <climits>
 #include <cstring>
 #include <fcntl.h>
 #include <netdb.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
 #include <unistd.h>
+#include <vector>
 
 #include "../common/Ctx.h"
 #include "../common/exception/ConfigurationException.h"
@@ -34,8 +40,14 @@ namespace OpenLogReplicator {
             Stream(newCtx, newUri),
             socketFD(-1),
             serverFD(-1),
+            epollFD(-1),
+            wakeUpFD(-1),
             readBufferLen(0),
-            res(nullptr) {
+            res(nullptr),
+            sendQueuePos(0),
+            sendWaiting(false),
+            sendBlocked(false),
+            readPaused(false) {
         readBuffer[0] = 0;
     }
 
@@ -54,6 +66,16 @@ namespace OpenLogReplicator {
             close(serverFD);
             serverFD = -1;
         }
+
+        if (wakeUpFD != -1) {
+            close(wakeUpFD);
+            wakeUpFD = -1;
+        }
+
+        if (epollFD != -1) {
+            close(epollFD);
+            epollFD = -1;
+        }
     }
 
     void StreamNetwork::initialize() {
@@ -121,112 +143,181 @@ namespace OpenLogReplicator {
 
         freeaddrinfo(res);
         res = nullptr;
+
+        // Level triggered events: readable socket, new connection, new output of the builder
+        epollFD = epoll_create1(EPOLL_CLOEXEC);
+        if (epollFD < 0)
+            throw RuntimeException(10061, "network error, errno: " + std::to_string(errno) + ", message: " + strerror(errno) + " (21)");
+        wakeUpFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wakeUpFD < 0)
+            throw RuntimeException(10061, "network error, errno: " + std::to_string(errno) + ", message: " + strerror(errno) + " (22)");
+
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = wakeUpFD;
+        if (epoll_ctl(epollFD, EPOLL_CTL_ADD, wakeUpFD, &event) != 0)
+            throw RuntimeException(10061, "network error, errno: " + std::to_string(errno) + ", message: " + strerror(errno) + " (23)");
+        event.data.fd = serverFD;
+        if (epoll_ctl(epollFD, EPOLL_CTL_ADD, serverFD, &event) != 0)
+            throw RuntimeException(10061, "network error, errno: " + std::to_string(errno) + ", message: " + strerror(errno) + " (24)");
+    }
+
+    void StreamNetwork::closeSocket() {
+        if (socketFD != -1) {
+            close(socketFD);
+            socketFD = -1;
+
+            // Accept the next client
+            if (epollFD != -1) {
+                struct epoll_event event = {};
+                event.events = EPOLLIN;
+                event.data.fd = serverFD;
+                epoll_ctl(epollFD, EPOLL_CTL_ADD, serverFD, &event);
+            }
+        }
+
+        readBufferLen = 0;
+        sendQueue.clear();
+        sendQueuePos = 0;
+        sendWaiting = false;
+        sendBlocked = false;
+        readPaused = false;
+    }
+
+    void StreamNetwork::updateEvents() {
+        // Writable socket is awaited only when some frames are queued
+        bool waiting = sendQueuePos < sendQueue.size();
+        if ((waiting == sendWaiting && sendBlocked == readPaused) || socketFD == -1 || epollFD == -1)
+            return;
+
+        struct epoll_event event = {};
+        if (!sendBlocked)
+            event.events = EPOLLIN;
+        if (waiting)
+            event.events |= EPOLLOUT;
+        event.data.fd = socketFD;
+        if (epoll_ctl(epollFD, EPOLL_CTL_MOD, socketFD, &event) != 0)
+            throw NetworkException(10061, "network error, errno: " + std::to_string(errno) + ", message: " + strerror(errno) + " (25)");
+        sendWaiting = waiting;
+        readPaused = sendBlocked;
     }
 
     void StreamNetwork::sendMessage(const void* msg, uint64_t length) {
-        uint32_t length32 = length;
-        uint64_t sent = 0;
+        struct iovec part = {const_cast<void*>(msg), length};
+        sendMessageParts(&part, 1, length);
+    }
 
+    void StreamNetwork::sendMessageParts(const struct iovec* parts, uint64_t count, uint64_t length) {
         if (socketFD == -1)
             throw NetworkException(10061, "network error, errno: " + std::to_string(errno) + ", message: " + strerror(errno) + " (10)");
 
-        fd_set wset;
-        fd_set w;
-        FD_ZERO(&wset);
-        FD_SET(socketFD, &wset);
-
-        // Header content
+        // Header content: 32-bit length, or 0xFFFFFFFF followed by 64-bit length
+        uint8_t header[sizeof(uint32_t) + sizeof(uint64_t)];
+        uint64_t headerLength = sizeof(uint32_t);
         if (length < 0xFFFFFFFF) {
-            // 32-bit length
-            while (sent < sizeof(uint32_t)) {
-                if (ctx->softShutdown)
-                    return;
-
-                w = wset;
-                // Blocking select
-                select(socketFD + 1, nullptr, &w, nullptr, nullptr);
-                ssize_t r = write(socketFD, (reinterpret_cast<uint8_t*>(&length32)) + sent, sizeof(uint32_t) - sent);
-                if (r <= 0) {
-                    if (r < 0 && (errno == EWOULDBLOCK || errno == EAGAIN))
-                        r = 0;
-                    else {
-                        close(socketFD);
-                        socketFD = -1;
-                        throw NetworkException(10061, "network error, errno: " + std::to_string(errno) + ", message: " +
-                                                      strerror(errno) + " (11)");
-                    }
-                }
-                sent += r;
-            }
+            uint32_t length32 = length;
+            memcpy(reinterpret_cast<void*>(header), reinterpret_cast<const void*>(&length32), sizeof(uint32_t));
         } else {
-            // 64-bit length
-            length32 = 0xFFFFFFFF;
-            while (sent < sizeof(uint32_t)) {
-                if (ctx->softShutdown)
-                    return;
+            uint32_t length32 = 0xFFFFFFFF;
+            memcpy(reinterpret_cast<void*>(header), reinterpret_cast<const void*>(&length32), sizeof(uint32_t));
+            memcpy(reinterpret_cast<void*>(header + sizeof(uint32_t)), reinterpret_cast<const void*>(&length), sizeof(uint64_t));
+            headerLength += sizeof(uint64_t);
+        }
 
-                w = wset;
-                // Blocking select
-                select(socketFD + 1, nullptr, &w, nullptr, nullptr);
-                ssize_t r = write(socketFD, (reinterpret_cast<uint8_t*>(&length32)) + sent, sizeof(uint32_t) - sent);
-                if (r <= 0) {
-                    if (r < 0 && (errno == EWOULDBLOCK || errno == EAGAIN))
-                        r = 0;
-                    else {
-                        close(socketFD);
-                        socketFD = -1;
-                        throw NetworkException(10061, "network error, errno: " + std::to_string(errno) + ", message: " +
-                                                      strerror(errno) + " (12)");
-                    }
+        // Header and message content are sent together, a message in many parts directly from the parts
+        std::vector<struct iovec> iov;
+        iov.reserve(count + 1);
+        iov.push_back({header, headerLength});
+        for (uint64_t i = 0; i < count; ++i)
+            if (parts[i].iov_len > 0)
+                iov.push_back(parts[i]);
+
+        // Frames are sent in order, directly to the socket only when nothing is queued before
+        uint64_t first = 0;
+        if (sendQueuePos < sendQueue.size())
+            flushSendQueue();
+        if (sendQueuePos == sendQueue.size()) {
+            sendParts(iov, first);
+            if (first == iov.size())
+                return;
+        }
+
+        // The client does not keep up, wait until the queued data is sent, unread requests would wake up the wait at once
+        if (sendQueue.size() - sendQueuePos > SEND_QUEUE_MAX_BYTES && epollFD != -1) {
+            sendBlocked = true;
+            updateEvents();
+            while (sendQueue.size() - sendQueuePos > SEND_QUEUE_MAX_BYTES) {
+                if (ctx->softShutdown) {
+                    sendBlocked = false;
+                    updateEvents();
+                    return;
                 }
-                sent += r;
+                waitForEvents(ctx->pollIntervalUs);
+                if (socketFD == -1)
+                    throw NetworkException(10061, "network error, errno: " + std::to_string(errno) + ", message: " + strerror(errno) + " (10)");
             }
+            sendBlocked = false;
+        }
 
-            sent = 0;
-            while (sent < sizeof(uint64_t)) {
-                if (ctx->softShutdown)
+        // The rest of the frame is copied, the socket accepts it later
+        for (; first < iov.size(); ++first) {
+            const auto* data = reinterpret_cast<const uint8_t*>(iov[first].iov_base);
+            sendQueue.insert(sendQueue.end(), data, data + iov[first].iov_len);
+        }
+        updateEvents();
+    }
+
+    void StreamNetwork::sendParts(std::vector<struct iovec>& iov, uint64_t& first) {
+        while (first < iov.size()) {
+            struct msghdr msgHeader = {};
+            msgHeader.msg_iov = iov.data() + first;
+            msgHeader.msg_iovlen = std::min(iov.size() - first, static_cast<uint64_t>(IOV_MAX));
+            ssize_t r = sendmsg(socketFD, &msgHeader, 0);
+            if (r <= 0) {
+                if (r < 0 && (errno == EWOULDBLOCK || errno == EAGAIN))
                     return;
+                if (r < 0 && errno == EINTR)
+                    continue;
+                closeSocket();
+                throw NetworkException(10061, "network error, errno: " + std::to_string(errno) + ", message: " + strerror(errno) + " (14)");
+            }
 
-                w = wset;
-                // Blocking select
-                select(socketFD + 1, nullptr, &w, nullptr, nullptr);
-                ssize_t r = write(socketFD, (reinterpret_cast<uint8_t*>(&length)) + sent, sizeof(uint64_t) - sent);
-                if (r <= 0) {
-                    if (r < 0 && (errno == EWOULDBLOCK || errno == EAGAIN))
-                        r = 0;
-                    else {
-                        close(socketFD);
-                        socketFD = -1;
-                        throw NetworkException(10061, "network error, errno: " + std::to_string(errno) + ", message: " +
-                                                      strerror(errno) + " (13)");
-                    }
-                }
-                sent += r;
+            // Skip what has been sent
+            auto sent = static_cast<uint64_t>(r);
+            while (first < iov.size() && sent >= iov[first].iov_len) {
+                sent -= iov[first].iov_len;
+                ++first;
+            }
+            if (sent > 0) {
+                iov[first].iov_base = reinterpret_cast<uint8_t*>(iov[first].iov_base) + sent;
+                iov[first].iov_len -= sent;
             }
         }
+    }
 
-        sent = 0;
-        // Message content
-        while (sent < length) {
-            if (ctx->softShutdown)
-                return;
-
-            w = wset;
-            // Blocking select
-            select(socketFD + 1, nullptr, &w, nullptr, nullptr);
-            ssize_t r = write(socketFD, reinterpret_cast<const char*>(msg) + sent, length - sent);
+    void StreamNetwork::flushSendQueue() {
+        while (sendQueuePos < sendQueue.size()) {
+            ssize_t r = send(socketFD, sendQueue.data() + sendQueuePos, sendQueue.size() - sendQueuePos, 0);
             if (r <= 0) {
                 if (r < 0 && (errno == EWOULDBLOCK || errno == EAGAIN))
-                    r = 0;
-                else {
-                    close(socketFD);
-                    socketFD = -1;
-                    throw NetworkException(10061, "network error, errno: " + std::to_string(errno) + ", message: " +
-                                                  strerror(errno) + " (14)");
-                }
+                    break;
+                if (r < 0 && errno == EINTR)
+                    continue;
+                closeSocket();
+                throw NetworkException(10061, "network error, errno: " + std::to_string(errno) + ", message: " + strerror(errno) + " (26)");
             }
-            sent += r;
+            sendQueuePos += r;
+        }
+
+        // Sent data is dropped from the queue when it is the bigger part
+        if (sendQueuePos == sendQueue.size()) {
+            sendQueue.clear();
+            sendQueuePos = 0;
+        } else if (sendQueuePos > sendQueue.size() / 2) {
+            sendQueue.erase(sendQueue.begin(), sendQueue.begin() + static_cast<int64_t>(sendQueuePos));
+            sendQueuePos = 0;
         }
+        updateEvents();
     }
 
     uint64_t StreamNetwork::receiveMessage(void* msg, uint64_t length) {
@@ -242,12 +333,10 @@ namespace OpenLogReplicator {
             if (bytes > 0)
                 recvd += bytes;
             else if (bytes == 0) {
-                close(socketFD);
-                socketFD = -1;
+                closeSocket();
                 throw NetworkException(10056, "host disconnected");
             } else {
-                close(socketFD);
-                socketFD = -1;
+                closeSocket();
                 throw NetworkException(10061, "network error, errno: " + std::to_string(errno) + ", message: " + strerror(errno) + " (15)");
             }
         }
@@ -273,12 +362,10 @@ namespace OpenLogReplicator {
                 if (bytes > 0)
                     recvd += bytes;
                 else if (bytes == 0) {
-                    close(socketFD);
-                    socketFD = -1;
+                    closeSocket();
                     throw NetworkException(10056, "host disconnected");
                 } else {
-                    close(socketFD);
-                    socketFD = -1;
+                    closeSocket();
                     throw NetworkException(10061, "network error, errno: " + std::to_string(errno) + ", message: " +
                                                   strerror(errno) + " (16)");
                 }
@@ -301,12 +388,10 @@ namespace OpenLogReplicator {
             if (bytes > 0)
                 recvd += bytes;
             else if (bytes == 0) {
-                close(socketFD);
-                socketFD = -1;
+                closeSocket();
                 throw NetworkException(10056, "host disconnected");
             } else {
-                close(socketFD);
-                socketFD = -1;
+                closeSocket();
                 throw NetworkException(10061, "network error, errno: " + std::to_string(errno) + ", message: " + strerror(errno) + " (17)");
             }
         }
@@ -314,97 +399,59 @@ namespace OpenLogReplicator {
         return recvd;
     }
 
-    uint64_t StreamNetwork::receiveMessageNB(void* msg, uint64_t length) {
-        uint64_t recvd = 0;
-
-        // Read message length
-        while (recvd < sizeof(uint32_t)) {
-            if (ctx->softShutdown)
-                return 0;
-
-            int64_t bytes = read(socketFD, reinterpret_cast<char*>(msg) + recvd, sizeof(uint32_t) - recvd);
+    uint64_t StreamNetwork::receivedHeader(uint64_t& messageLength) const {
+        // Header content: 32-bit length, or 0xFFFFFFFF followed by 64-bit length
+        if (readBufferLen < sizeof(uint32_t))
+            return 0;
 
-            if (bytes > 0)
-                recvd += bytes;
-            else if (bytes == 0) {
-                // Client disconnected
-                close(socketFD);
-                socketFD = -1;
-                throw NetworkException(10056, "host disconnected");
-            } else {
-                if (recvd == 0)
-                    return 0;
-
-                if (errno == EWOULDBLOCK || errno == EAGAIN)
-                    usleep(ctx->pollIntervalUs);
-                else
-                    return 0;
-            }
+        uint32_t length32;
+        memcpy(reinterpret_cast<void*>(&length32), reinterpret_cast<const void*>(readBuffer), sizeof(uint32_t));
+        if (length32 < 0xFFFFFFFF) {
+            messageLength = length32;
+            return sizeof(uint32_t);
         }
 
-        if (*(reinterpret_cast<uint32_t*>(msg)) < 0xFFFFFFFF) {
-            // 32-bit message length
-            uint32_t newLength = *(reinterpret_cast<uint32_t*>(msg));
-            if (length < newLength)
-                throw NetworkException(10055, "message from client exceeds buffer size (length: " + std::to_string(newLength) +
-                                              ", buffer size: " + std::to_string(length) + ")");
-            length = newLength;
-            recvd = 0;
-        } else {
-            // 64-bit message length
-            recvd = 0;
-
-            while (recvd < sizeof(uint64_t)) {
-                if (ctx->softShutdown)
-                    return 0;
-
-                int64_t bytes = read(socketFD, reinterpret_cast<char*>(msg) + recvd, sizeof(uint64_t) - recvd);
-
-                if (bytes > 0)
-                    recvd += bytes;
-                else if (bytes == 0) {
-                    // Client disconnected
-                    close(socketFD);
-                    socketFD = -1;
-                    throw NetworkException(10056, "host disconnected");
-                } else {
-                    if (recvd == 0)
-                        return 0;
+        if (readBufferLen < sizeof(uint32_t) + sizeof(uint64_t))
+            return 0;
+        memcpy(reinterpret_cast<void*>(&messageLength), reinterpret_cast<const void*>(readBuffer + sizeof(uint32_t)), sizeof(uint64_t));
+        return sizeof(uint32_t) + sizeof(uint64_t);
+    }
 
-                    if (errno == EWOULDBLOCK || errno == EAGAIN)
-                        usleep(ctx->pollIntervalUs);
-                    else
-                        return 0;
+    uint64_t StreamNetwork::receiveMessageNB(void* msg, uint64_t length) {
+        // Data is read as it comes, a request is returned when it is complete
+        for (;;) {
+            uint64_t messageLength = 0;
+            uint64_t headerLength = receivedHeader(messageLength);
+            if (headerLength > 0) {
+                if (length < messageLength || messageLength > READ_NETWORK_BUFFER)
+                    throw NetworkException(10055, "message from client exceeds buffer size (length: " + std::to_string(messageLength) +
+                                                  ", buffer size: " + std::to_string(length) + ")");
+
+                if (readBufferLen >= headerLength + messageLength) {
+                    memcpy(msg, reinterpret_cast<const void*>(readBuffer + headerLength), messageLength);
+                    readBufferLen -= headerLength + messageLength;
+                    memmove(reinterpret_cast<void*>(readBuffer), reinterpret_cast<const void*>(readBuffer + headerLength + messageLength),
+                            readBufferLen);
+                    if (messageLength > 0)
+                        return messageLength;
+                    continue;
                 }
             }
 
-            uint32_t newLength = *(reinterpret_cast<uint32_t*>(msg));
-            if (length < newLength)
-                throw NetworkException(10055, "message from client exceeds buffer size (length: " + std::to_string(newLength) +
-                                              ", buffer size: " + std::to_string(length) + ")");
-            length = newLength;
-            recvd = 0;
-        }
-
-        while (recvd < length) {
-            int64_t bytes = read(socketFD, reinterpret_cast<char*>(msg) + recvd, length - recvd);
-
+            int64_t bytes = read(socketFD, reinterpret_cast<void*>(readBuffer + readBufferLen), sizeof(readBuffer) - readBufferLen);
             if (bytes > 0)
-                recvd += bytes;
+                readBufferLen += bytes;
             else if (bytes == 0) {
                 // Client disconnected
-                close(socketFD);
-                socketFD = -1;
+                closeSocket();
                 throw NetworkException(10056, "host disconnected");
             } else {
-                if (errno == EWOULDBLOCK || errno == EAGAIN)
-                    usleep(ctx->pollIntervalUs);
-                else
-                    return 0;
+                if (errno == EINTR)
+                    continue;
+                // Nothing more to read now, errno is checked by the caller
+                return 0;
             }
         }
-
-        return recvd;
     }
 
     bool StreamNetwork::isConnected() {
@@ -426,9 +473,53 @@ namespace OpenLogReplicator {
         if (fcntl(socketFD, F_SETFL, flags | O_NONBLOCK) < 0)
             throw NetworkException(10061, "network error, errno: " + std::to_string(errno) + ", message: " + strerror(errno) + " (20)");
 
+        // Only one client is served, the listening socket is awaited again after it disconnects
+        if (epollFD != -1) {
+            struct epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.fd = socketFD;
+            if (epoll_ctl(epollFD, EPOLL_CTL_ADD, socketFD, &event) != 0)
+                throw NetworkException(10061, "network error, errno: " + std::to_string(errno) + ", message: " + strerror(errno) + " (27)");
+            epoll_ctl(epollFD, EPOLL_CTL_DEL, serverFD, nullptr);
+        }
+        readBufferLen = 0;
+
         if (socketFD != -1)
             return true;
 
         return false;
     }
+
+    int StreamNetwork::getWakeUpFD() const {
+        return wakeUpFD;
+    }
+
+    bool StreamNetwork::waitForEvents(uint64_t timeUs) {
+        if (epollFD == -1)
+            return false;
+
+        // A request is already received
+        uint64_t messageLength = 0;
+        uint64_t headerLength = receivedHeader(messageLength);
+        if (!sendBlocked && headerLength > 0 && readBufferLen >= headerLength + messageLength)
+            return true;
+
+        struct epoll_event events[EVENTS_MAX];
+        int count = epoll_wait(epollFD, events, EVENTS_MAX, static_cast<int>((timeUs + 999) / 1000));
+        if (count < 0) {
+            if (errno == EINTR)
+                return true;
+            throw NetworkException(10061, "network error, errno: " + std::to_string(errno) + ", message: " + strerror(errno) + " (28)");
+        }
+
+        for (int i = 0; i < count; ++i) {
+            if (events[i].data.fd == wakeUpFD) {
+                eventfd_t value;
+                eventfd_read(wakeUpFD, &value);
+            } else if (events[i].data.fd == socketFD && sendWaiting && (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) != 0)
+                flushSendQueue();
+            // Requests and new connections are handled by the writer after return
+        }
+        return true;
+    }
 }
@@ -18,6 +18,7 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 <http://www.gnu.org/licenses/>.  */
 
 #include <netinet/in.h>
+#include <vector>
 
 #include "Stream.h"
 
@@ -27,14 +28,33 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 namespace OpenLogReplicator {
     class StreamNetwork final : public Stream {
     protected:
+        static constexpr uint64_t SEND_QUEUE_MAX_BYTES = 16 * 1024 * 1024;
+        static constexpr int EVENTS_MAX = 8;
+
         int socketFD;
         int serverFD;
+        // Server side waits for the socket, new connections and the output of the builder with one call
+        int epollFD;
+        int wakeUpFD;
         struct sockaddr_storage address;
         std::string host;
         std::string port;
-        uint8_t readBuffer[READ_NETWORK_BUFFER];
+        uint8_t readBuffer[READ_NETWORK_BUFFER + sizeof(uint32_t) + sizeof(uint64_t)];
         uint64_t readBufferLen;
         struct addrinfo* res;
+        // Frames not accepted by the socket yet, sent when it becomes writable
+        std::vector<uint8_t> sendQueue;
+        uint64_t sendQueuePos;
+        bool sendWaiting;
+        // Requests are not read while the queue is full, only the writable socket is awaited
+        bool sendBlocked;
+        bool readPaused;
+
+        void closeSocket();
+        void updateEvents();
+        void sendParts(std::vector<struct iovec>& iov, uint64_t& first);
+        void flushSendQueue();
+        [[nodiscard]] uint64_t receivedHeader(uint64_t& messageLength) const;
 
     public:
         StreamNetwork(Ctx* newCtx, const char* newUri);
@@ -45,9 +65,12 @@ namespace OpenLogReplicator {
         void initializeClient() override;
         void initializeServer() override;
         void sendMessage(const void* msg, uint64_t length) override;
+        void sendMessageParts(const struct iovec* parts, uint64_t count, uint64_t length) override;
         uint64_t receiveMessage(void* msg, uint64_t length) override;
         uint64_t receiveMessageNB(void* msg, uint64_t length) override;
         [[nodiscard]] bool isConnected() override;
+        [[nodiscard]] int getWakeUpFD() const override;
+        bool waitForEvents(uint64_t timeUs) override;
     };
 }
 
@@ -33,8 +33,10 @@ namespace OpenLogReplicator {
     Writer::Writer(Ctx* newCtx, const std::string& newAlias, const std::string& newDatabase, Builder* newBuilder, Metadata* newMetadata) :
             Thread(newCtx, newAlias),
             database(newDatabase),
+            checkpointName(newDatabase + "-chkpt"),
             builder(newBuilder),
             metadata(newMetadata),
+            builderWriter(0),
             builderQueue(nullptr),
             checkpointScn(Ctx::ZERO_SCN),
             checkpointIdx(0),
@@ -44,9 +46,17 @@ namespace OpenLogReplicator {
             currentQueueSize(0),
             maxQueueSize(0),
             streaming(false),
+            clientScn(Ctx::ZERO_SCN),
+            clientIdx(0),
+            copyMessages(false),
+            msgPayloadParts(0),
             confirmedScn(Ctx::ZERO_SCN),
             confirmedIdx(0),
-            queue(nullptr) {
+            queue(nullptr),
+            queueConfirmed(nullptr),
+            queueMask(0),
+            queueFirstId(0) {
+        metadata->registerWriter();
     }
 
     Writer::~Writer() {
@@ -54,61 +64,127 @@ namespace OpenLogReplicator {
             delete[] queue;
             queue = nullptr;
         }
+
+        if (queueConfirmed != nullptr) {
+            delete[] queueConfirmed;
+            queueConfirmed = nullptr;
+        }
+
+        for (BuilderMsg* msg: msgCopies)
+            delete msg;
+        msgCopies.clear();
     }
 
     void Writer::initialize() {
         if (queue != nullptr)
             return;
-        queue = new BuilderMsg* [ctx->queueSize];
+
+        // Message ids are consecutive, so the slot of a message is its id modulo the ring size
+        uint64_t ringSize = 64;
+        while (ringSize < ctx->queueSize)
+            ringSize <<= 1;
+        queueMask = ringSize - 1;
+        queue = new BuilderMsg* [ringSize];
+        queueConfirmed = new uint64_t[ringSize / 64];
+        memset(reinterpret_cast<void*>(queueConfirmed), 0, ringSize / 8);
+        builderWriter = builder->registerWriter();
+    }
+
+    void Writer::setCheckpointName(const std::string& newCheckpointName) {
+        checkpointNamePrevious = checkpointName;
+        checkpointName = newCheckpointName;
     }
 
     void Writer::createMessage(BuilderMsg* msg) {
         ++sentMessages;
 
-        queue[currentQueueSize++] = msg;
+        if (currentQueueSize == 0)
+            queueFirstId = msg->id;
+        else if (msg->id != queueFirstId + currentQueueSize)
+            throw RuntimeException(50072, "output queue - message id: " + std::to_string(msg->id) + ", expected: " +
+                                          std::to_string(queueFirstId + currentQueueSize));
+
+        queue[msg->id & queueMask] = msg;
+        ++currentQueueSize;
         if (currentQueueSize > maxQueueSize)
             maxQueueSize = currentQueueSize;
     }
 
-    void Writer::sortQueue() {
-        if (currentQueueSize == 0)
-            return;
+    BuilderMsg* Writer::copyMessage(const BuilderMsg* msg) {
+        BuilderMsg* copy;
+        {
+            std::unique_lock<std::mutex> lck(mtx);
+            if (!msgCopies.empty()) {
+                copy = msgCopies.back();
+                msgCopies.pop_back();
+            } else
+                copy = nullptr;
+        }
+        if (copy == nullptr)
+            copy = new BuilderMsg();
+
+        copy->ptr = nullptr;
+        copy->id = msg->id;
+        copy->queueId = msg->queueId;
+        copy->length = static_cast<uint64_t>(msg->length);
+        copy->scn = msg->scn;
+        copy->lwnScn = msg->lwnScn;
+        copy->lwnIdx = msg->lwnIdx;
+        copy->data = msg->data;
+        copy->sequence = msg->sequence;
+        copy->obj = msg->obj;
+        copy->pos = msg->pos;
+        copy->flags = msg->flags | Builder::OUTPUT_BUFFER_MESSAGE_COPY;
+        copy->tagLength = msg->tagLength;
+        return copy;
+    }
 
-        BuilderMsg** oldQueue = queue;
-        queue = new BuilderMsg* [ctx->queueSize];
-        uint64_t oldQueueSize = currentQueueSize;
-
-        for (uint64_t newId = 0; newId < currentQueueSize; ++newId) {
-            queue[newId] = oldQueue[0];
-            uint64_t i = 0;
-            --oldQueueSize;
-            while (i < oldQueueSize) {
-                if (i * 2 + 2 < oldQueueSize && oldQueue[i * 2 + 2]->id < oldQueue[oldQueueSize]->id) {
-                    if (oldQueue[i * 2 + 1]->id < oldQueue[i * 2 + 2]->id) {
-                        oldQueue[i] = oldQueue[i * 2 + 1];
-                        i = i * 2 + 1;
-                    } else {
-                        oldQueue[i] = oldQueue[i * 2 + 2];
-                        i = i * 2 + 2;
-                    }
-                } else if (i * 2 + 1 < oldQueueSize && oldQueue[i * 2 + 1]->id < oldQueue[oldQueueSize]->id) {
-                    oldQueue[i] = oldQueue[i * 2 + 1];
-                    i = i * 2 + 1;
-                } else
-                    break;
-            }
-            oldQueue[i] = oldQueue[oldQueueSize];
+    void Writer::releaseMessage(BuilderMsg* msg) {
+        // Called with mtx held
+        if ((msg->flags & Builder::OUTPUT_BUFFER_MESSAGE_COPY) != 0)
+            msgCopies.push_back(msg);
+    }
+
+    void Writer::flattenMessage(BuilderMsg* msg) {
+        // Copy the parts to one buffer for a client which needs the message in continuous memory
+        uint64_t totalLength = msg->length + msg->tagLength;
+        auto data = new uint8_t[totalLength];
+        if (data == nullptr)
+            throw RuntimeException(10016, "couldn't allocate " + std::to_string(totalLength) +
+                                          " bytes memory for: temporary buffer for JSON message");
+
+        uint64_t copied = 0;
+        for (const struct iovec& part: msgParts) {
+            memcpy(reinterpret_cast<void*>(data + copied), part.iov_base, part.iov_len);
+            copied += part.iov_len;
         }
 
-        if (oldQueue != nullptr)
-            delete[] oldQueue;
+        msg->data = data;
+        msg->flags = (msg->flags | Builder::OUTPUT_BUFFER_MESSAGE_ALLOCATED) & ~Builder::OUTPUT_BUFFER_MESSAGE_SPLIT;
+    }
+
+    bool Writer::isNewData(const BuilderMsg* msg) const {
+        if (clientScn == Ctx::ZERO_SCN)
+            return true;
+
+        if (clientScn < msg->lwnScn)
+            return true;
+
+        if (clientScn == msg->lwnScn && clientIdx < msg->lwnIdx)
+            return true;
+
+        return false;
     }
 
     void Writer::resetMessageQueue() {
+        std::unique_lock<std::mutex> lck(mtx);
         for (uint64_t i = 0; i < currentQueueSize; ++i) {
-            BuilderMsg* msg = queue[i];
+            uint64_t slot = (queueFirstId + i) & queueMask;
+            BuilderMsg* msg = queue[slot];
             if ((msg->flags & Builder::OUTPUT_BUFFER_MESSAGE_ALLOCATED) != 0)
                 delete[] msg->data;
+            queueConfirmed[slot >> 6] &= ~(1ULL << (slot & 63));
+            releaseMessage(msg);
         }
         currentQueueSize = 0;
 
@@ -128,49 +204,67 @@ namespace OpenLogReplicator {
                 ctx->warning(70007, "trying to confirm an empty message");
                 return;
             }
-            msg = queue[0];
+            msg = firstMessage();
         }
 
-        msg->flags |= Builder::OUTPUT_BUFFER_MESSAGE_CONFIRMED;
+        markConfirmed(msg);
+        releaseConfirmed();
+    }
+
+    void Writer::confirmMessages(BuilderMsg** msgs, uint64_t count) {
+        if (count == 0)
+            return;
+
+        if (ctx->metrics) {
+            uint64_t bytes = 0;
+            for (uint64_t i = 0; i < count; ++i)
+                bytes += msgs[i]->length;
+            ctx->metrics->emitBytesConfirmed(bytes);
+            ctx->metrics->emitMessagesConfirmed(count);
+        }
+
+        std::unique_lock<std::mutex> lck(mtx);
+        for (uint64_t i = 0; i < count; ++i)
+            markConfirmed(msgs[i]);
+        releaseConfirmed();
+    }
+
+    void Writer::markConfirmed(BuilderMsg* msg) {
+        // Called with mtx held
+        uint64_t slot = msg->id & queueMask;
+        queueConfirmed[slot >> 6] |= 1ULL << (slot & 63);
         if (msg->flags & Builder::OUTPUT_BUFFER_MESSAGE_ALLOCATED) {
             delete[] msg->data;
             msg->flags &= ~Builder::OUTPUT_BUFFER_MESSAGE_ALLOCATED;
         }
+    }
 
+    void Writer::releaseConfirmed() {
+        // Called with mtx held, drops the confirmed prefix of the queue
         uint64_t maxId = 0;
-        {
-            while (currentQueueSize > 0 && (queue[0]->flags & Builder::OUTPUT_BUFFER_MESSAGE_CONFIRMED) != 0) {
-                maxId = queue[0]->queueId;
-                if (confirmedScn == Ctx::ZERO_SCN || msg->lwnScn > confirmedScn) {
-                    confirmedScn = msg->lwnScn;
-                    confirmedIdx = msg->lwnIdx;
-                } else if (msg->lwnScn == confirmedScn && msg->lwnIdx > confirmedIdx)
-                    confirmedIdx = msg->lwnIdx;
-
-                if (--currentQueueSize == 0)
-                    break;
-
-                uint64_t i = 0;
-                while (i < currentQueueSize) {
-                    if (i * 2 + 2 < currentQueueSize && queue[i * 2 + 2]->id < queue[currentQueueSize]->id) {
-                        if (queue[i * 2 + 1]->id < queue[i * 2 + 2]->id) {
-                            queue[i] = queue[i * 2 + 1];
-                            i = i * 2 + 1;
-                        } else {
-                            queue[i] = queue[i * 2 + 2];
-                            i = i * 2 + 2;
-                        }
-                    } else if (i * 2 + 1 < currentQueueSize && queue[i * 2 + 1]->id < queue[currentQueueSize]->id) {
-                        queue[i] = queue[i * 2 + 1];
-                        i = i * 2 + 1;
-                    } else
-                        break;
-                }
-                queue[i] = queue[currentQueueSize];
-            }
+        bool released = false;
+        while (currentQueueSize > 0) {
+            uint64_t slot = queueFirstId & queueMask;
+            if ((queueConfirmed[slot >> 6] & (1ULL << (slot & 63))) == 0)
+                break;
+            queueConfirmed[slot >> 6] &= ~(1ULL << (slot & 63));
+
+            BuilderMsg* confirmedMsg = queue[slot];
+            maxId = confirmedMsg->queueId;
+            released = true;
+            if (confirmedScn == Ctx::ZERO_SCN || confirmedMsg->lwnScn > confirmedScn) {
+                confirmedScn = confirmedMsg->lwnScn;
+                confirmedIdx = confirmedMsg->lwnIdx;
+            } else if (confirmedMsg->lwnScn == confirmedScn && confirmedMsg->lwnIdx > confirmedIdx)
+                confirmedIdx = confirmedMsg->lwnIdx;
+            releaseMessage(confirmedMsg);
+
+            ++queueFirstId;
+            --currentQueueSize;
         }
 
-        builder->releaseBuffers(maxId);
+        if (released)
+            builder->releaseBuffers(builderWriter, maxId);
     }
 
     void Writer::run() {
@@ -185,6 +279,7 @@ namespace OpenLogReplicator {
         try {
             // Before anything, read the latest checkpoint
             readCheckpoint();
+            copyMessages = (builder->getWriters() > 1);
             builderQueue = builder->firstBuilderQueue;
             oldLength = 0;
             currentQueueSize = 0;
@@ -235,7 +330,7 @@ namespace OpenLogReplicator {
 
                 if (ctx->trace & Ctx::TRACE_WRITER)
                     ctx->logTrace(Ctx::TRACE_WRITER, "waiting for client");
-                usleep(ctx->pollIntervalUs);
+                sleepForClient();
             }
 
             // Get a message to send
@@ -262,7 +357,7 @@ namespace OpenLogReplicator {
 
                 if (ctx->softShutdown && ctx->replicatorFinished)
                     break;
-                builder->sleepForWriterWork(currentQueueSize, ctx->pollIntervalUs);
+                sleepForWork();
             }
 
             // Send the message
@@ -277,7 +372,7 @@ namespace OpenLogReplicator {
                     if (ctx->trace & Ctx::TRACE_WRITER)
                         ctx->logTrace(Ctx::TRACE_WRITER, "output queue is full (" + std::to_string(currentQueueSize) +
                                                          " elements), sleeping " + std::to_string(ctx->pollIntervalUs) + "us");
-                    usleep(ctx->pollIntervalUs);
+                    sleepForClient();
                     pollQueue();
                 }
 
@@ -285,15 +380,17 @@ namespace OpenLogReplicator {
                 if (ctx->hardShutdown)
                     break;
 
-                uint64_t length8 = (msg->length + 7) & 0xFFFFFFFFFFFFFFF8;
+                uint64_t length8 = (msg->length + msg->tagLength + 7) & 0xFFFFFFFFFFFFFFF8;
                 oldLength += sizeof(struct BuilderMsg);
 
                 // Message in one part - send directly from buffer
                 if (oldLength + length8 <= Builder::OUTPUT_BUFFER_DATA_SIZE) {
+                    if (copyMessages)
+                        msg = copyMessage(msg);
                     createMessage(msg);
                     // Send the message to the client in one part
                     if (((msg->flags & Builder::OUTPUT_BUFFER_MESSAGE_CHECKPOINT) && !ctx->flagsSet(Ctx::REDO_FLAGS_SHOW_CHECKPOINT)) ||
-                        !metadata->isNewData(msg->lwnScn, msg->lwnIdx))
+                        !isNewData(msg))
                         confirmMessage(msg);
                     else {
                         uint64_t msgLength = msg->length;
@@ -306,35 +403,46 @@ namespace OpenLogReplicator {
                     oldLength += length8;
 
                 } else {
-                    // The message is split to many parts - merge & copy
-                    msg->data = new uint8_t[msg->length];
-                    if (msg->data == nullptr)
-                        throw RuntimeException(10016, "couldn't allocate " + std::to_string(msg->length) +
-                                                      " bytes memory for: temporary buffer for JSON message");
-                    msg->flags |= Builder::OUTPUT_BUFFER_MESSAGE_ALLOCATED;
-
-                    uint64_t copied = 0;
-                    while (msg->length > copied) {
-                        uint64_t toCopy = msg->length - copied;
-                        if (toCopy > newLength - oldLength) {
-                            toCopy = newLength - oldLength;
-                            memcpy(reinterpret_cast<void*>(msg->data + copied),
-                                   reinterpret_cast<const void*>(builderQueue->data + oldLength), toCopy);
+                    // The message is split to many parts - send directly from the buffers, they are kept until confirmation
+                    if (copyMessages)
+                        msg = copyMessage(msg);
+                    uint64_t totalLength = msg->length + msg->tagLength;
+                    uint64_t payloadLength = msg->length;
+                    msgParts.clear();
+                    msgPayloadParts = 0;
+
+                    uint64_t collected = 0;
+                    while (totalLength > collected) {
+                        uint8_t* part = builderQueue->data + oldLength;
+                        uint64_t partLength = totalLength - collected;
+                        if (partLength > newLength - oldLength) {
+                            partLength = newLength - oldLength;
                             builderQueue = builderQueue->next;
                             newLength = Builder::OUTPUT_BUFFER_DATA_SIZE;
                             oldLength = 0;
-                        } else {
-                            memcpy(reinterpret_cast<void*>(msg->data + copied),
-                                   reinterpret_cast<const void*>(builderQueue->data + oldLength), toCopy);
-                            oldLength += (toCopy + 7) & 0xFFFFFFFFFFFFFFF8;
-                        }
-                        copied += toCopy;
+                        } else
+                            oldLength += (partLength + 7) & 0xFFFFFFFFFFFFFFF8;
+                        collected += partLength;
+
+                        // A part holding the end of the payload and the start of the tag is split into a payload iovec and a tag iovec
+                        if (payloadLength > 0) {
+                            uint64_t payloadPart = std::min(partLength, payloadLength);
+                            msgParts.push_back({part, payloadPart});
+                            payloadLength -= payloadPart;
+                            if (payloadLength == 0)
+                                msgPayloadParts = msgParts.size();
+                            if (partLength > payloadPart)
+                                msgParts.push_back({part + payloadPart, partLength - payloadPart});
+                        } else
+                            msgParts.push_back({part, partLength});
                     }
+                    msg->data = reinterpret_cast<uint8_t*>(msgParts[0].iov_base);
+                    msg->flags |= Builder::OUTPUT_BUFFER_MESSAGE_SPLIT;
 
                     createMessage(msg);
                     // Send only new messages to the client
                     if (((msg->flags & Builder::OUTPUT_BUFFER_MESSAGE_CHECKPOINT) && !ctx->flagsSet(Ctx::REDO_FLAGS_SHOW_CHECKPOINT)) ||
-                        !metadata->isNewData(msg->lwnScn, msg->lwnIdx))
+                        !isNewData(msg))
                         confirmMessage(msg);
                     else {
                         uint64_t msgLength = msg->length;
@@ -357,9 +465,23 @@ namespace OpenLogReplicator {
             }
         }
 
+        // Clean shutdown - outputs are complete before the last checkpoint
+        if (!ctx->hardShutdown)
+            closeOutputs();
         writeCheckpoint(true);
     }
 
+    void Writer::closeOutputs() {
+    }
+
+    void Writer::sleepForClient() {
+        usleep(ctx->pollIntervalUs);
+    }
+
+    void Writer::sleepForWork() {
+        builder->sleepForWriterWork(currentQueueSize, ctx->pollIntervalUs);
+    }
+
     void Writer::writeCheckpoint(bool force) {
         // Nothing changed
         if ((checkpointScn == confirmedScn && checkpointIdx == confirmedIdx) || confirmedScn == Ctx::ZERO_SCN)
@@ -384,30 +506,97 @@ namespace OpenLogReplicator {
                                                      std::to_string(confirmedIdx) + " checkpoint scn: " + std::to_string(checkpointScn) + " idx: " +
                                                      std::to_string(checkpointIdx));
         }
-        std::string name(database + "-chkpt");
         std::ostringstream ss;
+        checkpointDocument(ss);
+
+        if (metadata->stateWrite(checkpointName, confirmedScn, ss)) {
+            checkpointScn = confirmedScn;
+            checkpointIdx = confirmedIdx;
+            checkpointTime = now;
+        }
+    }
+
+    void Writer::checkpointDocument(std::ostringstream& ss) const {
         ss << R"({"database":")" << database
            << R"(","scn":)" << std::dec << confirmedScn
            << R"(,"idx":)" << std::dec << confirmedIdx
            << R"(,"resetlogs":)" << std::dec << metadata->resetlogs
            << R"(,"activation":)" << std::dec << metadata->activation << "}";
+    }
 
-        if (metadata->stateWrite(name, confirmedScn, ss)) {
-            checkpointScn = confirmedScn;
-            checkpointIdx = confirmedIdx;
-            checkpointTime = now;
+    void Writer::readCheckpoint() {
+        typeScn scn = Ctx::ZERO_SCN;
+        typeIdx idx = 0;
+        typeResetlogs resetlogs = 0;
+        typeActivation activation = 0;
+
+        bool found = readCheckpointState(scn, idx, resetlogs, activation);
+
+        // Target which started to share the source continues from the checkpoint of the source
+        if (!found && !checkpointNamePrevious.empty()) {
+            std::string name = checkpointName;
+            checkpointName = checkpointNamePrevious;
+            found = readCheckpointState(scn, idx, resetlogs, activation);
+            checkpointName = name;
+            if (found)
+                ctx->info(0, "checkpoint - continuing from: " + checkpointNamePrevious + ", saved as: " + checkpointName);
+        }
+
+        if (!found) {
+            metadata->writerStarted(Ctx::ZERO_SCN, 0);
+            return;
         }
+
+        metadata->setResetlogs(resetlogs);
+        metadata->setActivation(activation);
+
+        // Started earlier - continue work & ignore default startup parameters
+        checkpointScn = scn;
+        checkpointIdx = idx;
+        clientScn = checkpointScn;
+        clientIdx = checkpointIdx;
+
+        ctx->info(0, "checkpoint - all confirmed till scn: " + std::to_string(checkpointScn) + ", idx: " +
+                     std::to_string(checkpointIdx));
+        metadata->writerStarted(checkpointScn, checkpointIdx);
     }
 
-    void Writer::readCheckpoint() {
-        std::string name(database + "-chkpt");
+    bool Writer::readCheckpointState(typeScn& scn, typeIdx& idx, typeResetlogs& resetlogs, typeActivation& activation) {
+        const std::string& name = checkpointName;
 
         // Checkpoint is present - read it
         std::string checkpoint;
-        rapidjson::Document document;
-        if (!metadata->stateRead(name, CHECKPOINT_FILE_MAX_SIZE, checkpoint))
-            return;
+        bool found = metadata->stateRead(name, CHECKPOINT_FILE_MAX_SIZE, checkpoint);
+        if (found)
+            parseCheckpoint(name, checkpoint, scn, idx, resetlogs, activation);
+
+        // Checkpoint committed together with the output could be newer than the local one
+        std::string checkpointExternal;
+        if (readCheckpointExternal(checkpointExternal)) {
+            typeScn scnExternal = Ctx::ZERO_SCN;
+            typeIdx idxExternal = 0;
+            typeResetlogs resetlogsExternal = 0;
+            typeActivation activationExternal = 0;
+            parseCheckpoint(name, checkpointExternal, scnExternal, idxExternal, resetlogsExternal, activationExternal);
+
+            if (!found || scnExternal > scn || (scnExternal == scn && idxExternal > idx)) {
+                found = true;
+                scn = scnExternal;
+                idx = idxExternal;
+                resetlogs = resetlogsExternal;
+                activation = activationExternal;
+            }
+        }
+        return found;
+    }
 
+    bool Writer::readCheckpointExternal(std::string& checkpoint __attribute__((unused))) {
+        return false;
+    }
+
+    void Writer::parseCheckpoint(const std::string& name, const std::string& checkpoint, typeScn& scn, typeIdx& idx, typeResetlogs& resetlogs,
+                                 typeActivation& activation) const {
+        rapidjson::Document document;
         if (checkpoint.length() == 0 || document.Parse(checkpoint.c_str()).HasParseError())
             throw DataException(20001, "file: " + name + " offset: " + std::to_string(document.GetErrorOffset()) +
                                        " - parse error: " + GetParseError_En(document.GetParseError()));
@@ -421,25 +610,13 @@ namespace OpenLogReplicator {
         if (database != databaseJson)
             throw DataException(20001, "file: " + name + " - invalid database name: " + databaseJson);
 
-        metadata->setResetlogs(Ctx::getJsonFieldU32(name, document, "resetlogs"));
-        metadata->setActivation(Ctx::getJsonFieldU32(name, document, "activation"));
-
-        // Started earlier - continue work & ignore default startup parameters
-        checkpointScn = Ctx::getJsonFieldU64(name, document, "scn");
-        metadata->clientScn = checkpointScn;
+        resetlogs = Ctx::getJsonFieldU32(name, document, "resetlogs");
+        activation = Ctx::getJsonFieldU32(name, document, "activation");
+        scn = Ctx::getJsonFieldU64(name, document, "scn");
         if (document.HasMember("idx"))
-            checkpointIdx = Ctx::getJsonFieldU64(name, document, "idx");
+            idx = Ctx::getJsonFieldU64(name, document, "idx");
         else
-            checkpointIdx = 0;
-        metadata->clientIdx = checkpointIdx;
-        metadata->startScn = checkpointScn;
-        metadata->startSequence = Ctx::ZERO_SEQ;
-        metadata->startTime.clear();
-        metadata->startTimeRel = 0;
-
-        ctx->info(0, "checkpoint - all confirmed till scn: " + std::to_string(checkpointScn) + ", idx: " +
-                     std::to_string(checkpointIdx));
-        metadata->setStatusReplicate();
+            idx = 0;
     }
 
     void Writer::wakeUp() {
@@ -18,6 +18,10 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 <http://www.gnu.org/licenses/>.  */
 
 #include <mutex>
+#include <sstream>
+#include <sys/uio.h>
+#include <vector>
+
 #include "../common/Thread.h"
 
 #ifndef WRITER_H_
@@ -34,8 +38,12 @@ namespace OpenLogReplicator {
         static constexpr uint64_t CHECKPOINT_FILE_MAX_SIZE = 1024;
 
         std::string database;
+        std::string checkpointName;
+        // Name used before the target shared the source with other targets, read once when checkpointName is not present yet
+        std::string checkpointNamePrevious;
         Builder* builder;
         Metadata* metadata;
+        uint64_t builderWriter;
         // Information about local checkpoint
         BuilderQueue* builderQueue;
         typeScn checkpointScn;
@@ -46,22 +54,51 @@ namespace OpenLogReplicator {
         uint64_t currentQueueSize;
         uint64_t maxQueueSize;
         bool streaming;
+        // Position already delivered to this writer's client
+        typeScn clientScn;
+        typeIdx clientIdx;
+        // The output is shared with other writers, messages are tracked on private copies
+        bool copyMessages;
+        std::vector<BuilderMsg*> msgCopies;
+        // Parts of the message being sent which spans many output buffers: payload parts first, then the tag
+        std::vector<struct iovec> msgParts;
+        uint64_t msgPayloadParts;
 
         std::mutex mtx;
         // scn,idx confirmed by client
         typeScn confirmedScn;
         typeIdx confirmedIdx;
+        // Ring of messages not yet confirmed, indexed by message id, with a bitmap of confirmed slots
         BuilderMsg** queue;
+        uint64_t* queueConfirmed;
+        uint64_t queueMask;
+        uint64_t queueFirstId;
 
         void createMessage(BuilderMsg* msg);
+        [[nodiscard]] BuilderMsg* firstMessage() const {
+            return queue[queueFirstId & queueMask];
+        }
+        BuilderMsg* copyMessage(const BuilderMsg* msg);
+        void releaseMessage(BuilderMsg* msg);
+        void flattenMessage(BuilderMsg* msg);
+        void markConfirmed(BuilderMsg* msg);
+        void releaseConfirmed();
+        [[nodiscard]] bool isNewData(const BuilderMsg* msg) const;
         virtual void sendMessage(BuilderMsg* msg) = 0;
         virtual std::string getName() const = 0;
         virtual void pollQueue() = 0;
+        virtual void sleepForClient();
+        virtual void sleepForWork();
         void run() override;
         void mainLoop();
         virtual void writeCheckpoint(bool force);
+        virtual void closeOutputs();
+        void checkpointDocument(std::ostringstream& ss) const;
         void readCheckpoint();
-        void sortQueue();
+        bool readCheckpointState(typeScn& scn, typeIdx& idx, typeResetlogs& resetlogs, typeActivation& activation);
+        virtual bool readCheckpointExternal(std::string& checkpoint);
+        void parseCheckpoint(const std::string& name, const std::string& checkpoint, typeScn& scn, typeIdx& idx, typeResetlogs& resetlogs,
+                             typeActivation& activation) const;
         void resetMessageQueue();
 
     public:
@@ -69,7 +106,9 @@ namespace OpenLogReplicator {
         ~Writer() override;
 
         virtual void initialize();
+        void setCheckpointName(const std::string& newCheckpointName);
         void confirmMessage(BuilderMsg* msg);
+        void confirmMessages(BuilderMsg** msgs, uint64_t count);
         void wakeUp() override;
     };
 }
@@ -22,11 +22,15 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 
 #include <cstring>
 #include <dirent.h>
+#include <algorithm>
+#include <climits>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "../builder/Builder.h"
+#include "../common/Clock.h"
 #include "../common/exception/ConfigurationException.h"
 #include "../common/exception/RuntimeException.h"
 #include "../metadata/Metadata.h"
@@ -34,7 +38,9 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 
 namespace OpenLogReplicator {
     WriterFile::WriterFile(Ctx* newCtx, const std::string& newAlias, const std::string& newDatabase, Builder* newBuilder, Metadata* newMetadata,
-                           const char* newOutput, const char* newTimestampFormat, uint64_t newMaxFileSize, uint64_t newNewLine, uint64_t newAppend) :
+                           const char* newOutput, const char* newTimestampFormat, uint64_t newMaxFileSize, uint64_t newNewLine, uint64_t newAppend,
+                           uint64_t newSyncMode, uint64_t newSyncIntervalMs, uint64_t newSyncSizeMb, uint64_t newCompression,
+                           uint64_t newFrameSizeMb, uint64_t newMaxOpenFiles) :
             Writer(newCtx, newAlias, newDatabase, newBuilder, newMetadata),
             prefixPos(0),
             suffixPos(0),
@@ -42,24 +48,51 @@ namespace OpenLogReplicator {
             fill(0),
             output(newOutput),
             timestampFormat(newTimestampFormat),
-            fileNameNum(0),
-            fileSize(0),
             maxFileSize(newMaxFileSize),
-            outputDes(-1),
             newLine(newNewLine),
             append(newAppend),
-            lastSequence(Ctx::ZERO_SEQ),
             newLineMsg(nullptr),
-            warningDisplayed(false) {
+            warningDisplayed(false),
+            syncMode(newSyncMode),
+            syncIntervalMs(newSyncIntervalMs),
+            syncSizeMb(newSyncSizeMb),
+            compression(newCompression),
+            frameSizeMb(newFrameSizeMb),
+            partitioned(false),
+            maxOpenFiles(newMaxOpenFiles),
+            openFiles(0),
+            useCounter(0),
+            defaultOutput(nullptr) {
     }
 
     WriterFile::~WriterFile() {
-        closeFile();
+        // Messages not written are not confirmed and are processed again after restart
+        for (auto& outputsIt: outputs) {
+            WriterFileOutput* out = outputsIt.second;
+            if (out->outputDes != -1)
+                close(out->outputDes);
+            if (out->indexDes != -1)
+                close(out->indexDes);
+#ifdef LINK_LIBRARY_ZSTD
+            if (out->cctx != nullptr)
+                ZSTD_freeCCtx(out->cctx);
+#endif /* LINK_LIBRARY_ZSTD */
+            delete out;
+        }
+        outputs.clear();
+        objOutputs.clear();
+        pendingOutputs.clear();
+        defaultOutput = nullptr;
     }
 
     void WriterFile::initialize() {
         Writer::initialize();
 
+#ifdef LINK_LIBRARY_ZSTD
+        if (compression == COMPRESSION_ZSTD)
+            compressBuffer.resize(ZSTD_CStreamOutSize());
+#endif /* LINK_LIBRARY_ZSTD */
+
         if (newLine == 1) {
             newLineMsg = "\n";
         } else if (newLine == 2) {
@@ -67,7 +100,9 @@ namespace OpenLogReplicator {
         }
 
         if (this->output.length() == 0) {
-            outputDes = STDOUT_FILENO;
+            defaultOutput = createOutput("");
+            defaultOutput->outputDes = STDOUT_FILENO;
+            streaming = true;
             return;
         }
 
@@ -126,7 +161,7 @@ namespace OpenLogReplicator {
             mode = MODE_SEQUENCE;
             suffixPos = prefixPos + 2;
         } else {
-            if ((prefixPos = fileNameMask.find('%')) != std::string::npos)
+            if (expandMask(fileNameMask, "").find('%') != std::string::npos)
                 throw ConfigurationException(30005, "invalid value for 'output': " + this->output);
             if (append == 0)
                 throw ConfigurationException(30006, "output file is with no rotation: " + this->output + " - 'append' must be set to 1");
@@ -137,189 +172,551 @@ namespace OpenLogReplicator {
             throw ConfigurationException(30007, "output file is with no max file size: " + this->output +
                                                 " - 'max-file-size' must be defined for output with rotation");
 
+        // Owner and table name are passed by the builder after the message data
+        if (fileNameMask.find("%o") != std::string::npos || fileNameMask.find("%n") != std::string::npos) {
+            partitioned = true;
+            builder->setMessageTags(true);
+        }
+
+        defaultOutput = createOutput("");
+        streaming = true;
+    }
+
+    std::string WriterFile::expandMask(const std::string& mask, const std::string& tag) const {
+        // Messages not related to a single table use '_' for the owner and the table name
+        std::string owner("_");
+        std::string table("_");
+        if (!tag.empty()) {
+            owner = tag.c_str();
+            table = tag.c_str() + owner.length() + 1;
+        }
+
+        // Quoted names can contain a directory separator
+        std::replace(owner.begin(), owner.end(), '/', '_');
+        std::replace(table.begin(), table.end(), '/', '_');
+
+        std::string fileName;
+        for (uint64_t i = 0; i < mask.length(); ++i) {
+            if (mask.compare(i, 2, "%o") == 0) {
+                fileName.append(owner);
+                ++i;
+            } else if (mask.compare(i, 2, "%n") == 0) {
+                fileName.append(table);
+                ++i;
+            } else
+                fileName.push_back(mask[i]);
+        }
+        return fileName;
+    }
+
+    uint64_t WriterFile::findFileNum(const std::string& prefix, const std::string& suffix) {
+        uint64_t fileNameNum = 0;
+        DIR* dir;
+        if ((dir = opendir(pathName.c_str())) == nullptr)
+            throw RuntimeException(10012, "directory: " + pathName + " - can't read");
+
+        struct dirent* ent;
+        while ((ent = readdir(dir)) != nullptr) {
+            if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0)
+                continue;
+
+            struct stat fileStat;
+            std::string fileName(ent->d_name);
+
+            std::string fileNameFull(pathName + "/" + ent->d_name);
+            if (stat(fileNameFull.c_str(), &fileStat) != 0) {
+                ctx->warning(60034, "file: " + fileNameFull + " - stat returned: " + strerror(errno));
+                continue;
+            }
+
+            if (S_ISDIR(fileStat.st_mode))
+                continue;
+
+            if (fileName.length() <= prefix.length() + suffix.length() || fileName.substr(0, prefix.length()) != prefix)
+                continue;
+
+            if (fileName.substr(fileName.length() - suffix.length()) != suffix)
+                continue;
+
+            // Ignore other files, like outputs of other tables sharing the prefix or the .idx files
+            std::string fileNameFoundNum(fileName.substr(prefix.length(), fileName.length() - suffix.length() - prefix.length()));
+            if (fileNameFoundNum.find_first_not_of("0123456789") != std::string::npos)
+                continue;
+
+            if (ctx->trace & Ctx::TRACE_WRITER)
+                ctx->logTrace(Ctx::TRACE_WRITER, "found previous output file: " + pathName + "/" + fileName);
+            typeScn fileNum = strtoull(fileNameFoundNum.c_str(), nullptr, 10);
+            // A compressed file of a previous run could end with a truncated frame, so it is never continued
+            if (append > 0 && compression == COMPRESSION_NONE) {
+                if (fileNameNum < fileNum)
+                    fileNameNum = fileNum;
+            } else {
+                if (fileNameNum <= fileNum)
+                    fileNameNum = fileNum + 1;
+            }
+        }
+        closedir(dir);
+        return fileNameNum;
+    }
+
+    WriterFileOutput* WriterFile::createOutput(const std::string& tag) {
+        auto out = new WriterFileOutput();
+        out->tag = tag;
+        out->fileNameNum = 0;
+        out->fileSize = 0;
+        out->lastSequence = Ctx::ZERO_SEQ;
+        out->outputDes = -1;
+        out->lastUsed = 0;
+        out->pending = false;
+        out->batchBytes = 0;
+        out->batchTime = 0;
+        out->unsyncedBytes = 0;
+        out->unsyncedTime = 0;
+        out->frameBytes = 0;
+        out->frameOpen = false;
+        out->indexDes = -1;
+#ifdef LINK_LIBRARY_ZSTD
+        out->cctx = nullptr;
+#endif /* LINK_LIBRARY_ZSTD */
+        outputs[tag] = out;
+
+        if (mode == MODE_NO_ROTATE) {
+            out->prefix = expandMask(fileNameMask, tag);
+        } else if (mode != MODE_STDOUT) {
+            out->prefix = expandMask(fileNameMask.substr(0, prefixPos), tag);
+            out->suffix = expandMask(fileNameMask.substr(suffixPos), tag);
+        }
+
         // Search for last used number
         if (mode == MODE_NUM) {
-            DIR* dir;
-            if ((dir = opendir(pathName.c_str())) == nullptr)
-                throw RuntimeException(10012, "directory: " + pathName + " - can't read");
-
-            struct dirent* ent;
-            while ((ent = readdir(dir)) != nullptr) {
-                if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0)
-                    continue;
-
-                struct stat fileStat;
-                std::string fileName(ent->d_name);
-
-                std::string fileNameFull(pathName + "/" + ent->d_name);
-                if (stat(fileNameFull.c_str(), &fileStat) != 0) {
-                    ctx->warning(60034, "file: " + fileNameFull + " - stat returned: " + strerror(errno));
-                    continue;
+            out->fileNameNum = findFileNum(out->prefix, out->suffix);
+            ctx->info(0, "next number for " + pathName + "/" + out->prefix + fileNameMask.substr(prefixPos, suffixPos - prefixPos) +
+                         out->suffix + " is: " + std::to_string(out->fileNameNum));
+        }
+        return out;
+    }
+
+    WriterFileOutput* WriterFile::resolveOutput(const BuilderMsg* msg) {
+        if (!partitioned || msg->tagLength == 0)
+            return defaultOutput;
+
+        const char* tag;
+        std::string splitTag;
+        uint64_t tagLength = msg->tagLength;
+        if ((msg->flags & Builder::OUTPUT_BUFFER_MESSAGE_SPLIT) != 0) {
+            for (uint64_t i = msgPayloadParts; i < msgParts.size(); ++i)
+                splitTag.append(reinterpret_cast<const char*>(msgParts[i].iov_base), msgParts[i].iov_len);
+            tag = splitTag.c_str();
+        } else
+            tag = reinterpret_cast<const char*>(msg->data + msg->length);
+        uint64_t ownerLength = strnlen(tag, tagLength);
+        uint64_t tableTagLength = ownerLength + 1 + strnlen(tag + ownerLength + 1, tagLength - ownerLength - 1);
+
+        auto objOutputsIt = objOutputs.find(msg->obj);
+        if (objOutputsIt != objOutputs.end() && objOutputsIt->second->tag.compare(0, std::string::npos, tag, tableTagLength) == 0)
+            return objOutputsIt->second;
+
+        // First message for the table or the table was renamed, a table recreated under the same name shares the file
+        std::string tableTag(tag, tableTagLength);
+        WriterFileOutput* out;
+        auto outputsIt = outputs.find(tableTag);
+        if (outputsIt != outputs.end())
+            out = outputsIt->second;
+        else
+            out = createOutput(tableTag);
+        objOutputs[msg->obj] = out;
+        return out;
+    }
+
+    void WriterFile::evictOutput() {
+        WriterFileOutput* victim = nullptr;
+        for (auto& outputsIt: outputs) {
+            WriterFileOutput* out = outputsIt.second;
+            if (out->outputDes != -1 && (victim == nullptr || out->lastUsed < victim->lastUsed))
+                victim = out;
+        }
+        if (victim == nullptr)
+            return;
+
+        if (ctx->trace & Ctx::TRACE_WRITER)
+            ctx->logTrace(Ctx::TRACE_WRITER, "closing least recently used output file: " + victim->fullFileName);
+        closeFile(victim);
+        // The same file can be opened again later to append
+        victim->evictedFileName = victim->fullFileName;
+    }
+
+    void WriterFile::closeFile(WriterFileOutput* out) {
+        if (out->outputDes != -1) {
+            flushBatch(out);
+#ifdef LINK_LIBRARY_ZSTD
+            // Every file is a complete zstd stream
+            if (out->frameOpen) {
+                compressEnd(out, ZSTD_e_end);
+                out->frameOpen = false;
+            }
+            if (out->cctx != nullptr) {
+                ZSTD_freeCCtx(out->cctx);
+                out->cctx = nullptr;
+            }
+#endif /* LINK_LIBRARY_ZSTD */
+            syncFile(out);
+            close(out->outputDes);
+            out->outputDes = -1;
+            --openFiles;
+        }
+
+        if (out->indexDes != -1) {
+            close(out->indexDes);
+            out->indexDes = -1;
+        }
+    }
+
+    void WriterFile::writeParts(WriterFileOutput* out, const struct iovec* parts, uint64_t count, uint64_t length) {
+        uint64_t bytesWritten = 0;
+        for (uint64_t i = 0; i < count; i += IOV_MAX) {
+            int partsCount = static_cast<int>(std::min(count - i, static_cast<uint64_t>(IOV_MAX)));
+            uint64_t expected = 0;
+            for (int j = 0; j < partsCount; ++j)
+                expected += parts[i + j].iov_len;
+
+            int64_t partWritten = writev(out->outputDes, parts + i, partsCount);
+            if (partWritten > 0)
+                bytesWritten += partWritten;
+            if (static_cast<uint64_t>(partWritten) != expected)
+                throw RuntimeException(10007, "file: " + out->fullFileName + " - " + std::to_string(bytesWritten) + " bytes written instead of " +
+                                              std::to_string(length) + ", code returned: " + strerror(errno));
+        }
+    }
+
+    void WriterFile::writeIndex(WriterFileOutput* out, const BuilderMsg* msg) {
+        if (out->indexDes == -1)
+            return;
+
+        off_t offset = lseek(out->outputDes, 0, SEEK_CUR);
+        if (offset == -1)
+            throw RuntimeException(10011, "file: " + out->fullFileName + " - seek returned: " + strerror(errno));
+
+        std::string entry(R"({"c_scn":)" + std::to_string(msg->lwnScn) + R"(,"c_idx":)" + std::to_string(msg->lwnIdx) +
+                          R"(,"offset":)" + std::to_string(offset) + "}\n");
+        int64_t bytesWritten = write(out->indexDes, entry.c_str(), entry.length());
+        if (static_cast<uint64_t>(bytesWritten) != entry.length())
+            throw RuntimeException(10007, "file: " + out->fullFileName + ".idx - " + std::to_string(bytesWritten) + " bytes written instead of " +
+                                          std::to_string(entry.length()) + ", code returned: " + strerror(errno));
+    }
+
+#ifdef LINK_LIBRARY_ZSTD
+    void WriterFile::compressParts(WriterFileOutput* out, const struct iovec* parts, uint64_t count) {
+        for (uint64_t i = 0; i < count; ++i) {
+            ZSTD_inBuffer inBuffer = {parts[i].iov_base, parts[i].iov_len, 0};
+            while (inBuffer.pos < inBuffer.size) {
+                ZSTD_outBuffer outBuffer = {compressBuffer.data(), compressBuffer.size(), 0};
+                size_t ret = ZSTD_compressStream2(out->cctx, &outBuffer, &inBuffer, ZSTD_e_continue);
+                if (ZSTD_isError(ret))
+                    throw RuntimeException(10074, "file: " + out->fullFileName + " - compression failed: " + ZSTD_getErrorName(ret));
+                if (outBuffer.pos > 0) {
+                    struct iovec part = {compressBuffer.data(), outBuffer.pos};
+                    writeParts(out, &part, 1, outBuffer.pos);
                 }
+            }
+        }
+    }
+
+    void WriterFile::compressEnd(WriterFileOutput* out, ZSTD_EndDirective endMode) {
+        // Write out all data consumed by the compressor, ZSTD_e_end also closes the frame
+        ZSTD_inBuffer inBuffer = {nullptr, 0, 0};
+        size_t remaining;
+        do {
+            ZSTD_outBuffer outBuffer = {compressBuffer.data(), compressBuffer.size(), 0};
+            remaining = ZSTD_compressStream2(out->cctx, &outBuffer, &inBuffer, endMode);
+            if (ZSTD_isError(remaining))
+                throw RuntimeException(10074, "file: " + out->fullFileName + " - compression failed: " + ZSTD_getErrorName(remaining));
+            if (outBuffer.pos > 0) {
+                struct iovec part = {compressBuffer.data(), outBuffer.pos};
+                writeParts(out, &part, 1, outBuffer.pos);
+            }
+        } while (remaining != 0);
+    }
+#endif /* LINK_LIBRARY_ZSTD */
+
+    void WriterFile::flushBatch(WriterFileOutput* out) {
+        if (out->batchMsgs.empty())
+            return;
 
-                if (S_ISDIR(fileStat.st_mode))
-                    continue;
-
-                std::string prefix(fileNameMask.substr(0, prefixPos));
-                if (fileName.length() < prefix.length() || fileName.substr(0, prefix.length()) != prefix)
-                    continue;
-
-                std::string suffix(fileNameMask.substr(suffixPos));
-                if (fileName.length() < suffix.length() || fileName.substr(fileName.length() - suffix.length()) != suffix)
-                    continue;
-
-                if (ctx->trace & Ctx::TRACE_WRITER)
-                    ctx->logTrace(Ctx::TRACE_WRITER, "found previous output file: " + pathName + "/" + fileName);
-                std::string fileNameFoundNum(fileName.substr(prefix.length(), fileName.length() - suffix.length() - prefix.length()));
-                typeScn fileNum;
-                try {
-                    fileNum = strtoull(fileNameFoundNum.c_str(), nullptr, 10);
-                } catch (const std::exception& e) {
-                    // Ignore other files
-                    continue;
+#ifdef LINK_LIBRARY_ZSTD
+        if (compression == COMPRESSION_ZSTD) {
+            uint64_t part = 0;
+            for (uint64_t i = 0; i < out->batchMsgs.size(); ++i) {
+                if (!out->frameOpen) {
+                    writeIndex(out, out->batchMsgs[i]);
+                    out->frameOpen = true;
+                    out->frameBytes = 0;
                 }
-                if (append > 0) {
-                    if (fileNameNum < fileNum)
-                        fileNameNum = fileNum;
-                } else {
-                    if (fileNameNum <= fileNum)
-                        fileNameNum = fileNum + 1;
+
+                compressParts(out, out->batchParts.data() + part, out->batchMsgParts[i]);
+                part += out->batchMsgParts[i];
+                out->frameBytes += out->batchMsgs[i]->length + newLine;
+                if (out->frameBytes >= frameSizeMb * 1024 * 1024) {
+                    compressEnd(out, ZSTD_e_end);
+                    out->frameOpen = false;
                 }
             }
-            closedir(dir);
-            ctx->info(0, "next number for " + this->output + " is: " + std::to_string(fileNameNum));
+
+            // Messages are confirmed only when the compressed data is written
+            if (out->frameOpen)
+                compressEnd(out, ZSTD_e_flush);
+        } else
+#endif /* LINK_LIBRARY_ZSTD */
+            writeParts(out, out->batchParts.data(), out->batchParts.size(), out->batchBytes);
+        out->batchParts.clear();
+        out->batchMsgParts.clear();
+
+        if (syncMode == SYNC_MODE_NONE) {
+            confirmMessages(out->batchMsgs.data(), out->batchMsgs.size());
+        } else {
+            if (out->unsyncedMsgs.empty())
+                out->unsyncedTime = ctx->clock->getTimeUt();
+            out->unsyncedMsgs.insert(out->unsyncedMsgs.end(), out->batchMsgs.begin(), out->batchMsgs.end());
+            out->unsyncedBytes += out->batchBytes;
         }
+        out->batchMsgs.clear();
+        out->batchBytes = 0;
+    }
 
-        streaming = true;
+    void WriterFile::syncFile(WriterFileOutput* out) {
+        if (out->unsyncedMsgs.empty())
+            return;
+
+        // Confirmed position never runs ahead of the data on disk
+        if (out->outputDes != STDOUT_FILENO && fdatasync(out->outputDes) != 0)
+            throw RuntimeException(10073, "file: " + out->fullFileName + " - sync returned: " + strerror(errno));
+
+        confirmMessages(out->unsyncedMsgs.data(), out->unsyncedMsgs.size());
+        out->unsyncedMsgs.clear();
+        out->unsyncedBytes = 0;
+    }
+
+    void WriterFile::flushAll() {
+        for (WriterFileOutput* out: pendingOutputs) {
+            flushBatch(out);
+            syncFile(out);
+            out->pending = false;
+        }
+        pendingOutputs.clear();
     }
 
-    void WriterFile::closeFile() {
-        if (outputDes != -1) {
-            close(outputDes);
-            outputDes = -1;
+    void WriterFile::closeOutputs() {
+        flushAll();
+
+        // Every compressed file ends with a complete zstd frame
+        for (auto& outputsIt: outputs) {
+            WriterFileOutput* out = outputsIt.second;
+            if (out->outputDes != STDOUT_FILENO)
+                closeFile(out);
         }
     }
 
-    void WriterFile::checkFile(typeScn scn __attribute__((unused)), typeSeq sequence, uint64_t length) {
+    void WriterFile::checkFile(WriterFileOutput* out, typeScn scn __attribute__((unused)), typeSeq sequence, uint64_t length) {
         if (mode == MODE_STDOUT) {
             return;
         } else if (mode == MODE_NO_ROTATE) {
-            fullFileName = pathName + "/" + fileNameMask;
+            out->fullFileName = pathName + "/" + out->prefix;
         } else if (mode == MODE_NUM) {
-            if (fileSize + length > maxFileSize) {
-                closeFile();
-                ++fileNameNum;
-                fileSize = 0;
+            if (out->fileSize + length > maxFileSize) {
+                closeFile(out);
+                ++out->fileNameNum;
+                out->fileSize = 0;
             }
             if (length > maxFileSize)
                 ctx->warning(60029, "message size (" + std::to_string(length) + ") will exceed 'max-file' size (" +
                                     std::to_string(maxFileSize) + ")");
 
-            if (outputDes == -1) {
-                std::string outputFileNumStr(std::to_string(fileNameNum));
+            if (out->outputDes == -1) {
+                std::string outputFileNumStr(std::to_string(out->fileNameNum));
                 uint64_t zeros = 0;
                 if (fill > outputFileNumStr.length())
                     zeros = fill - outputFileNumStr.length();
-                fullFileName = pathName + "/" + fileNameMask.substr(0, prefixPos) + std::string(zeros, '0') + outputFileNumStr +
-                               fileNameMask.substr(suffixPos);
+                out->fullFileName = pathName + "/" + out->prefix + std::string(zeros, '0') + outputFileNumStr + out->suffix;
             }
         } else if (mode == MODE_TIMESTAMP) {
             bool shouldSwitch = false;
-            if (fileSize + length > maxFileSize)
+            if (out->fileSize + length > maxFileSize)
                 shouldSwitch = true;
 
             if (length > maxFileSize)
                 ctx->warning(60029, "message size (" + std::to_string(length) + ") will exceed 'max-file' size (" +
                                     std::to_string(maxFileSize) + ")");
 
-            if (outputDes == -1 || shouldSwitch) {
+            if (out->outputDes == -1 || shouldSwitch) {
                 time_t now = time(nullptr);
                 tm nowTm = *localtime(&now);
                 char str[50];
                 strftime(str, sizeof(str), timestampFormat.c_str(), &nowTm);
-                std::string newOutputFile = pathName + "/" + fileNameMask.substr(0, prefixPos) + str + fileNameMask.substr(suffixPos);
-                if (fullFileName == newOutputFile) {
-                    if (!warningDisplayed) {
+                std::string newOutputFile = pathName + "/" + out->prefix + str + out->suffix;
+                if (out->fullFileName == newOutputFile) {
+                    if (!warningDisplayed && shouldSwitch) {
                         ctx->warning(60030, "rotation size is set too low (" + std::to_string(maxFileSize) +
-                                            "), increase it, should rotate but too early (" + fullFileName + ")");
+                                            "), increase it, should rotate but too early (" + out->fullFileName + ")");
                         warningDisplayed = true;
                     }
                     shouldSwitch = false;
                 } else
-                    fullFileName = newOutputFile;
+                    out->fullFileName = newOutputFile;
             }
 
             if (shouldSwitch) {
-                closeFile();
-                fileSize = 0;
+                closeFile(out);
+                out->fileSize = 0;
             }
         } else if (mode == MODE_SEQUENCE) {
-            if (sequence != lastSequence) {
-                closeFile();
+            if (sequence != out->lastSequence) {
+                closeFile(out);
             }
 
-            lastSequence = sequence;
-            if (outputDes == -1)
-                fullFileName = pathName + "/" + fileNameMask.substr(0, prefixPos) + std::to_string(sequence) +
-                               fileNameMask.substr(suffixPos);
+            out->lastSequence = sequence;
+            if (out->outputDes == -1)
+                out->fullFileName = pathName + "/" + out->prefix + std::to_string(sequence) + out->suffix;
         }
 
         // File is closed, open it
-        if (outputDes == -1) {
-            struct stat fileStat;
-            if (stat(fullFileName.c_str(), &fileStat) == 0) {
-                // File already exists, append?
-                if (append == 0)
-                    throw RuntimeException(10003, "file: " + fullFileName + " - stat returned: " + strerror(errno));
+        if (out->outputDes == -1) {
+            if (openFiles >= maxOpenFiles)
+                evictOutput();
 
-                fileSize = fileStat.st_size;
+            struct stat fileStat;
+            if (stat(out->fullFileName.c_str(), &fileStat) != 0) {
+                out->fileSize = 0;
+            } else if (out->fullFileName == out->evictedFileName) {
+                // Closed by eviction, the last frame is complete and the size counted so far is kept
+            } else if (append == 0) {
+                throw RuntimeException(10003, "file: " + out->fullFileName + " - stat returned: " + strerror(errno));
+            } else if (compression != COMPRESSION_NONE) {
+                // A compressed file of a previous run could end with a truncated frame, it is kept under another name
+                moveAside(out->fullFileName);
+                out->fileSize = 0;
             } else
-                fileSize = 0;
+                out->fileSize = fileStat.st_size;
+
+            ctx->info(0, "opening output file: " + out->fullFileName);
+            out->outputDes = open(out->fullFileName.c_str(), O_CREAT | O_WRONLY, S_IRUSR | S_IWUSR);
 
-            ctx->info(0, "opening output file: " + fullFileName);
-            outputDes = open(fullFileName.c_str(), O_CREAT | O_WRONLY, S_IRUSR | S_IWUSR);
+            if (out->outputDes == -1)
+                throw RuntimeException(10006, "file: " + out->fullFileName + " - open for write returned: " + strerror(errno));
+            ++openFiles;
 
-            if (outputDes == -1)
-                throw RuntimeException(10006, "file: " + fullFileName + " - open for write returned: " + strerror(errno));
+            if (lseek(out->outputDes, 0, SEEK_END) == -1)
+                throw RuntimeException(10011, "file: " + out->fullFileName + " - seek returned: " + strerror(errno));
 
-            if (lseek(outputDes, 0, SEEK_END) == -1)
-                throw RuntimeException(10011, "file: " + fullFileName + " - seek returned: " + strerror(errno));
+            if (compression != COMPRESSION_NONE) {
+#ifdef LINK_LIBRARY_ZSTD
+                out->cctx = ZSTD_createCCtx();
+                if (out->cctx == nullptr)
+                    throw RuntimeException(10074, "file: " + out->fullFileName + " - zstd compression context creation failed");
+#endif /* LINK_LIBRARY_ZSTD */
+
+                std::string indexFileName(out->fullFileName + ".idx");
+                out->indexDes = open(indexFileName.c_str(), O_CREAT | O_WRONLY | O_APPEND, S_IRUSR | S_IWUSR);
+                if (out->indexDes == -1)
+                    throw RuntimeException(10006, "file: " + indexFileName + " - open for write returned: " + strerror(errno));
+            }
         }
     }
 
+    void WriterFile::moveAside(const std::string& fileName) {
+        struct stat fileStat;
+        uint64_t num = 1;
+        while (stat((fileName + "." + std::to_string(num)).c_str(), &fileStat) == 0 ||
+               stat((fileName + "." + std::to_string(num) + ".idx").c_str(), &fileStat) == 0)
+            ++num;
+
+        std::string newFileName(fileName + "." + std::to_string(num));
+        ctx->info(0, "moving compressed output file of previous run: " + fileName + " to: " + newFileName);
+        if (rename(fileName.c_str(), newFileName.c_str()) != 0)
+            throw RuntimeException(10076, "file: " + fileName + " - rename returned: " + strerror(errno));
+        if (stat((fileName + ".idx").c_str(), &fileStat) == 0 &&
+                rename((fileName + ".idx").c_str(), (newFileName + ".idx").c_str()) != 0)
+            throw RuntimeException(10076, "file: " + fileName + ".idx - rename returned: " + strerror(errno));
+    }
+
     void WriterFile::sendMessage(BuilderMsg* msg) {
+        WriterFileOutput* out = resolveOutput(msg);
         if (newLine > 0)
-            checkFile(msg->scn, msg->sequence, msg->length + 1);
+            checkFile(out, msg->scn, msg->sequence, msg->length + 1);
         else
-            checkFile(msg->scn, msg->sequence, msg->length);
-
-        int64_t bytesWritten = write(outputDes, reinterpret_cast<const char*>(msg->data), msg->length);
-        if (static_cast<uint64_t>(bytesWritten) != msg->length)
-            throw RuntimeException(10007, "file: " + fullFileName + " - " + std::to_string(bytesWritten) + " bytes written instead of " +
-                                          std::to_string(msg->length) + ", code returned: " + strerror(errno));
-
-        fileSize += bytesWritten;
-
-        if (newLine > 0) {
-            bytesWritten = write(outputDes, newLineMsg, newLine);
-            if (static_cast<uint64_t>(bytesWritten) != newLine)
-                throw RuntimeException(10007, "file: " + fullFileName + " - " + std::to_string(bytesWritten) + " bytes written instead of " +
-                                              std::to_string(msg->length) + ", code returned: " + strerror(errno));
-            fileSize += bytesWritten;
+            checkFile(out, msg->scn, msg->sequence, msg->length);
+        out->lastUsed = ++useCounter;
+
+        // Many messages and new lines are written with one call, a split message directly from the output buffers
+        if (out->batchMsgs.empty())
+            out->batchTime = ctx->clock->getTimeUt();
+        uint64_t partsCount = out->batchParts.size();
+        if ((msg->flags & Builder::OUTPUT_BUFFER_MESSAGE_SPLIT) != 0)
+            out->batchParts.insert(out->batchParts.end(), msgParts.begin(), msgParts.begin() + static_cast<int64_t>(msgPayloadParts));
+        else
+            out->batchParts.push_back({msg->data, msg->length});
+        if (newLine > 0)
+            out->batchParts.push_back({const_cast<char*>(newLineMsg), newLine});
+        out->batchMsgs.push_back(msg);
+        out->batchMsgParts.push_back(out->batchParts.size() - partsCount);
+        out->batchBytes += msg->length + newLine;
+        out->fileSize += msg->length + newLine;
+
+        if (!out->pending) {
+            out->pending = true;
+            pendingOutputs.push_back(out);
         }
 
-        confirmMessage(msg);
+        if (out->batchBytes >= BATCH_MAX_BYTES || out->batchParts.size() >= IOV_MAX)
+            flushBatch(out);
     }
 
     std::string WriterFile::getName() const {
-        if (outputDes == STDOUT_FILENO)
+        if (mode == MODE_STDOUT)
             return "stdout";
         else
             return "file:" + pathName + "/" + fileNameMask;
     }
 
     void WriterFile::pollQueue() {
-        if (metadata->status == Metadata::STATUS_READY)
+        if (metadata->status == Metadata::STATUS_READY && metadata->allWritersStarted())
             metadata->setStatusStart();
+
+        if (pendingOutputs.empty())
+            return;
+
+        // No more messages can be sent until some are confirmed
+        if (currentQueueSize >= ctx->queueSize) {
+            flushAll();
+            return;
+        }
+
+        time_ut now = ctx->clock->getTimeUt();
+        uint64_t pending = 0;
+        for (WriterFileOutput* out: pendingOutputs) {
+            if (!out->batchMsgs.empty() && static_cast<uint64_t>(now - out->batchTime) >= ctx->pollIntervalUs)
+                flushBatch(out);
+
+            if (!out->unsyncedMsgs.empty() && ((syncSizeMb > 0 && out->unsyncedBytes >= syncSizeMb * 1024 * 1024) ||
+                                               (syncMode == SYNC_MODE_PERIODIC &&
+                                                static_cast<uint64_t>(now - out->unsyncedTime) >= syncIntervalMs * 1000)))
+                syncFile(out);
+
+            // Only outputs with messages not confirmed yet are checked
+            if (out->batchMsgs.empty() && out->unsyncedMsgs.empty())
+                out->pending = false;
+            else
+                pendingOutputs[pending++] = out;
+        }
+        pendingOutputs.resize(pending);
+    }
+
+    void WriterFile::writeCheckpoint(bool force) {
+        // Synchronize the files before the checkpoint, the checkpoint contains only messages on disk
+        time_t now = time(nullptr);
+        if (force || static_cast<uint64_t>(now - checkpointTime) >= ctx->checkpointIntervalS) {
+            if (!ctx->hardShutdown)
+                flushAll();
+        }
+
+        Writer::writeCheckpoint(force);
     }
 }
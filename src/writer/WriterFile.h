@@ -17,12 +17,51 @@ You should have received a copy of the GNU General Public License
 along with OpenLogReplicator; see the file LICENSE;  If not see
 <http://www.gnu.org/licenses/>.  */
 
+#include <unordered_map>
+#include <vector>
+
+#ifdef LINK_LIBRARY_ZSTD
+#include <zstd.h>
+#endif /* LINK_LIBRARY_ZSTD */
+
 #include "Writer.h"
 
 #ifndef WRITER_FILE_H_
 #define WRITER_FILE_H_
 
 namespace OpenLogReplicator {
+    // Output file of one table, or of all messages when the output is not partitioned
+    struct WriterFileOutput {
+        std::string tag;
+        std::string prefix;
+        std::string suffix;
+        std::string fullFileName;
+        std::string evictedFileName;
+        uint64_t fileNameNum;
+        uint64_t fileSize;
+        typeSeq lastSequence;
+        int outputDes;
+        uint64_t lastUsed;
+        bool pending;
+        // Messages waiting to be written with one call
+        std::vector<struct iovec> batchParts;
+        std::vector<BuilderMsg*> batchMsgs;
+        std::vector<uint64_t> batchMsgParts;
+        uint64_t batchBytes;
+        time_ut batchTime;
+        // Messages written, but confirmed only after the file is synchronized
+        std::vector<BuilderMsg*> unsyncedMsgs;
+        uint64_t unsyncedBytes;
+        time_ut unsyncedTime;
+        // Compressed output: frames are cut at message boundaries, the first message of every frame is listed in the index file
+        uint64_t frameBytes;
+        bool frameOpen;
+        int indexDes;
+#ifdef LINK_LIBRARY_ZSTD
+        ZSTD_CCtx* cctx;
+#endif /* LINK_LIBRARY_ZSTD */
+    };
+
     class WriterFile final : public Writer {
     protected:
         static constexpr uint64_t MODE_STDOUT = 0;
@@ -30,6 +69,7 @@ namespace OpenLogReplicator {
         static constexpr uint64_t MODE_NUM = 2;
         static constexpr uint64_t MODE_TIMESTAMP = 3;
         static constexpr uint64_t MODE_SEQUENCE = 4;
+        static constexpr uint64_t BATCH_MAX_BYTES = 1024 * 1024;
 
         size_t prefixPos;
         size_t suffixPos;
@@ -37,27 +77,65 @@ namespace OpenLogReplicator {
         uint64_t fill;
         std::string output;
         std::string pathName;
-        std::string fullFileName;
         std::string fileNameMask;
         std::string timestampFormat;
-        uint64_t fileNameNum;
-        uint64_t fileSize;
         uint64_t maxFileSize;
-        int outputDes;
         uint64_t newLine;
         uint64_t append;
-        typeSeq lastSequence;
         const char* newLineMsg;
         bool warningDisplayed;
-        void closeFile();
-        void checkFile(typeScn scn, typeSeq sequence, uint64_t length);
+        uint64_t syncMode;
+        uint64_t syncIntervalMs;
+        uint64_t syncSizeMb;
+        uint64_t compression;
+        uint64_t frameSizeMb;
+#ifdef LINK_LIBRARY_ZSTD
+        std::vector<uint8_t> compressBuffer;
+#endif /* LINK_LIBRARY_ZSTD */
+        // Output partitioned by table: files are opened on demand, the least recently used is closed above the limit
+        bool partitioned;
+        uint64_t maxOpenFiles;
+        uint64_t openFiles;
+        uint64_t useCounter;
+        WriterFileOutput* defaultOutput;
+        std::unordered_map<std::string, WriterFileOutput*> outputs;
+        std::unordered_map<typeObj, WriterFileOutput*> objOutputs;
+        std::vector<WriterFileOutput*> pendingOutputs;
+
+#ifdef LINK_LIBRARY_ZSTD
+        void compressParts(WriterFileOutput* out, const struct iovec* parts, uint64_t count);
+        void compressEnd(WriterFileOutput* out, ZSTD_EndDirective endMode);
+#endif /* LINK_LIBRARY_ZSTD */
+
+        WriterFileOutput* createOutput(const std::string& tag);
+        WriterFileOutput* resolveOutput(const BuilderMsg* msg);
+        std::string expandMask(const std::string& mask, const std::string& tag) const;
+        uint64_t findFileNum(const std::string& prefix, const std::string& suffix);
+        void evictOutput();
+        void closeFile(WriterFileOutput* out);
+        void moveAside(const std::string& fileName);
+        void writeParts(WriterFileOutput* out, const struct iovec* parts, uint64_t count, uint64_t length);
+        void writeIndex(WriterFileOutput* out, const BuilderMsg* msg);
+        void flushBatch(WriterFileOutput* out);
+        void syncFile(WriterFileOutput* out);
+        void flushAll();
+        void checkFile(WriterFileOutput* out, typeScn scn, typeSeq sequence, uint64_t length);
         void sendMessage(BuilderMsg* msg) override;
         std::string getName() const override;
         void pollQueue() override;
+        void writeCheckpoint(bool force) override;
+        void closeOutputs() override;
 
     public:
+        static constexpr uint64_t SYNC_MODE_NONE = 0;
+        static constexpr uint64_t SYNC_MODE_PERIODIC = 1;
+        static constexpr uint64_t SYNC_MODE_CHECKPOINT = 2;
+        static constexpr uint64_t COMPRESSION_NONE = 0;
+        static constexpr uint64_t COMPRESSION_ZSTD = 1;
+
         WriterFile(Ctx* newCtx, const std::string& newAlias, const std::string& newDatabase, Builder* newBuilder, Metadata* newMetadata, const char* newOutput,
-                   const char* newTimestampFormat, uint64_t newMaxFileSize, uint64_t newNewLine, uint64_t newAppend);
+                   const char* newTimestampFormat, uint64_t newMaxFileSize, uint64_t newNewLine, uint64_t newAppend, uint64_t newSyncMode,
+                   uint64_t newSyncIntervalMs, uint64_t newSyncSizeMb, uint64_t newCompression, uint64_t newFrameSizeMb, uint64_t newMaxOpenFiles);
         ~WriterFile() override;
 
         void initialize() override;
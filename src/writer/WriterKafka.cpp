@@ -17,6 +17,10 @@ You should have received a copy of the GNU General Public License
 along with OpenLogReplicator; see the file LICENSE;  If not see
 <http://www.gnu.org/licenses/>.  */
 
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
 #include "../builder/Builder.h"
 #include "../common/exception/ConfigurationException.h"
 #include "../common/exception/RuntimeException.h"
@@ -25,9 +29,23 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 
 namespace OpenLogReplicator {
     WriterKafka::WriterKafka(Ctx* newCtx, const std::string& newAlias, const std::string& newDatabase, Builder* newBuilder, Metadata* newMetadata,
-                             const char* newTopic) :
+                             const char* newTopic, const char* newTopicTemplate, uint64_t newKeyFormat,
+                             const char* newCheckpointTopic) :
             Writer(newCtx, newAlias, newDatabase, newBuilder, newMetadata),
             topic(newTopic),
+            topicTemplate(newTopicTemplate),
+            keyFormat(newKeyFormat),
+            checkpointTopic(newCheckpointTopic),
+            transactional(false),
+            transactionOpen(false),
+            transactionTime(0),
+            transactionMaxS(0),
+            transactionTimeoutMs(TRANSACTION_TIMEOUT_MS),
+            deliveryRing(nullptr),
+            deliveryBatch(nullptr),
+            deliveryMask(0),
+            deliveryHead(0),
+            deliveryTail(0),
             rk(nullptr),
             rkt(nullptr),
             conf(nullptr) {
@@ -46,6 +64,16 @@ namespace OpenLogReplicator {
             rd_kafka_destroy(rk);
 
         ctx->info(0, "Kafka producer exit code: " + std::to_string(err));
+
+        if (deliveryRing != nullptr) {
+            delete[] deliveryRing;
+            deliveryRing = nullptr;
+        }
+
+        if (deliveryBatch != nullptr) {
+            delete[] deliveryBatch;
+            deliveryBatch = nullptr;
+        }
     }
 
     void WriterKafka::addProperty(const std::string& key, const std::string& value) {
@@ -60,6 +88,14 @@ namespace OpenLogReplicator {
         if (properties.find("message.max.bytes") != properties.end())
             throw ConfigurationException(30010, "Kafka property 'message.max.bytes' is defined, but it is not allowed to be set by user");
 
+        // No more messages than the queue size can wait for delivery, so the ring never overflows
+        uint64_t deliverySize = 1;
+        while (deliverySize < ctx->queueSize)
+            deliverySize <<= 1;
+        deliveryMask = deliverySize - 1;
+        deliveryRing = new BuilderMsg* [deliverySize];
+        deliveryBatch = new BuilderMsg* [deliverySize];
+
         conf = rd_kafka_conf_new();
         if (conf == nullptr)
             throw RuntimeException(10058, "Kafka failed to create configuration");
@@ -73,6 +109,23 @@ namespace OpenLogReplicator {
         if (properties.find("group.id") != properties.end())
             properties.insert_or_assign("group.id", "OpenLogReplicator");
 
+        transactional = (properties.find("transactional.id") != properties.end());
+        if (!transactional && !checkpointTopic.empty())
+            throw ConfigurationException(30011, "Kafka parameter 'checkpoint-topic' requires property 'transactional.id'");
+
+        // The transaction is committed before the broker would abort it
+        if (transactional) {
+            auto propertiesIt = properties.find("transaction.timeout.ms");
+            if (propertiesIt != properties.end()) {
+                uint64_t timeoutMs = strtoull(propertiesIt->second.c_str(), nullptr, 10);
+                if (timeoutMs > 0 && timeoutMs <= INT_MAX)
+                    transactionTimeoutMs = static_cast<int>(timeoutMs);
+            }
+            transactionMaxS = static_cast<uint64_t>(transactionTimeoutMs) / 2000;
+            if (transactionMaxS == 0)
+                transactionMaxS = 1;
+        }
+
         for (auto& property: properties)
             if (rd_kafka_conf_set(conf, property.first.c_str(), property.second.c_str(), errStr, sizeof(errStr)) != RD_KAFKA_CONF_OK)
                 throw RuntimeException(10059, "Kafka message: " + std::string(errStr));
@@ -87,20 +140,53 @@ namespace OpenLogReplicator {
             throw RuntimeException(10060, "Kafka failed to create producer, message: " + std::string(errStr));
         conf = nullptr;
 
+        if (transactional) {
+            rd_kafka_error_t* error = rd_kafka_init_transactions(rk, transactionTimeoutMs);
+            if (error != nullptr)
+                transactionError(error, "init");
+        }
+
         rkt = rd_kafka_topic_new(rk, topic.c_str(), nullptr);
         streaming = true;
+
+        // Table name and primary key are passed by the builder after the message data
+        if (!topicTemplate.empty() || keyFormat != KEY_FORMAT_NONE)
+            builder->setMessageTags(true);
     }
 
     void WriterKafka::dr_msg_cb(rd_kafka_t* rkCb __attribute__((unused)), const rd_kafka_message_t* rkMessage, void* opaque __attribute__((unused))) {
         auto msg = reinterpret_cast<BuilderMsg*>(rkMessage->_private);
-        auto writer = reinterpret_cast<Writer*>(opaque);
+        auto writer = reinterpret_cast<WriterKafka*>(opaque);
+        // Checkpoint record of a transaction
+        if (msg == nullptr) {
+            if (rkMessage->err)
+                writer->ctx->warning(70008, "Kafka: checkpoint delivery failed: " + std::string(rd_kafka_err2str(rkMessage->err)));
+            return;
+        }
+
         if (rkMessage->err) {
             writer->ctx->warning(70008, "Kafka: " + std::to_string(msg->id) + " delivery failed: " + rd_kafka_err2str(rkMessage->err));
         } else {
-            writer->confirmMessage(msg);
+            uint64_t head = writer->deliveryHead.load(std::memory_order_relaxed);
+            writer->deliveryRing[head & writer->deliveryMask] = msg;
+            writer->deliveryHead.store(head + 1, std::memory_order_release);
         }
     }
 
+    void WriterKafka::confirmDelivered() {
+        uint64_t tail = deliveryTail.load(std::memory_order_relaxed);
+        uint64_t head = deliveryHead.load(std::memory_order_acquire);
+        if (tail == head)
+            return;
+
+        uint64_t count = 0;
+        for (; tail != head; ++tail)
+            deliveryBatch[count++] = deliveryRing[tail & deliveryMask];
+        deliveryTail.store(tail, std::memory_order_release);
+
+        confirmMessages(deliveryBatch, count);
+    }
+
     void WriterKafka::error_cb(rd_kafka_t* rkCb, int err, const char* reason, void* opaque) {
         auto writer = reinterpret_cast<Writer*>(opaque);
 
@@ -124,15 +210,136 @@ namespace OpenLogReplicator {
                                                      ", fac: " + fac + ", err: " + buf);
     }
 
+    void WriterKafka::beginTransaction() {
+        rd_kafka_error_t* error = rd_kafka_begin_transaction(rk);
+        if (error != nullptr)
+            transactionError(error, "begin");
+        transactionOpen = true;
+        transactionTime = time(nullptr);
+    }
+
+    void WriterKafka::commitTransaction() {
+        // Every message of the transaction must be delivered to know the position to commit
+        rd_kafka_resp_err_t err = rd_kafka_flush(rk, transactionTimeoutMs);
+        if (err)
+            throw RuntimeException(10072, "Kafka transaction failed, operation: flush, message: " + std::string(rd_kafka_err2str(err)));
+        confirmDelivered();
+
+        if (!checkpointTopic.empty()) {
+            std::ostringstream ss;
+            checkpointDocument(ss);
+            std::string checkpoint(ss.str());
+            err = rd_kafka_producev(rk, RD_KAFKA_V_TOPIC(checkpointTopic.c_str()), RD_KAFKA_V_KEY(checkpointName.c_str(), checkpointName.length()),
+                                    RD_KAFKA_V_VALUE(const_cast<char*>(checkpoint.c_str()), checkpoint.length()),
+                                    RD_KAFKA_V_MSGFLAGS(RD_KAFKA_MSG_F_COPY), RD_KAFKA_V_OPAQUE(nullptr), RD_KAFKA_V_END);
+            if (err)
+                throw RuntimeException(10072, "Kafka transaction failed, operation: checkpoint, message: " + std::string(rd_kafka_err2str(err)));
+        }
+
+        for (;;) {
+            rd_kafka_error_t* error = rd_kafka_commit_transaction(rk, transactionTimeoutMs);
+            if (error == nullptr)
+                break;
+
+            if (rd_kafka_error_is_retriable(error) && !ctx->hardShutdown) {
+                ctx->warning(60038, "Kafka transaction commit failed, retrying, message: " + std::string(rd_kafka_error_string(error)));
+                rd_kafka_error_destroy(error);
+                continue;
+            }
+
+            // Messages of an aborted transaction are never visible, they are sent again after restart from the checkpoint
+            if (rd_kafka_error_txn_requires_abort(error)) {
+                rd_kafka_error_t* abortError = rd_kafka_abort_transaction(rk, transactionTimeoutMs);
+                if (abortError != nullptr)
+                    rd_kafka_error_destroy(abortError);
+            }
+            transactionError(error, "commit");
+        }
+        transactionOpen = false;
+
+        if (ctx->trace & Ctx::TRACE_CHECKPOINT)
+            ctx->logTrace(Ctx::TRACE_CHECKPOINT, "Kafka transaction committed, scn: " + std::to_string(confirmedScn) + " idx: " +
+                                                 std::to_string(confirmedIdx));
+    }
+
+    void WriterKafka::transactionError(rd_kafka_error_t* error, const std::string& operation) {
+        std::string message(rd_kafka_error_string(error));
+        rd_kafka_error_destroy(error);
+        throw RuntimeException(10072, "Kafka transaction failed, operation: " + operation + ", message: " + message);
+    }
+
+    const std::string& WriterKafka::resolveTopic(typeObj obj, const char* tableTag, uint64_t tableTagLength) {
+        auto topicsIt = topics.find(obj);
+        if (topicsIt != topics.end() && topicsIt->second.first.compare(0, std::string::npos, tableTag, tableTagLength) == 0)
+            return topicsIt->second.second;
+
+        // First message for the table or the table was renamed
+        const char* owner = tableTag;
+        const char* table = tableTag + strlen(owner) + 1;
+        std::string topicName;
+        for (uint64_t i = 0; i < topicTemplate.length(); ++i) {
+            const char* value = nullptr;
+            if (topicTemplate.compare(i, sizeof("{owner}") - 1, "{owner}") == 0) {
+                value = owner;
+                i += sizeof("{owner}") - 2;
+            } else if (topicTemplate.compare(i, sizeof("{table}") - 1, "{table}") == 0) {
+                value = table;
+                i += sizeof("{table}") - 2;
+            } else {
+                topicName.push_back(topicTemplate[i]);
+                continue;
+            }
+
+            // Characters not allowed in Kafka topic names
+            for (; *value != 0; ++value) {
+                if ((*value >= 'a' && *value <= 'z') || (*value >= 'A' && *value <= 'Z') || (*value >= '0' && *value <= '9') ||
+                    *value == '.' || *value == '_' || *value == '-')
+                    topicName.push_back(*value);
+                else
+                    topicName.push_back('_');
+            }
+        }
+
+        if (ctx->trace & Ctx::TRACE_WRITER)
+            ctx->logTrace(Ctx::TRACE_WRITER, "table " + std::string(owner) + "." + table + " is sent to topic: " + topicName);
+
+        auto& entry = topics[obj];
+        entry.first.assign(tableTag, tableTagLength);
+        entry.second = topicName;
+        return entry.second;
+    }
+
     void WriterKafka::sendMessage(BuilderMsg* msg) {
         msg->ptr = reinterpret_cast<void*>(this);
+        // Kafka needs the payload in one buffer
+        if ((msg->flags & Builder::OUTPUT_BUFFER_MESSAGE_SPLIT) != 0)
+            flattenMessage(msg);
+        if (transactional && !transactionOpen)
+            beginTransaction();
+
+        const char* topicName = topic.c_str();
+        const uint8_t* key = nullptr;
+        uint64_t keyLength = 0;
+        if (msg->tagLength > 0) {
+            const char* tag = reinterpret_cast<const char*>(msg->data + msg->length);
+            uint64_t ownerLength = strnlen(tag, msg->tagLength);
+            uint64_t tableTagLength = ownerLength + 1 + strnlen(tag + ownerLength + 1, msg->tagLength - ownerLength - 1) + 1;
+
+            if (!topicTemplate.empty())
+                topicName = resolveTopic(msg->obj, tag, tableTagLength).c_str();
+            if (keyFormat == KEY_FORMAT_PK && msg->tagLength > tableTagLength) {
+                key = msg->data + msg->length + tableTagLength;
+                keyLength = msg->tagLength - tableTagLength;
+            }
+        }
+
         for (;;) {
-            rd_kafka_resp_err_t err = rd_kafka_producev(rk, RD_KAFKA_V_TOPIC(topic.c_str()), RD_KAFKA_V_VALUE(msg->data, msg->length),
-                                                        RD_KAFKA_V_OPAQUE(msg), RD_KAFKA_V_END);
+            rd_kafka_resp_err_t err = rd_kafka_producev(rk, RD_KAFKA_V_TOPIC(topicName), RD_KAFKA_V_KEY(key, keyLength),
+                                                        RD_KAFKA_V_VALUE(msg->data, msg->length), RD_KAFKA_V_OPAQUE(msg), RD_KAFKA_V_END);
             // rd_kafka_resp_err_t err = (rd_kafka_resp_err_t)rd_kafka_produce(rkt, RD_KAFKA_PARTITION_UA, 0, msg->decoder, msg->length, nullptr, 0, msg);
 
             if (err) {
-                ctx->warning(60031, "failed to produce to topic " + topic + ", message: " + rd_kafka_err2str(err));
+                ctx->warning(60031, "failed to produce to topic " + std::string(topicName) + ", message: " + rd_kafka_err2str(err));
 
                 if (err == RD_KAFKA_RESP_ERR__QUEUE_FULL) {
                     ctx->warning(60031, "queue, full, sleeping " + std::to_string(ctx->pollIntervalUs / 1000) + " ms, then retrying");
@@ -152,10 +359,133 @@ namespace OpenLogReplicator {
     }
 
     void WriterKafka::pollQueue() {
-        if (metadata->status == Metadata::STATUS_READY)
+        if (metadata->status == Metadata::STATUS_READY && metadata->allWritersStarted())
             metadata->setStatusStart();
 
-        if (currentQueueSize > 0)
+        if (currentQueueSize > 0) {
             rd_kafka_poll(rk, 0);
+            confirmDelivered();
+        }
+    }
+
+    bool WriterKafka::readCheckpointExternal(std::string& checkpoint) {
+        if (checkpointTopic.empty())
+            return false;
+
+        // Only committed checkpoint records are read, the last one with the key of this writer wins
+        rd_kafka_conf_t* consumerConf = rd_kafka_conf_new();
+        if (consumerConf == nullptr)
+            throw RuntimeException(10058, "Kafka failed to create configuration");
+
+        for (auto& property: properties) {
+            // Producer only properties
+            if (property.first == "transactional.id" || property.first == "transaction.timeout.ms")
+                continue;
+            if (rd_kafka_conf_set(consumerConf, property.first.c_str(), property.second.c_str(), errStr, sizeof(errStr)) != RD_KAFKA_CONF_OK) {
+                rd_kafka_conf_destroy(consumerConf);
+                throw RuntimeException(10059, "Kafka message: " + std::string(errStr));
+            }
+        }
+        if (properties.find("group.id") == properties.end())
+            rd_kafka_conf_set(consumerConf, "group.id", "OpenLogReplicator", errStr, sizeof(errStr));
+        rd_kafka_conf_set(consumerConf, "isolation.level", "read_committed", errStr, sizeof(errStr));
+        rd_kafka_conf_set(consumerConf, "enable.auto.commit", "false", errStr, sizeof(errStr));
+        rd_kafka_conf_set(consumerConf, "enable.partition.eof", "true", errStr, sizeof(errStr));
+        rd_kafka_conf_set_opaque(consumerConf, this);
+        rd_kafka_conf_set_error_cb(consumerConf, error_cb);
+        rd_kafka_conf_set_log_cb(consumerConf, logger_cb);
+
+        rd_kafka_t* rkc = rd_kafka_new(RD_KAFKA_CONSUMER, consumerConf, errStr, sizeof(errStr));
+        if (rkc == nullptr) {
+            rd_kafka_conf_destroy(consumerConf);
+            throw RuntimeException(10060, "Kafka failed to create consumer, message: " + std::string(errStr));
+        }
+
+        rd_kafka_topic_t* rktc = rd_kafka_topic_new(rkc, checkpointTopic.c_str(), nullptr);
+        rd_kafka_topic_partition_list_t* partitions = rd_kafka_topic_partition_list_new(1);
+        std::string error;
+        bool found = false;
+        uint64_t partitionsLeft = 0;
+
+        const rd_kafka_metadata_t* topicMetadata = nullptr;
+        rd_kafka_resp_err_t err = rd_kafka_metadata(rkc, 0, rktc, &topicMetadata, CHECKPOINT_READ_TIMEOUT_MS);
+        if (err) {
+            error = "metadata: " + std::string(rd_kafka_err2str(err));
+        } else if (topicMetadata->topic_cnt == 1 && topicMetadata->topics[0].err == RD_KAFKA_RESP_ERR_NO_ERROR) {
+            // Empty partitions never report the end
+            for (int i = 0; i < topicMetadata->topics[0].partition_cnt; ++i) {
+                int32_t partition = topicMetadata->topics[0].partitions[i].id;
+                int64_t low;
+                int64_t high;
+                err = rd_kafka_query_watermark_offsets(rkc, checkpointTopic.c_str(), partition, &low, &high, CHECKPOINT_READ_TIMEOUT_MS);
+                if (err) {
+                    error = "offsets: " + std::string(rd_kafka_err2str(err));
+                    break;
+                }
+                if (low >= high)
+                    continue;
+
+                rd_kafka_topic_partition_list_add(partitions, checkpointTopic.c_str(), partition)->offset = low;
+                ++partitionsLeft;
+            }
+        }
+        if (topicMetadata != nullptr)
+            rd_kafka_metadata_destroy(topicMetadata);
+
+        if (error.empty() && partitionsLeft > 0) {
+            err = rd_kafka_assign(rkc, partitions);
+            if (err)
+                error = "assign: " + std::string(rd_kafka_err2str(err));
+        }
+
+        while (error.empty() && partitionsLeft > 0 && !ctx->hardShutdown) {
+            rd_kafka_message_t* rkMessage = rd_kafka_consumer_poll(rkc, CHECKPOINT_READ_TIMEOUT_MS);
+            if (rkMessage == nullptr) {
+                error = "read: timeout";
+                break;
+            }
+
+            if (rkMessage->err == RD_KAFKA_RESP_ERR__PARTITION_EOF) {
+                --partitionsLeft;
+            } else if (rkMessage->err) {
+                error = "read: " + std::string(rd_kafka_message_errstr(rkMessage));
+            } else if (rkMessage->key_len == checkpointName.length() &&
+                       memcmp(rkMessage->key, checkpointName.c_str(), checkpointName.length()) == 0) {
+                checkpoint.assign(reinterpret_cast<const char*>(rkMessage->payload), rkMessage->len);
+                found = true;
+            }
+            rd_kafka_message_destroy(rkMessage);
+        }
+
+        rd_kafka_topic_partition_list_destroy(partitions);
+        rd_kafka_topic_destroy(rktc);
+        rd_kafka_consumer_close(rkc);
+        rd_kafka_destroy(rkc);
+
+        if (!error.empty())
+            throw RuntimeException(10075, "Kafka failed to read checkpoint topic: " + checkpointTopic + ", operation: " + error);
+
+        if (found)
+            ctx->info(0, "Kafka checkpoint read from topic: " + checkpointTopic);
+        return found;
+    }
+
+    void WriterKafka::writeCheckpoint(bool force) {
+        // Commit the Kafka transaction first, the local checkpoint follows the committed position
+        if (transactionOpen) {
+            // Not committed transaction is aborted by the broker
+            if (ctx->hardShutdown)
+                return;
+
+            time_t now = time(nullptr);
+            if (static_cast<uint64_t>(now - checkpointTime) < ctx->checkpointIntervalS &&
+                static_cast<uint64_t>(now - transactionTime) < transactionMaxS && !force)
+                return;
+
+            commitTransaction();
+            force = true;
+        }
+
+        Writer::writeCheckpoint(force);
     }
 }
@@ -19,7 +19,10 @@ along with OpenLogReplicator; see the file LICENSE;  If not see
 
 #include <librdkafka/rdkafka.h>
 
+#include <atomic>
 #include <map>
+#include <unordered_map>
+#include <utility>
 #include "Writer.h"
 
 #ifndef WRITER_KAFKA_H_
@@ -29,8 +32,26 @@ namespace OpenLogReplicator {
     class WriterKafka final : public Writer {
     protected:
         std::string topic;
+        std::string topicTemplate;
+        uint64_t keyFormat;
+        // Topic resolved from the template, by table object: owner '\0' table '\0' -> topic
+        std::unordered_map<typeObj, std::pair<std::string, std::string>> topics;
+        // Transactional producer: output is committed together with the checkpoint
+        std::string checkpointTopic;
+        bool transactional;
+        bool transactionOpen;
+        time_t transactionTime;
+        uint64_t transactionMaxS;
+        // Value of property transaction.timeout.ms, also the limit of every blocking transaction call
+        int transactionTimeoutMs;
         char errStr[512];
         std::map<std::string, std::string> properties;
+        // Delivery reports are queued by the callback and confirmed in batches by pollQueue()
+        BuilderMsg** deliveryRing;
+        BuilderMsg** deliveryBatch;
+        uint64_t deliveryMask;
+        std::atomic<uint64_t> deliveryHead;
+        std::atomic<uint64_t> deliveryTail;
         rd_kafka_t* rk;
         rd_kafka_topic_t* rkt;
         rd_kafka_conf_t* conf;
@@ -38,15 +59,28 @@ namespace OpenLogReplicator {
         static void error_cb(rd_kafka_t* rkCb, int err, const char* reason, void* opaque);
         static void logger_cb(const rd_kafka_t* rkCb, int level, const char* fac, const char* buf);
 
+        void confirmDelivered();
+        void beginTransaction();
+        void commitTransaction();
+        void transactionError(rd_kafka_error_t* error, const std::string& operation);
+        const std::string& resolveTopic(typeObj obj, const char* tableTag, uint64_t tableTagLength);
         void sendMessage(BuilderMsg* msg) override;
         std::string getName() const override;
         void pollQueue() override;
+        void writeCheckpoint(bool force) override;
+        bool readCheckpointExternal(std::string& checkpoint) override;
 
     public:
         static constexpr uint64_t MAX_KAFKA_MESSAGE_MB = 953;
 
+        static constexpr uint64_t KEY_FORMAT_NONE = 0;
+        static constexpr uint64_t KEY_FORMAT_PK = 1;
+        static constexpr int TRANSACTION_TIMEOUT_MS = 60000;
+        static constexpr int CHECKPOINT_READ_TIMEOUT_MS = 10000;
+
         WriterKafka(Ctx* newCtx, const std::string& newAlias, const std::string& newDatabase, Builder* newBuilder, Metadata* newMetadata,
-                    const char* newTopic);
+                    const char* newTopic, const char* newTopicTemplate, uint64_t newKeyFormat,
+                    const char* newCheckpointTopic);
         ~WriterKafka() override;
 
         void addProperty(const std::string& key, const std::string& value);
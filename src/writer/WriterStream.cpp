@@ -33,6 +33,7 @@ namespace OpenLogReplicator {
     }
 
     WriterStream::~WriterStream() {
+        builder->setWakeUpFD(-1);
         if (stream != nullptr) {
             delete stream;
             stream = nullptr;
@@ -43,6 +44,7 @@ namespace OpenLogReplicator {
         Writer::initialize();
 
         stream->initializeServer();
+        builder->setWakeUpFD(stream->getWakeUpFD());
     }
 
     std::string WriterStream::getName() const {
@@ -173,6 +175,8 @@ namespace OpenLogReplicator {
             paramIdx = ", idx: " + std::to_string(metadata->clientIdx);
         }
         ctx->info(0, "client requested scn: " + std::to_string(metadata->clientScn) + paramIdx);
+        clientScn = metadata->clientScn;
+        clientIdx = metadata->clientIdx;
 
         resetMessageQueue();
         response.set_code(pb::ResponseCode::REPLICATE);
@@ -186,8 +190,9 @@ namespace OpenLogReplicator {
             return;
         }
 
-        while (currentQueueSize > 0 && (queue[0]->lwnScn < request.c_scn() || (queue[0]->lwnScn == request.c_scn() && queue[0]->lwnIdx <= request.c_idx())))
-            confirmMessage(queue[0]);
+        while (currentQueueSize > 0 && (firstMessage()->lwnScn < request.c_scn() ||
+                                        (firstMessage()->lwnScn == request.c_scn() && firstMessage()->lwnIdx <= request.c_idx())))
+            confirmMessage(firstMessage());
     }
 
     void WriterStream::pollQueue() {
@@ -198,9 +203,9 @@ namespace OpenLogReplicator {
         uint8_t msgR[Stream::READ_NETWORK_BUFFER];
         std::string msgS;
 
-        uint64_t length = stream->receiveMessageNB(msgR, Stream::READ_NETWORK_BUFFER);
-
-        if (length > 0) {
+        // All requests received so far are processed at once
+        uint64_t length;
+        while ((length = stream->receiveMessageNB(msgR, Stream::READ_NETWORK_BUFFER)) > 0) {
             request.Clear();
             if (request.ParseFromArray(msgR, static_cast<int>(length))) {
                 if (streaming) {
@@ -260,11 +265,28 @@ namespace OpenLogReplicator {
                     ss << std::hex << std::setw(2) << std::setfill('0') << static_cast<uint64_t>(msgR[i]) << " ";
                 ctx->warning(60033, ss.str());
             }
-        } else if (errno != EAGAIN)
+        }
+
+        if (errno != EAGAIN)
             throw NetworkException(10061, "network error, errno: " + std::to_string(errno) + ", message: " + strerror(errno));
     }
 
+    void WriterStream::sleepForClient() {
+        // Requests and confirmations from the client wake up the writer
+        if (!stream->waitForEvents(ctx->pollIntervalUs))
+            Writer::sleepForClient();
+    }
+
+    void WriterStream::sleepForWork() {
+        // New messages from the builder wake up the writer too, so an idle connection is not polled
+        if (!stream->waitForEvents(WAIT_EVENTS_US))
+            Writer::sleepForWork();
+    }
+
     void WriterStream::sendMessage(BuilderMsg* msg) {
-        stream->sendMessage(msg->data, msg->length);
+        if ((msg->flags & Builder::OUTPUT_BUFFER_MESSAGE_SPLIT) != 0)
+            stream->sendMessageParts(msgParts.data(), msgPayloadParts, msg->length);
+        else
+            stream->sendMessage(msg->data, msg->length);
     }
 }
@@ -28,6 +28,8 @@ namespace OpenLogReplicator {
 
     class WriterStream final : public Writer {
     protected:
+        static constexpr uint64_t WAIT_EVENTS_US = 5000000;
+
         Stream* stream;
         pb::RedoRequest request;
         pb::RedoResponse response;
@@ -38,6 +40,8 @@ namespace OpenLogReplicator {
         void processContinue();
         void processConfirm();
         void pollQueue() override;
+        void sleepForClient() override;
+        void sleepForWork() override;
         void sendMessage(BuilderMsg* msg) override;
 
     public: